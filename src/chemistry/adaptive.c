@@ -0,0 +1,351 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: adaptive.c
+ *
+ * PURPOSE: Contains functions for the dynamic adaptive chemistry, in which
+ *   each cell is evolved with its own active subset of the network rather
+ *   than with one network reduced for all cells (reduce_grid.c). The active
+ *   species are chosen by the directed relation graph (DRG) of the current
+ *   rates: species A depends on species B with the coupling
+ *
+ *     r_AB = sum_{terms of A in reactions with B} |rate|
+ *            / sum_{terms of A} |rate|
+ *
+ *   a term being one reaction in the equation of A (Chem->Equations) and B
+ *   any reactant or product of that reaction. Starting from the target
+ *   species, the electrons and those listed in problem/dactarget (names
+ *   separated by spaces or commas), all species reached along couplings
+ *   r_AB > problem/daceps (default 1e-3) are active. The active reactions
+ *   are those whose reactants and products are all active: by construction
+ *   the others make less than daceps of the rates of any active species.
+ *
+ *   Enabled by problem/dac=1 (see evolve.c): the solver evolves the active
+ *   species with the active reactions only, the inactive species being
+ *   frozen. The selection is made again from the current densities every
+ *   problem/dacevery (default 10) output steps, the solver being restarted
+ *   when the active species change.
+ *
+ *   With problem/dacan=1 (see main.c), each cell of the column is solved
+ *   with the full network and with the adaptive one (solve_cell()). The CPU
+ *   time of the solver, the mean number of active species and reactions
+ *   (over the output steps), the number of changes of the active species and
+ *   the relative errors of x_e and of eta_O, eta_H, eta_A (at the field
+ *   problem/B, in G) are written to job/dacout (default dac.txt) for each
+ *   cell, and summarized.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   dac_analysis() - compare the adaptive and full networks over a column
+ *   init_dac()     - allocate the active subset and make the first selection
+ *   final_dac()    - free the active subset data
+ *   dac_select()   - select the active species and reactions
+ *
+ * REFERENCES:
+ *   Lu, T. & Law, C. K., 2005, Proc. Combust. Inst., 30, 1333
+ *   Liang, L., Stevens, J. G. & Farrell, J. T., 2009, Proc. Combust. Inst.,
+ *     32, 527
+==============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+
+#ifdef CHEMISTRY
+
+/* mean NA, NRA and number of changes of the last evolution (final_dac()) */
+static Real DacLast[3];
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   Participants() - reactants and products of a reaction
+ *============================================================================*/
+
+int Participants(Chemistry *Chem, int r, int *lab);
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Solve the cells of the column Col with the full and the adaptive network
+ * and compare them (see main.c)
+ */
+void dac_analysis(Nebula *Disk, ChemColumn *Col)
+{
+  int c, m, nc = Col->nz, dac;
+  Real tsum[2], na, nra, emax[NSTAT], **full, **red, **act;
+  char *fname;
+  FILE *fp;
+
+  dac = par_geti_def("problem","dac",0);
+
+  full = (Real**)calloc_2d_array(nc, NSTAT, sizeof(Real));
+  red  = (Real**)calloc_2d_array(nc, NSTAT, sizeof(Real));
+  act  = (Real**)calloc_2d_array(nc, 3, sizeof(Real));
+
+  ath_pout(0,"\nDynamic adaptive chemistry over %d cells: daceps=%g, "
+             "dacevery=%d.\n", nc, par_getd_def("problem","daceps",1.0e-3),
+             par_geti_def("problem","dacevery",10));
+
+  for (c=0; c<nc; c++)
+  {
+    par_seti("problem","dac","%d",0,"full network");
+    solve_cell(Disk, Col, c, full[c]);
+
+    par_seti("problem","dac","%d",1,"adaptive network");
+    solve_cell(Disk, Col, c, red[c]);
+    for (m=0; m<3; m++)
+      act[c][m] = DacLast[m];
+  }
+  par_seti("problem","dac","%d",dac,"");
+
+/* Speedup, active sizes and relative errors */
+
+  fname = par_gets_def("job","dacout","dac.txt");
+  if ((fp = fopen(fname,"w")) == NULL)
+    ath_error("[dac_analysis]: Error open file %s\n",fname);
+
+  fprintf(fp,"# %d species, %d reactions; B = %g G\n", Chem.Ntot,
+             Chem.NReaction, Evln.B);
+  fprintf(fp,"# %10s %12s %12s %12s %12s %12s %12s %12s %12s %12s %12s\n",
+             "z", "t_full(s)", "t_dac(s)", "speedup", "species", "reactions",
+             "changes", "err(x_e)", "err(eta_O)", "err(eta_H)", "err(eta_A)");
+
+  compare_cells(fp, Col, full, red, act, 3, tsum, emax);
+
+  na = nra = 0.0;
+  for (c=0; c<nc; c++)
+  {
+    na  += act[c][0];
+    nra += act[c][1];
+  }
+
+  if (ferror(fp))
+    ath_error("[dac_analysis]: Error writing %s!\n",fname);
+  fclose(fp);
+  ath_pout(0,"Adaptive network over %d cells (written to %s): on average "
+             "%.1f of %d species and %.1f of %d reactions active, solver "
+             "time %.3f s vs %.3f s (speedup %.2f), max relative error x_e "
+             "%.3e, eta_O %.3e, eta_H %.3e, eta_A %.3e.\n", nc, fname,
+             na/MAX(nc,1), Chem.Ntot, nra/MAX(nc,1), Chem.NReaction, tsum[1],
+             tsum[0], tsum[0]/MAX(tsum[1],TINY_NUMBER), emax[1], emax[2], emax[3], emax[4]);
+  free(fname);
+
+  free_2d_array(full);
+  free_2d_array(red);
+  free_2d_array(act);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Read the targets and the threshold, allocate the active subset and select
+ * it for the rate coefficients K and the densities n (in the units of the
+ * solver)
+ */
+void init_dac(Chemistry *Chem, Real *K, Real *n, ChemDAC *D)
+{
+  int i;
+  char *list, *name;
+
+  D->N  = Chem->Ntot;
+  D->NR = Chem->NReaction;
+
+  D->eps = par_getd_def("problem","daceps",1.0e-3);
+  if ((D->eps <= 0.0) || (D->eps >= 1.0))
+    ath_error("[init_dac]: problem/daceps must be in (0,1)!\n");
+
+  D->targ  = (int*)calloc_1d_array(D->N, sizeof(int));
+  D->act   = (int*)calloc_1d_array(D->N, sizeof(int));
+  D->pos   = (int*)calloc_1d_array(D->N, sizeof(int));
+  D->ruse  = (int*)calloc_1d_array(MAX(D->NR,1), sizeof(int));
+  D->n     = (Real*)calloc_1d_array(D->N, sizeof(Real));
+  D->w     = (Real*)calloc_1d_array(D->N, sizeof(Real));
+  D->touch = (int*)calloc_1d_array(D->N, sizeof(int));
+  D->queue = (int*)calloc_1d_array(D->N, sizeof(int));
+  D->mark  = (int*)calloc_1d_array(D->N, sizeof(int));
+
+  /* the electrons, then the listed targets */
+  D->NT = 0;
+  D->targ[D->NT++] = 0;
+  for (i=0; i<D->N; i++)
+    D->mark[i] = (i == 0);
+
+  if (par_exist("problem","dactarget"))
+  {
+    list = par_gets("problem","dactarget");
+    for (name=strtok(list," ,"); name!=NULL; name=strtok(NULL," ,"))
+    {
+      i = FindSpecies(Chem, name);
+      if (i < 0)
+        ath_error("[init_dac]: species %s of problem/dactarget is not in the "
+                  "network!\n", name);
+      if (D->mark[i] == 0)
+        D->targ[D->NT++] = i;
+      D->mark[i] = 1;
+    }
+    free(list);
+  }
+
+  for (i=0; i<D->N; i++) {
+    D->pos[i] = -1;
+    D->n[i] = n[i];
+  }
+  D->NA = D->NRA = 0;
+  D->nsel = D->nchange = D->nstep = 0;
+  D->sumNA = D->sumNRA = 0.0;
+
+  dac_select(D, Chem, K, n);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Free the active subset data, keeping the mean active sizes and the number
+ * of changes for dac_analysis()
+ */
+void final_dac(ChemDAC *D)
+{
+  DacLast[0] = (D->nstep > 0) ? D->sumNA/D->nstep : D->NA;
+  DacLast[1] = (D->nstep > 0) ? D->sumNRA/D->nstep : D->NRA;
+  DacLast[2] = (Real)(D->nchange-1);
+
+  free_1d_array(D->targ);
+  free_1d_array(D->act);
+  free_1d_array(D->pos);
+  free_1d_array(D->ruse);
+  free_1d_array(D->n);
+  free_1d_array(D->w);
+  free_1d_array(D->touch);
+  free_1d_array(D->queue);
+  free_1d_array(D->mark);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Select the active species and reactions for the rate coefficients K and
+ * the densities n. Returns 1 if the active species changed, 0 otherwise.
+ */
+int dac_select(ChemDAC *D, Chemistry *Chem, Real *K, Real *n)
+{
+  int a, b, i, j, k, l, r, nq, head, nt, np, change, lab[6];
+  Real rate, den;
+  EquationTerm *EqTerm;
+
+  D->nsel++;
+
+/* Search the graph from the targets */
+
+  for (i=0; i<D->N; i++)
+    D->mark[i] = 0;
+
+  nq = 0;
+  for (i=0; i<D->NT; i++) {
+    D->mark[D->targ[i]] = 1;
+    D->queue[nq++] = D->targ[i];
+  }
+
+  for (head=0; head<nq; head++)
+  {
+    a = D->queue[head];
+    den = 0.0;
+    nt = 0;
+
+    for (k=0; k<Chem->Equations[a].NTerm; k++)
+    {
+      EqTerm = &(Chem->Equations[a].EqTerm[k]);
+      rate = K[EqTerm->ind];
+      for (l=0; l<EqTerm->N; l++)
+        rate *= n[EqTerm->lab[l]];
+      rate = fabs(rate);
+      if (rate <= 0.0) continue;
+      den += rate;
+
+      np = Participants(Chem, EqTerm->ind, lab);
+      for (j=0; j<np; j++)
+      {
+        b = lab[j];
+        if (b == a) continue;
+        if (D->w[b] == 0.0) D->touch[nt++] = b;
+        D->w[b] += rate;
+      }
+    }
+
+    for (j=0; j<nt; j++)
+    {
+      b = D->touch[j];
+      if ((D->mark[b] == 0) && (D->w[b] > D->eps*den)) {
+        D->mark[b] = 1;
+        D->queue[nq++] = b;
+      }
+      D->w[b] = 0.0;
+    }
+  }
+
+  change = 0;
+  for (i=0; i<D->N; i++)
+    if (D->mark[i] != (D->pos[i] >= 0))
+      change = 1;
+
+  if (!change) return 0;
+  D->nchange++;
+
+/* Active species and reactions */
+
+  D->NA = 0;
+  for (i=0; i<D->N; i++)
+  {
+    if (D->mark[i]) {
+      D->pos[i] = D->NA;
+      D->act[D->NA++] = i;
+    }
+    else
+      D->pos[i] = -1;
+  }
+
+  D->NRA = 0;
+  for (r=0; r<D->NR; r++)
+  {
+    D->ruse[r] = 0;
+    if (Chem->Reactions[r].use != 1) continue;
+    np = Participants(Chem, r, lab);
+    for (j=0; j<np; j++)
+      if (D->pos[lab[j]] < 0) break;
+    if (j == np) {
+      D->ruse[r] = 1;
+      D->NRA++;
+    }
+  }
+
+  return 1;
+}
+
+/*============================================================================*/
+/*----------------------------- Private Functions ----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* The distinct reactants and products lab[0..] of reaction r; returns their
+ * number
+ */
+int Participants(Chemistry *Chem, int r, int *lab)
+{
+  int j, k, s, np = 0;
+  ReactionInfo *R = &(Chem->Reactions[r]);
+
+  for (j=0; j<6; j++)
+  {
+    s = (j < 2) ? R->reactant[j] : R->product[j-2];
+    if (s < 0) continue;
+    for (k=0; k<np; k++)
+      if (lab[k] == s) break;
+    if (k == np) lab[np++] = s;
+  }
+
+  return np;
+}
+
+#endif /* CHEMISTRY */
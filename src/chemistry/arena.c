@@ -0,0 +1,240 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: arena.c
+ *
+ * PURPOSE: Contains functions to keep the constructed chemistry model in one
+ *   contiguous block of memory (the arena). While the model is built, the
+ *   arrays are allocated one by one; once it is complete, the exact size of
+ *   every array is counted and all of them are copied into a single block,
+ *   each section aligned to AR_ALIGN bytes (a cache line):
+ *
+ *     GrSize, GrFrac, Elements, Species, Reactions, Equations, ElHash, SpHash,
+ *     all species compositions, all reaction coefficients (temperature
+ *     ranges) and all equation terms
+ *
+ *   The compositions, coefficients and equation terms are stored back to back
+ *   in species/reaction order, so that the loops of the solver over them run
+ *   over contiguous memory. The model is then freed with a single free().
+ *
+ *   The network cache (netcache.c) stores the same image, with the pointers
+ *   replaced by offsets from the start of the arena.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   arena_size()     - size of the arena of a chemistry model
+ *   arena_pack()     - copy all arrays of a model into an arena
+ *   arena_relocate() - move all pointers of a model by a constant offset
+ *   pack_chemistry() - move a newly built model into its own arena
+==============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+
+#ifdef CHEMISTRY
+
+#define AR_ALIGN 64
+#define AR_PAD(x) ((((size_t)(x))+AR_ALIGN-1) & ~((size_t)AR_ALIGN-1))
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   There is no private function.
+ *============================================================================*/
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Size of the arena holding all arrays of the chemistry model
+ */
+size_t arena_size(Chemistry *Chem)
+{
+  int i;
+  size_t size, n;
+
+  size  = 2*AR_PAD(Chem->NGrain*sizeof(Real));
+  size += AR_PAD(Chem->N_Ele_tot*sizeof(ElementInfo));
+  size += AR_PAD(Chem->Ntot*sizeof(SpeciesInfo));
+  size += AR_PAD(Chem->NReaction*sizeof(ReactionInfo));
+  size += AR_PAD(Chem->Ntot*sizeof(EquationInfo));
+  size += AR_PAD(Chem->ElHash_size*sizeof(int));
+  size += AR_PAD(Chem->SpHash_size*sizeof(int));
+  size += AR_PAD(Chem->Ntot*Chem->N_Ele_tot*sizeof(int));
+
+  n = 0;
+  for (i=0; i<Chem->NReaction; i++)
+    n += Chem->Reactions[i].NumTRange;
+  size += AR_PAD(n*sizeof(Coefficient));
+
+  n = 0;
+  for (i=0; i<Chem->Ntot; i++)
+    n += Chem->Equations[i].NTerm;
+  size += AR_PAD(n*sizeof(EquationTerm));
+
+  return size;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Copy all arrays of Chem into buf (of arena_size(Chem) bytes, aligned to
+ * AR_ALIGN). The array pointers of C (a copy of *Chem) are set to the copies.
+ */
+void arena_pack(Chemistry *Chem, char *buf, Chemistry *C)
+{
+  int i;
+  size_t off = 0, n;
+
+#define AR_COPY(dst, src, len) { if ((len) > 0) memcpy(buf+off, (src), (len)); \
+                                 (dst) = (void*)(buf+off);  off += AR_PAD(len); }
+
+  if (Chem->NGrain > 0) {
+    AR_COPY(C->GrSize, Chem->GrSize, Chem->NGrain*sizeof(Real));
+    AR_COPY(C->GrFrac, Chem->GrFrac, Chem->NGrain*sizeof(Real));
+  }
+  else {
+    C->GrSize = NULL;  C->GrFrac = NULL;
+  }
+  AR_COPY(C->Elements,  Chem->Elements,  Chem->N_Ele_tot*sizeof(ElementInfo));
+  AR_COPY(C->Species,   Chem->Species,   Chem->Ntot*sizeof(SpeciesInfo));
+  AR_COPY(C->Reactions, Chem->Reactions, Chem->NReaction*sizeof(ReactionInfo));
+  AR_COPY(C->Equations, Chem->Equations, Chem->Ntot*sizeof(EquationInfo));
+  AR_COPY(C->ElHash,    Chem->ElHash,    Chem->ElHash_size*sizeof(int));
+  AR_COPY(C->SpHash,    Chem->SpHash,    Chem->SpHash_size*sizeof(int));
+
+#undef AR_COPY
+
+  /* per-species, per-reaction and per-equation arrays, back to back */
+  for (i=0; i<Chem->Ntot; i++) {
+    n = Chem->N_Ele_tot*sizeof(int);
+    memcpy(buf+off, Chem->Species[i].composition, n);
+    C->Species[i].composition = (int*)(buf+off);
+    off += n;
+  }
+  off = AR_PAD(off);
+
+  for (i=0; i<Chem->NReaction; i++) {
+    n = Chem->Reactions[i].NumTRange*sizeof(Coefficient);
+    memcpy(buf+off, Chem->Reactions[i].coeff, n);
+    C->Reactions[i].coeff = (Coefficient*)(buf+off);
+    off += n;
+  }
+  off = AR_PAD(off);
+
+  for (i=0; i<Chem->Ntot; i++) {
+    n = Chem->Equations[i].NTerm*sizeof(EquationTerm);
+    if (n > 0) memcpy(buf+off, Chem->Equations[i].EqTerm, n);
+    C->Equations[i].EqTerm = (EquationTerm*)(buf+off);
+    C->Equations[i].EqTerm_size = Chem->Equations[i].NTerm;
+    off += n;
+  }
+  off = AR_PAD(off);
+
+  if (off != arena_size(Chem))
+    ath_error("[arena_pack]: arena size mismatch (%lu vs %lu)!\n",
+              (unsigned long)off, (unsigned long)arena_size(Chem));
+
+  C->Reaction_size = Chem->NReaction;
+  C->Arena = buf;
+  C->Arena_size = off;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Replace every array pointer p of the model C by p-from+to. The arrays
+ * themselves are at buf, which is where C->Arena points to after the move.
+ * With from=buf and to=0 the pointers become offsets within the arena; with
+ * from=0 and to=buf offsets become pointers again.
+ */
+void arena_relocate(Chemistry *C, char *buf, size_t from, size_t to)
+{
+  int i;
+  SpeciesInfo *Species;
+  ReactionInfo *Reactions;
+  EquationInfo *Equations;
+
+#define AR_MOVE(p) (p) = (void*)((size_t)(p) - from + to)
+
+  Species   = (SpeciesInfo*) (buf + ((size_t)C->Species   - from));
+  Reactions = (ReactionInfo*)(buf + ((size_t)C->Reactions - from));
+  Equations = (EquationInfo*)(buf + ((size_t)C->Equations - from));
+
+  for (i=0; i<C->Ntot; i++) {
+    AR_MOVE(Species[i].composition);
+    AR_MOVE(Equations[i].EqTerm);
+  }
+
+  for (i=0; i<C->NReaction; i++)
+    AR_MOVE(Reactions[i].coeff);
+
+  if (C->NGrain > 0) {
+    AR_MOVE(C->GrSize);
+    AR_MOVE(C->GrFrac);
+  }
+  AR_MOVE(C->Elements);
+  AR_MOVE(C->Species);
+  AR_MOVE(C->Reactions);
+  AR_MOVE(C->Equations);
+  AR_MOVE(C->ElHash);
+  AR_MOVE(C->SpHash);
+  AR_MOVE(C->Arena);
+
+#undef AR_MOVE
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Move a newly built chemistry model into a newly allocated arena and free
+ * the arrays allocated during the construction
+ */
+void pack_chemistry(Chemistry *Chem)
+{
+  int i;
+  void *buf = NULL;
+  size_t size;
+  Chemistry C;
+
+  size = arena_size(Chem);
+
+  if (posix_memalign(&buf, AR_ALIGN, MAX(size,AR_ALIGN)) != 0)
+    ath_error("[pack_chemistry]: Failed to allocate %lu bytes!\n",
+              (unsigned long)size);
+  memset(buf, 0, size);
+
+  C = *Chem;
+  arena_pack(Chem, (char*)buf, &C);
+
+  /* free the construction storage */
+  for (i=0; i<Chem->Ntot; i++)
+    free(Chem->Species[i].composition);
+
+  for (i=0; i<Chem->Reaction_size; i++)  /* including unused slots */
+    free(Chem->Reactions[i].coeff);
+
+  if (Chem->Ntot > 0)  /* one block for all equation terms */
+    free(Chem->Equations[0].EqTerm);
+
+  if (Chem->NGrain > 0) {
+    free(Chem->GrSize);
+    free(Chem->GrFrac);
+  }
+  free(Chem->Elements);
+  free(Chem->Species);
+  free(Chem->Reactions);
+  free(Chem->Equations);
+  free(Chem->ElHash);
+  free(Chem->SpHash);
+
+  *Chem = C;
+
+  return;
+}
+
+#undef AR_ALIGN
+#undef AR_PAD
+
+#endif /* CHEMISTRY */
@@ -0,0 +1,353 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: benchmark.c
+ *
+ * PURPOSE: Contains a benchmark of the accuracy and speed of the reduced
+ *   networks against the thresholds of the reduction. The cells of the
+ *   column are solved once with the full network (job/read_species,
+ *   job/read_reaction), keeping the densities and rate coefficients of each
+ *   cell. The network is then reduced over the cells as in reduce_grid()
+ *   (species_sens(), reaction_ratio(), select_network()) for every
+ *   combination of the values in
+ *
+ *     problem/benchsens   - minsens  (default: problem/minsens)
+ *     problem/benchratio  - minratio (default: problem/minratio)
+ *     problem/benchlimit  - limit    (default: problem/limit)
+ *
+ *   (numbers separated by spaces or commas); the species are selected again
+ *   only when minsens or minratio change. Network k (from 1) is written
+ *   to job/redspecies.k and job/redreaction.k, loaded in place of the full
+ *   one (load_network()), and the same suite of cells, those of the column,
+ *   is solved with it (solve_cell()); the full network is then loaded back.
+ *
+ *   For the full network (k = 0) and each reduced one, job/benchout (default
+ *   bench.txt) gets the thresholds, the numbers of species and reactions,
+ *   the wall time of the suite, the CPU time of the solver, the number of
+ *   RHS evaluations (with those of the band preconditioner), and the maximum
+ *   over the cells of the relative error of x_e and of eta_O, eta_H, eta_A
+ *   (at the field problem/B, in G) against the full network.
+ *
+ *   Run by "reactm -i <file> -b" (see main.c), or "make bench BENCH=<file>".
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   bench_reduction() - benchmark the reduced networks over a column
+ *
+ * REFERENCES:
+ *   D. Wiebe, et al. 2003, A&A, 399, 197-210
+==============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+
+#ifdef CHEMISTRY
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   ParseList() - list of numbers of a parameter
+ *   Suite()     - solve the cells of the column and add up the cost
+ *   CellState() - save or restore the state of Evln after a cell
+ *   WallTime()  - wall clock time in s
+ *============================================================================*/
+
+int  ParseList(char *name, Real def, Real **v);
+void Suite(Nebula *Disk, ChemColumn *Col, Real **stat, Real **state,
+           Real *cost);
+void CellState(Real *state, int save);
+Real WallTime(void);
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Reduce the network over the cells of the column Col for each combination
+ * of the thresholds, and solve the cells with each reduced network (see
+ * main.c)
+ */
+void bench_reduction(Nebula *Disk, ChemColumn *Col)
+{
+  int c, i, j, l, k, m, r, nc = Col->nz, ns, nq, nl, nst, **cover;
+  Real s0, q0, l0, cost[3], tsum[2], emax[NSTAT], *vs, *vq, *vl, **full, **red;
+  Real **state, *sens, *smax, *ratio, *rmax, *abn;
+  char *sp, *re, *cache, *rsp, *rre, *fname;
+  int Ntot = Chem.Ntot, NR = Chem.NReaction;
+  char name[256], rname[256], cname[256];
+  FILE *fp;
+
+  /* the reduced networks are written with the labels of the full one */
+  if (par_geti_def("problem","prune",0) == 1)
+    ath_error("[bench_reduction]: Writing the reduced networks requires "
+              "problem/prune=0!\n");
+
+  s0 = par_getd("problem","minsens");
+  q0 = par_getd("problem","minratio");
+  l0 = par_getd("problem","limit");
+  ns = ParseList("benchsens",  s0, &vs);
+  nq = ParseList("benchratio", q0, &vq);
+  nl = ParseList("benchlimit", l0, &vl);
+
+  /* the full network and the base names of the reduced ones */
+  sp  = par_gets("job","read_species");
+  re  = par_gets("job","read_reaction");
+  rsp = par_gets_def("job","redspecies","sp_red.txt");
+  rre = par_gets_def("job","redreaction","re_red.txt");
+  cache = NULL;
+  if (par_exist("job","netcache"))
+    cache = par_gets("job","netcache");
+
+  /* densities, rate coefficients and grain charges of each cell */
+  nst = 2 + Ntot + NR + (Chem.GrLump ? Chem.NGrain*(2*Chem.GrZmax+1) : 0);
+
+  full  = (Real**)calloc_2d_array(MAX(nc,1), NSTAT, sizeof(Real));
+  red   = (Real**)calloc_2d_array(MAX(nc,1), NSTAT, sizeof(Real));
+  state = (Real**)calloc_2d_array(MAX(nc,1), nst, sizeof(Real));
+  cover = (int**)calloc_2d_array(MAX(nc,1), Ntot, sizeof(int));
+  sens  = (Real*)calloc_1d_array(Ntot, sizeof(Real));
+  smax  = (Real*)calloc_1d_array(Ntot, sizeof(Real));
+  ratio = (Real*)calloc_1d_array(MAX(NR,1), sizeof(Real));
+  rmax  = (Real*)calloc_1d_array(MAX(NR,1), sizeof(Real));
+
+  /* element abundances of the species file, before init_numberden() */
+  abn = (Real*)calloc_1d_array(Chem.N_Ele, sizeof(Real));
+  for (i=0; i<Chem.N_Ele; i++)
+    abn[i] = Chem.Elements[i].abundance;
+
+  fname = par_gets_def("job","benchout","bench.txt");
+  if ((fp = fopen(fname,"w")) == NULL)
+    ath_error("[bench_reduction]: Error open file %s\n",fname);
+
+  ath_pout(0,"\nBenchmark of %d reduced networks over %d cells.\n",
+              ns*nq*nl, nc);
+
+/* The full network, solved once for all combinations */
+
+  Suite(Disk, Col, full, state, cost);
+
+  /* the ratios of the reactions do not depend on the thresholds */
+  for (c=0; c<nc; c++)
+  {
+    CellState(state[c], 0);
+    reaction_ratio(&Evln, ratio);
+    for (r=0; r<NR; r++) rmax[r] = MAX(rmax[r], ratio[r]);
+  }
+
+  fprintf(fp,"# %d cells; B = %g G; network k in %s.k, %s.k\n", nc, Evln.B,
+             rsp, rre);
+  fprintf(fp,"# %3s %10s %10s %10s %8s %9s %12s %12s %12s %12s %12s %12s "
+             "%12s\n", "k", "minsens", "minratio", "limit", "species",
+             "reactions", "t_wall(s)", "t_cpu(s)", "RHS", "err(x_e)",
+             "err(eta_O)", "err(eta_H)", "err(eta_A)");
+  fprintf(fp,"%5d %10s %10s %10s %8d %9d %12e %12e %12.0f", 0, "-", "-", "-",
+             Ntot, NR, cost[0], cost[1], cost[2]);
+  for (m=1; m<NSTAT; m++)
+    fprintf(fp," %12e", 0.0);
+  fprintf(fp,"\n");
+  fflush(fp);
+
+/* Each combination of the thresholds */
+
+  k = 0;
+  for (i=0; i<ns; i++)
+  for (j=0; j<nq; j++)
+  for (l=0; l<nl; l++)
+  {
+    k++;
+    ath_pout(0,"\nBenchmark network %d: minsens=%g, minratio=%g, limit=%g\n",
+                k, vs[i], vq[j], vl[l]);
+
+    par_setd("problem","minsens","%.10e",vs[i],"benchmark");
+    par_setd("problem","minratio","%.10e",vq[j],"benchmark");
+    par_setd("problem","limit","%.10e",vl[l],"benchmark");
+
+    snprintf(name, sizeof(name), "%s.%d", rsp, k);
+    par_sets("job","redspecies",name,"benchmark");
+    snprintf(rname, sizeof(rname), "%s.%d", rre, k);
+    par_sets("job","redreaction",rname,"benchmark");
+
+    /* the species of each cell, for this minsens and minratio */
+    if (l == 0)
+    {
+      for (m=0; m<Ntot; m++) smax[m] = 0.0;
+      for (c=0; c<nc; c++)
+      {
+        CellState(state[c], 0);
+        species_sens(&Evln, cover[c], sens);
+        for (m=0; m<Ntot; m++) smax[m] = MAX(smax[m], sens[m]);
+      }
+    }
+
+    select_network(Col, cover, smax, rmax, abn);
+
+    /* keep the cache of the full network */
+    if (cache != NULL)
+      snprintf(cname, sizeof(cname), "%s.red", cache);
+    load_network(Disk, Col, name, rname, (cache != NULL) ? cname : NULL);
+    Suite(Disk, Col, red, NULL, cost);
+
+    fprintf(fp,"%5d %10.3e %10.3e %10.3e %8d %9d %12e %12e %12.0f", k, vs[i],
+               vq[j], vl[l], Chem.Ntot, Chem.NReaction, cost[0], cost[1],
+               cost[2]);
+    compare_cells(NULL, Col, full, red, NULL, 0, tsum, emax);
+    for (m=1; m<NSTAT; m++)
+      fprintf(fp," %12e", emax[m]);
+    fprintf(fp,"\n");
+    fflush(fp);
+
+    ath_pout(0,"Benchmark network %d: %d species, %d reactions, wall time "
+               "%.3f s, solver %.3f s, %.0f RHS evaluations, max relative "
+               "error x_e %.3e, eta_O %.3e, eta_H %.3e, eta_A %.3e.\n", k,
+               Chem.Ntot, Chem.NReaction, cost[0], cost[1], cost[2],
+               emax[1], emax[2], emax[3], emax[4]);
+
+    load_network(Disk, Col, sp, re, cache);
+  }
+
+  if (ferror(fp))
+    ath_error("[bench_reduction]: Error writing the benchmark!\n");
+  fclose(fp);
+  ath_pout(0,"\nBenchmark of %d reduced networks written to %s.\n", k, fname);
+  free(fname);
+
+/* Restore the parameters */
+
+  par_setd("problem","minsens","%.10e",s0,"");
+  par_setd("problem","minratio","%.10e",q0,"");
+  par_setd("problem","limit","%.10e",l0,"");
+  par_sets("job","redspecies",rsp,"");
+  par_sets("job","redreaction",rre,"");
+
+  free_1d_array(vs);
+  free_1d_array(vq);
+  free_1d_array(vl);
+  free_2d_array(full);
+  free_2d_array(red);
+  free_2d_array(state);
+  free_2d_array(cover);
+  free_1d_array(sens);
+  free_1d_array(smax);
+  free_1d_array(ratio);
+  free_1d_array(rmax);
+  free_1d_array(abn);
+  free(sp);
+  free(re);
+  free(rsp);
+  free(rre);
+  if (cache != NULL) free(cache);
+
+  return;
+}
+
+/*============================================================================*/
+/*----------------------------- Private Functions ----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Numbers v[0..] of parameter problem/name (separated by spaces or commas),
+ * or the single value def if it is not set; returns their number
+ */
+int ParseList(char *name, Real def, Real **v)
+{
+  int n = 0;
+  char *list, *s, *end;
+
+  if (!par_exist("problem",name))
+  {
+    *v = (Real*)calloc_1d_array(1, sizeof(Real));
+    (*v)[0] = def;
+    return 1;
+  }
+
+  list = par_gets("problem",name);
+  *v = (Real*)calloc_1d_array(strlen(list)/2+1, sizeof(Real));
+  for (s=strtok(list," ,"); s!=NULL; s=strtok(NULL," ,"))
+  {
+    (*v)[n] = strtod(s, &end);
+    if ((end == s) || (*end != '\0') || !((*v)[n] > 0.0))
+      ath_error("[bench_reduction]: %s of problem/%s is not a positive "
+                "number!\n", s, name);
+    n++;
+  }
+  free(list);
+
+  if (n == 0)
+    ath_error("[bench_reduction]: problem/%s is empty!\n", name);
+
+  return n;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Solve the cells of the column Col with the network in use; stat[c] gets
+ * the results of solve_cell(), state[c] (unless NULL) the state of Evln (see
+ * CellState()), and cost the wall time of the suite, the CPU time of the
+ * solver and the number of RHS evaluations
+ */
+void Suite(Nebula *Disk, ChemColumn *Col, Real **stat, Real **state,
+           Real *cost)
+{
+  int c;
+  Real t0;
+
+  cost[1] = cost[2] = 0.0;
+  t0 = WallTime();
+
+  for (c=0; c<Col->nz; c++)
+  {
+    solve_cell(Disk, Col, c, stat[c]);
+    cost[1] += stat[c][0];
+    cost[2] += (Real)Evln.nfe;
+    if (state != NULL)
+      CellState(state[c], 1);
+  }
+
+  cost[0] = WallTime() - t0;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Save (save=1) the state of Evln that species_sens() and reaction_ratio()
+ * depend on to state[], or restore it (save=0): rho, T, the number densities,
+ * the rate coefficients and the lumped grain charge distributions
+ */
+void CellState(Real *state, int save)
+{
+  int i, n = 2;
+  Chemistry *Chem = Evln.Chem;
+  int ng = Chem->GrLump ? Chem->NGrain*(2*Chem->GrZmax+1) : 0;
+
+  if (save) {
+    state[0] = Evln.rho;
+    state[1] = Evln.T;
+    for (i=0; i<Chem->Ntot; i++)      state[n++] = Evln.NumDen[i];
+    for (i=0; i<Chem->NReaction; i++) state[n++] = Evln.K[i];
+    for (i=0; i<ng; i++)              state[n++] = Evln.GrDist[i];
+  }
+  else {
+    Evln.rho = state[0];
+    Evln.T   = state[1];
+    for (i=0; i<Chem->Ntot; i++)      Evln.NumDen[i] = state[n++];
+    for (i=0; i<Chem->NReaction; i++) Evln.K[i]      = state[n++];
+    for (i=0; i<ng; i++)              Evln.GrDist[i] = state[n++];
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Wall clock time in s, from an arbitrary origin
+ */
+Real WallTime(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (Real)ts.tv_sec + 1.0e-9*ts.tv_nsec;
+}
+
+#endif /* CHEMISTRY */
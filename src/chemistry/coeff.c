@@ -3,7 +3,7 @@
  * FILE: coeff.c
  *
  * PURPOSE: Calculate the rate coefficients for all reactions. There are 6
- *   types of reactions labeled by "rtype", ranging from 0 to 5:
+ *   types of reactions labeled by "rtype":
  *
  *     0: ionization reactions;
  *     1: gas-phase reactions;
@@ -11,6 +11,9 @@
  *     3: neutral-grain reactions (adsorption);
  *     4: desorption reactions;
  *     5: grain-grain reactions;
+ *     6: grain-surface reactions;
+ *     7: ion/electron + lumped grain reactions (see grain_lump.c);
+ *    10: photo-reactions;
  *
  *   Different types of reactions are calculated by different functions.
  *
@@ -18,9 +21,12 @@
  *
  * CONTAINS PUBLIC FUNCTIONS:
  *  - IonizationCoeff() - set the ionization rate coefficient
+ *  - IonizationCoeff_column() - same, with photo-rates from a column cache
  *  - CalCoeff()        - calculate rate coefficients for all other reactions
  *  - ChemCoeff()       - get the rate coefficients for gas-phase reactions
  *  - IonGrCoeff()      - get the rate coefficients for ion-grain reactions
+ *  - LumpGrCoeff()     - the same for a lumped grain of a given charge
+ *  - ChargeGrCoeff()   - ion/electron-grain rate coefficient for any charge
  *  - NeuGrCoeff()      - get the rate coefficients for neutral-grain reactions
  *  - DesorpCoeff()     - get the rate coefficients for desorption reactions
  *  - GrGrCoeff()       - get the rate coefficients for grain-grain reactions
@@ -125,21 +131,67 @@ void IonizationCoeff1(ChemEvln *Evln, Real zeta_eff, Real Av, Real G,int verbose
 
   return;
 }
+/*------------------------------------------------------------------------------
+ * Set the ionization rate coefficient of cell iz in a column, where the
+ * photo-reaction rates are taken from the attenuation cache of the column
+ */
+void IonizationCoeff_column(ChemEvln *Evln, ChemColumn *Col, int iz,
+                            Real zeta_eff, int verbose)
+{
+  int i, n;
+  Chemistry *Chem = Evln->Chem;
+  Real *atten = &(Col->atten[iz*Col->NPhoto]);
+
+  Evln->zeta_eff = zeta_eff;
+
+  for (i=0; i<Chem->NReaction; i++)
+  {
+    if (Chem->Reactions[i].rtype == 0)
+    { /* ionization reaction */
+      Evln->K[i] = zeta_eff * Chem->Reactions[i].coeff[0].gamma;
+
+      if (verbose == 0) {
+        PrintReaction(Chem,i,Evln->K[i]);
+      }
+    }
+  }
+
+  for (n=0; n<Col->NPhoto; n++)
+  { /* photoionization reaction */
+    i = Col->photo[n];
+    Evln->K[i] = Col->G0*Chem->Reactions[i].coeff[0].alpha*atten[n];
+
+    if (verbose == 0) {
+      PrintReaction(Chem,i,Evln->K[i]);
+    }
+  }
+
+  return;
+}
+
 /*------------------------------------------------------------------------------
  * Calculate all other rate coefficients
  */
 void CalCoeff(ChemEvln *Evln, Real T, int verbose)
 {
-  int i, type;
-  Real K;
+  int i, n, j, type, zlo, zhi, tab = 0;
+  Real K, w[4];
   Chemistry *Chem = Evln->Chem;
 
   Evln->T = T;
 
+  /* interpolation weights if a rate table is in use */
+  if (Chem->RTab != NULL)
+    tab = RateTab_weights(Chem->RTab, T, &j, w);
+
   /* Read coeffients from reaction */
   for (i=0; i<Chem->NReaction; i++)
   {
     type = Chem->Reactions[i].rtype;
+
+    if ((tab) && ((n = Chem->RTab->ind[i]) >= 0))
+      K = RateTab_value(Chem->RTab, n, j, w);
+    else
     switch (type)
     {
       /* Ionization Reaction (K is set elsewhere) */
@@ -167,7 +219,12 @@ void CalCoeff(ChemEvln *Evln, Real T, int verbose)
       /* Grain-surface reaction */
       case 6: K = GrSurfCoeff(Evln, i, T);
               break;
-      default : ath_error("[coefficients]: reaction type should be 0-6!\n");
+      /* Charge+lumped grain, for neutral grains (evolve() then takes the
+       * mean over the charge distribution) */
+      case 7: grlump_range(Chem, i, &zlo, &zhi);
+              K = ((zlo <= 0) && (zhi >= 0)) ? LumpGrCoeff(Chem, i, 0, T) : 0.0;
+              break;
+      default : ath_error("[coefficients]: reaction type should be 0-7!\n");
     }
 
     Evln->rate_adj[i] = 1.0;
@@ -267,20 +324,50 @@ Real ChemCoeff(Coefficient *coeff, Real T, int NumTRange)
  */
 Real IonGrCoeff(Chemistry *Chem, int i, Real T)
 {
-  Real q;	/* sign of charge */
   int r1, r2, Z;
-  Real tau, nu, Jt, temp1, temp2, size;
+  Real size;
   Real s;	/* sticking coefficient */
-  Coefficient *coeff = Chem->Reactions[i].coeff;
 
   r1 = Chem->Reactions[i].reactant[0];
   r2 = Chem->Reactions[i].reactant[1];
 
-  q = Chem->Species[r1].charge;
-
   Z = Chem->Species[r2].charge;      /* charge of grain */
   size = Chem->Species[r2].gsize;    /* GrainSize */
 
+  /* calculating sticking coefficient */
+  if (r1 != 0)  /* Ions */
+    s = 1.0;
+  else          /* electrons */
+    s = EleStickCoeff(size, Z, T);
+
+  return ChargeGrCoeff(Chem->Reactions[i].coeff, Chem->Species[r1].charge,
+                       Z, size, s, T);
+}
+
+/*-----------------------------------------------------------------------------
+ * Rate coefficient of the lumped ion + grain reaction i (type 7) for a grain
+ * of charge Z
+ */
+Real LumpGrCoeff(Chemistry *Chem, int i, int Z, Real T)
+{
+  int r1 = Chem->Reactions[i].reactant[0];
+  Real size = Chem->Species[Chem->Reactions[i].reactant[1]].gsize;
+  Real s = (r1 != 0) ? 1.0 : EleStickCoeff(size, Z, T);
+
+  return ChargeGrCoeff(Chem->Reactions[i].coeff, Chem->Species[r1].charge,
+                       Z, size, s, T);
+}
+
+/*-----------------------------------------------------------------------------
+ * Rate coefficient of a species of charge q (mass coeff[0].alpha, branching
+ * ratio coeff[0].gamma) with a grain of charge Z and size (micron), for the
+ * sticking coefficient s
+ */
+Real ChargeGrCoeff(Coefficient *coeff, Real q, int Z, Real size, Real s,
+                   Real T)
+{
+  Real tau, nu, Jt, temp1, temp2;
+
   tau = 17.96*(T/300.0)*size;
   nu = (Real)(Z)/(Real)(q);
 
@@ -296,14 +383,8 @@ Real IonGrCoeff(Chemistry *Chem, int i, Real T)
     Jt = SQR(temp1)*exp(-temp2/tau);
   }
 
-  /* calculating sticking coefficient */
-  if (r1 != 0)  /* Ions */
-    s = 1.0;
-  else          /* electrons */
-    s = EleStickCoeff(size, Z, T);
   return 7.893e-3 * s * sqrt(T/300.0/coeff[0].alpha)
                   * SQR(size) * Jt * coeff[0].gamma;
-	
 }
 
 /*-----------------------------------------------------------------------------
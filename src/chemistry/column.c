@@ -0,0 +1,119 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: column.c
+ *
+ * PURPOSE: Contains functions to set up a vertical column of cells in the
+ *   disk. Column densities, ionization rates, visual extinction and the
+ *   attenuation factors of all photo-reactions (rtype 10) are evaluated once
+ *   for the whole column, so that the rate coefficients of each cell can be
+ *   set without repeating the column integrals.
+ *
+ *   The photo-reaction rate in cell iz is K = G0*alpha*exp(-gamma*Av(iz)),
+ *   with Av measured from the disk surface above the cell.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   init_column()  - compute zeta(z), Av(z) and the attenuation cache
+ *   final_column() - finalize the column structure
+ *
+ * REFERENCES:
+ *   Bohlin, R. C., Savage, B. D. & Drake, J. F., 1978, ApJ, 224, 132
+==============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+
+#ifdef CHEMISTRY
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   There is no private function.
+ *============================================================================*/
+
+/*============================================================================*/
+/*---------------------------- Public Functions ------------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Initialize a column of nz cells at heights z[0..nz-1] (H) and radius (AU)
+ * G0 is the incident UV field at the disk surface
+ */
+void init_column(Chemistry *Chem, ChemColumn *Col, Nebula *Disk, Real radius,
+                 int nz, Real *z, Real G0)
+{
+  int i, m, n;
+  Real gamma;
+
+  if (nz <= 0)
+    ath_error("[init_column]: Number of cells must be positive!\n");
+
+  Col->nz = nz;
+  Col->G0 = G0;
+
+  Col->z    = (Real*)calloc_1d_array(nz, sizeof(Real));
+  Col->sigz = (Real*)calloc_1d_array(nz, sizeof(Real));
+  Col->Av   = (Real*)calloc_1d_array(nz, sizeof(Real));
+  Col->zeta = (Real*)calloc_1d_array(nz, sizeof(Real));
+
+  for (i=0; i<nz; i++)
+    Col->z[i] = z[i];
+
+  /* cumulative column density and extinction of all cells in one pass */
+  SurfDenZ_column(Disk, radius, nz, Col->z, Col->sigz);
+
+  for (i=0; i<nz; i++)
+    Col->Av[i] = Av_disk(Col->sigz[i]);
+
+  /* ionization rate of all cells */
+  Ionization_column(Disk, radius, nz, Col->sigz, Col->zeta);
+
+  /* collect the photo-reactions */
+  n = 0;
+  for (m=0; m<Chem->NReaction; m++)
+    if (Chem->Reactions[m].rtype == 10) n++;
+
+  Col->NPhoto = n;
+  Col->photo  = (int*)calloc_1d_array(MAX(n,1), sizeof(int));
+  Col->atten  = (Real*)calloc_1d_array(MAX(n*nz,1), sizeof(Real));
+
+  n = 0;
+  for (m=0; m<Chem->NReaction; m++)
+    if (Chem->Reactions[m].rtype == 10) Col->photo[n++] = m;
+
+  /* attenuation factor exp(-gamma*Av) of each photo-reaction in each cell */
+  for (n=0; n<Col->NPhoto; n++)
+  {
+    gamma = Chem->Reactions[Col->photo[n]].coeff[0].gamma;
+
+    for (i=0; i<nz; i++)
+      Col->atten[i*Col->NPhoto+n] = exp(-gamma*Col->Av[i]);
+  }
+
+  ath_pout(0,"Column of %d cells: Av from %e to %e, %d photo-reactions.\n",
+              nz, Col->Av[0], Col->Av[nz-1], Col->NPhoto);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Finalize the column structure
+ */
+void final_column(ChemColumn *Col)
+{
+  free_1d_array(Col->z);
+  free_1d_array(Col->sigz);
+  free_1d_array(Col->Av);
+  free_1d_array(Col->zeta);
+  free_1d_array(Col->photo);
+  free_1d_array(Col->atten);
+
+  Col->nz = 0;
+  Col->NPhoto = 0;
+
+  return;
+}
+
+#endif /* CHEMISTRY */
@@ -0,0 +1,881 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: csp.c
+ *
+ * PURPOSE: Contains functions for the computational singular perturbation
+ *   (CSP) analysis of the timescales of one cell. The modes are those of the
+ *   analytic Jacobian J = dg/dn of the reaction equations dn/dt = g (see
+ *   jacobi() in evolve.c), ordered by decreasing |lambda|. With the right
+ *   basis vectors a_k and the left ones b^k (b^k a_l = delta_kl) of the
+ *   fastest modes, the amplitudes f^k = b^k g measure how much of the
+ *   evolution still goes along the fast directions. The leading M modes
+ *   (Re lambda < 0) are exhausted when their contribution over the timescale
+ *   of the fastest remaining mode is within the tolerance of every species,
+ *
+ *     tau_{M+1} |sum_{k<=M} a_k^i f^k| < csprtol |n_i| + atol_i
+ *
+ *   atol_i being the absolute tolerance of the solver (problem/atol,
+ *   atolmode, atolrel, see abstol_species()). The amplitudes are known only
+ *   to the rounding of g, a small difference of large rates; what that
+ *   rounding (CSP_EPS times the sum of |rates| of each species) gives along
+ *   a_k is added to the tolerance. Only the modes faster than the
+ *   time reached can be exhausted, and neither a complex pair nor a cluster
+ *   of equal eigenvalues (the same process on the grains of each size) is
+ *   split. The eigenvalues come from the QR iteration of the balanced
+ *   Hessenberg form of J, the basis vectors of the fast modes from inverse
+ *   iteration with J and J^T (for a complex pair, the real and imaginary
+ *   parts; in a cluster, orthogonal to the previous vectors).
+ *
+ *   The results are, for the M exhausted modes,
+ *
+ *     radical pointer  D_i = sum_{k<=M} a_k^i b^k_i   (0..1; near 1 for the
+ *                      species in quasi-steady state, see qssa.c)
+ *     participation    P_r = max_k |b^k S_r| R_r / sum_s |b^k S_s| R_s
+ *     importance       I_r = max_i |((1-Q) S_r)_i| R_r / sum_s |(..S_s)_i| R_s
+ *
+ *   S_r being the stoichiometric vector and R_r the rate of reaction r, and
+ *   Q = sum_{k<=M} a_k b^k the projector on the fast modes; the importance is
+ *   taken over the slow species (D_i < 0.5). Like the share of the rates
+ *   used by select_reaction() (reaction_ratio()), P_r and I_r are fractions,
+ *   to be compared with problem/limit; without fast modes I_r is that share.
+ *
+ *   Enabled by problem/cspan=1 (see main.c): the cells of the column are
+ *   evolved as in main.c (solve_cell()) and analysed at the final time. The
+ *   results are written to job/cspout (default csp.csv) with the columns
+ *
+ *     cell,z,kind,index,name,v1,v2,v3
+ *
+ *   kind being
+ *     mode:     index k (0 the fastest), v1 = Re lambda, v2 = Im lambda (s^-1),
+ *               v3 = 1 if exhausted;
+ *     species:  index and name of the species, v1 = D_i, v2 = its destruction
+ *               timescale -1/J_ii (s, 0 if not destroyed), v3 = abundance;
+ *     reaction: label (from 0, in the order of the reaction file) and
+ *               equation of the reactions in use, v1 = P_r, v2 = I_r,
+ *               v3 = reaction_ratio().
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   csp_analysis() - CSP analysis of the cells of a column
+ *   init_csp()     - allocate the CSP data of a chemistry model
+ *   final_csp()    - free the CSP data
+ *   csp_modes()    - modes, exhausted modes and radical pointers of one cell
+ *   csp_indices()  - participation and importance indices of the reactions
+ *
+ * REFERENCES:
+ *   Lam, S. H. & Goussis, D. A., 1994, Int. J. Chem. Kinet., 26, 461
+ *   Valorani, M., Goussis, D. A., Creta, F. & Najm, H. N., 2005, J. Comput.
+ *     Phys., 209, 754
+==============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+
+#ifdef CHEMISTRY
+
+/* maximum number of QR iterations per eigenvalue */
+#define CSP_MAXIT 60
+/* number of inverse iterations for a basis vector */
+#define CSP_NINV 3
+/* relative distance of the eigenvalues of one cluster */
+#define CSP_CLUS 1.0e-6
+/* relative rounding error of the sum of the rates of a species */
+#define CSP_EPS 1.0e-12
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   Balance()    - balance a matrix by similarity transforms
+ *   Hessenberg() - reduce a matrix to upper Hessenberg form
+ *   HessQR()     - eigenvalues of an upper Hessenberg matrix
+ *   Faster()     - whether one eigenvalue is ahead of another
+ *   Cluster()    - whether a mode has the eigenvalue of the previous one
+ *   InvIter()    - right or left eigenvector by inverse iteration
+ *   FastBasis()  - factor B A and solve for the amplitudes of m fast modes
+ *                  and their rounding errors
+ *   WriteEquation() - write the equation of a reaction
+ *============================================================================*/
+
+void Balance(Real **a, int n);
+void Hessenberg(Real **a, int n);
+int  HessQR(Real **a, int n, Real *wr, Real *wi);
+int  Faster(Real re1, Real im1, Real re2, Real im2);
+int  Cluster(ChemCSP *C, int k);
+void InvIter(ChemCSP *C, Real re, Real im, int trans, Real *u, Real *v,
+             Real **prev, int np);
+void FastBasis(ChemCSP *C, int m);
+void WriteEquation(FILE *fp, Chemistry *Chem, int r);
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* CSP analysis of the cells of the column Col, written to job/cspout (see
+ * main.c)
+ */
+void csp_analysis(Nebula *Disk, ChemColumn *Col)
+{
+  int c, i, k, r, nf, nsel, nrat, atolmode, abnvar;
+  Real rtol, atol, atolrel, limit, scale, stat[NSTAT], *tol, *flux, *ratio;
+  ChemCSP C;
+  char *fname;
+  FILE *fp;
+  Chemistry *Chem = Evln.Chem;
+
+  rtol     = par_getd_def("problem","csprtol",1.0e-3);
+  limit    = par_getd_def("problem","limit",0.1);
+  atol     = par_getd("problem","atol");
+  atolmode = par_geti_def("problem","atolmode",0);
+  atolrel  = par_getd_def("problem","atolrel",1.0e-15);
+  abnvar   = par_geti_def("problem","abnvar",0);
+
+  init_csp(Chem, &C);
+  tol   = (Real*)calloc_1d_array(Chem->Ntot, sizeof(Real));
+  flux  = (Real*)calloc_1d_array(MAX(Chem->NReaction,1), sizeof(Real));
+  ratio = (Real*)calloc_1d_array(MAX(Chem->NReaction,1), sizeof(Real));
+
+  fname = par_gets_def("job","cspout","csp.csv");
+  if ((fp = fopen(fname,"w")) == NULL)
+    ath_error("[csp_analysis]: Error open file %s\n",fname);
+  fprintf(fp,"cell,z,kind,index,name,v1,v2,v3\n");
+
+  ath_pout(0,"\nCSP analysis over %d cells: csprtol=%g, limit=%g.\n",
+              Col->nz, rtol, limit);
+
+  for (c=0; c<Col->nz; c++)
+  {
+    solve_cell(Disk, Col, c, stat);
+
+    /* the tolerances of the solver, in number density (see evolve.c) */
+    scale = (abnvar == 1) ? Evln.Abn_Den : 1.0;
+    abstol_species(&Evln, atolmode, atolrel, atol/scale, tol);
+
+    csp_modes(&Evln, rtol, tol, &C);
+    reaction_flux(&Evln, flux);
+    csp_indices(&Evln, flux, &C);
+    reaction_ratio(&Evln, ratio);
+
+    for (k=0; k<C.N; k++)
+      fprintf(fp,"%d,%g,mode,%d,,%.6e,%.6e,%d\n", c, Col->z[c], k,
+                 C.wr[k], C.wi[k], (k < C.M) ? 1 : 0);
+
+    for (i=0; i<C.N; i++)
+      fprintf(fp,"%d,%g,species,%d,%s,%.6e,%.6e,%.6e\n", c, Col->z[c], i,
+                 Chem->Species[i].name, C.ptr[i],
+                 (C.J[i][i] < 0.0) ? -1.0/C.J[i][i] : 0.0,
+                 Evln.NumDen[i]*Evln.Abn_Den);
+
+    nsel = nrat = 0;
+    for (r=0; r<C.NR; r++)
+    {
+      if (Chem->Reactions[r].use != 1) continue;
+      fprintf(fp,"%d,%g,reaction,%d,", c, Col->z[c], r);
+      WriteEquation(fp, Chem, r);
+      fprintf(fp,",%.6e,%.6e,%.6e\n", C.part[r], C.imp[r], ratio[r]);
+
+      if (MAX(C.part[r], C.imp[r]) > limit) nsel++;
+      if (ratio[r] > limit) nrat++;
+    }
+
+    nf = 0;
+    for (i=0; i<C.N; i++)
+      if (C.ptr[i] > 0.5) nf++;
+    ath_pout(0,"CSP: %d of %d modes exhausted (tau_fast=%e s, tau_slow=%e s)"
+               ", %d species with pointer > 0.5:", C.M, C.N, C.tauf, C.taus,
+               nf);
+    for (i=0; i<C.N; i++)
+      if (C.ptr[i] > 0.5) ath_pout(0," %s", Chem->Species[i].name);
+    ath_pout(0,"\nCSP: %d reactions with participation or importance > %g, "
+               "%d by reaction_ratio.\n", nsel, limit, nrat);
+  }
+
+  if (ferror(fp))
+    ath_error("[csp_analysis]: Error writing %s!\n",fname);
+  fclose(fp);
+  ath_pout(0,"CSP analysis of %d cells written to %s.\n", Col->nz, fname);
+  free(fname);
+
+  final_csp(&C);
+  free_1d_array(tol);
+  free_1d_array(flux);
+  free_1d_array(ratio);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Allocate the CSP data of a chemistry model
+ */
+void init_csp(Chemistry *Chem, ChemCSP *C)
+{
+  int N = Chem->Ntot, NR = MAX(Chem->NReaction,1);
+
+  C->N  = N;
+  C->NR = Chem->NReaction;
+  C->M  = 0;
+  C->tauf = C->taus = 0.0;
+
+  C->wr   = (Real*)calloc_1d_array(N, sizeof(Real));
+  C->wi   = (Real*)calloc_1d_array(N, sizeof(Real));
+  C->A    = (Real**)calloc_2d_array(N, N, sizeof(Real));
+  C->B    = (Real**)calloc_2d_array(N, N, sizeof(Real));
+  C->ptr  = (Real*)calloc_1d_array(N, sizeof(Real));
+  C->part = (Real*)calloc_1d_array(NR, sizeof(Real));
+  C->imp  = (Real*)calloc_1d_array(NR, sizeof(Real));
+
+  C->J    = (Real**)calloc_2d_array(N, N, sizeof(Real));
+  C->H    = (Real**)calloc_2d_array(N+1, N+1, sizeof(Real));
+  C->W    = (Real**)calloc_2d_array(2*N, 2*N, sizeof(Real));
+  C->beta = (Real**)calloc_2d_array(N, NR, sizeof(Real));
+  C->g    = (Real*)calloc_1d_array(N, sizeof(Real));
+  C->f    = (Real*)calloc_1d_array(N, sizeof(Real));
+  C->df   = (Real*)calloc_1d_array(N, sizeof(Real));
+  C->gr   = (Real*)calloc_1d_array(N, sizeof(Real));
+  C->x    = (Real*)calloc_1d_array(2*N+1, sizeof(Real));
+  C->y    = (Real*)calloc_1d_array(2*N+1, sizeof(Real));
+  C->s    = (Real*)calloc_1d_array(NR, sizeof(Real));
+  C->ord  = (int*)calloc_1d_array(N, sizeof(int));
+  C->indx = (int*)calloc_1d_array(2*N, sizeof(int));
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Free the CSP data
+ */
+void final_csp(ChemCSP *C)
+{
+  free_1d_array(C->wr);
+  free_1d_array(C->wi);
+  free_2d_array(C->A);
+  free_2d_array(C->B);
+  free_1d_array(C->ptr);
+  free_1d_array(C->part);
+  free_1d_array(C->imp);
+
+  free_2d_array(C->J);
+  free_2d_array(C->H);
+  free_2d_array(C->W);
+  free_2d_array(C->beta);
+  free_1d_array(C->g);
+  free_1d_array(C->f);
+  free_1d_array(C->df);
+  free_1d_array(C->gr);
+  free_1d_array(C->x);
+  free_1d_array(C->y);
+  free_1d_array(C->s);
+  free_1d_array(C->ord);
+  free_1d_array(C->indx);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Modes of the Jacobian at the state of Evln, the exhausted ones for the
+ * relative tolerance rtol and the absolute tolerances tol[0..Ntot-1] (in
+ * number density), their basis vectors and the radical pointers. Returns the
+ * number M of exhausted modes, or -1 if the eigenvalues did not converge.
+ */
+int csp_modes(ChemEvln *Evln, Real rtol, Real *tol, ChemCSP *C)
+{
+  int i, j, k, c, m, Mmax, N = C->N;
+  Real tau, sum, err, rate, *n = Evln->NumDen;
+  EquationTerm *EqTerm;
+
+  C->M = 0;
+  C->tauf = C->taus = 0.0;
+  for (i=0; i<N; i++)
+    C->ptr[i] = 0.0;
+
+  jacobi(Evln, n, C->J);
+  derivs(Evln, n, C->g);
+
+  /* sum of |rates| of each species, for the rounding of g */
+  for (i=0; i<N; i++)
+  {
+    C->gr[i] = 0.0;
+    for (k=0; k<Evln->Chem->Equations[i].NTerm; k++)
+    {
+      EqTerm = &(Evln->Chem->Equations[i].EqTerm[k]);
+      rate = Evln->K[EqTerm->ind];
+      for (j=0; j<EqTerm->N; j++)
+        rate *= n[EqTerm->lab[j]];
+      C->gr[i] += fabs(rate);
+    }
+  }
+
+/* Eigenvalues, fastest first */
+
+  for (i=0; i<N; i++)
+    for (j=0; j<N; j++)
+      C->H[i+1][j+1] = C->J[i][j];
+  Balance(C->H, N);
+  Hessenberg(C->H, N);
+  if (HessQR(C->H, N, C->x, C->y) != 0)
+  {
+    ath_pout(0,"[csp_modes]: the eigenvalues did not converge!\n");
+    for (k=0; k<N; k++)
+      C->wr[k] = C->wi[k] = 0.0;
+    return -1;
+  }
+
+  /* insertion sort; the two modes of a complex pair stay adjacent */
+  for (k=0; k<N; k++)
+  {
+    for (j=k; (j>0) && Faster(C->x[k+1],C->y[k+1],
+                  C->x[C->ord[j-1]],C->y[C->ord[j-1]]); j--)
+      C->ord[j] = C->ord[j-1];
+    C->ord[j] = k+1;
+  }
+  for (k=0; k<N; k++) {
+    C->wr[k] = C->x[C->ord[k]];
+    C->wi[k] = C->y[C->ord[k]];
+  }
+
+/* Candidates: decaying modes faster than the time reached */
+
+  Mmax = 0;
+  while ((Mmax < N-1) && (C->wr[Mmax] < 0.0) &&
+         (hypot(C->wr[Mmax],C->wi[Mmax])*Evln->t > 1.0))
+    Mmax++;
+  while ((Mmax > 0) && ((C->wi[Mmax-1] > 0.0) || Cluster(C, Mmax)))
+    Mmax--;
+
+  for (k=0, c=0; k<Mmax; k++)
+  {
+    if (!Cluster(C, k)) c = k;
+    if (C->wi[k] == 0.0) {
+      InvIter(C, C->wr[k], 0.0, 0, C->A[k], NULL, &(C->A[c]), k-c);
+      InvIter(C, C->wr[k], 0.0, 1, C->B[k], NULL, &(C->B[c]), k-c);
+    }
+    else {
+      InvIter(C, C->wr[k], C->wi[k], 0, C->A[k], C->A[k+1], NULL, 0);
+      InvIter(C, C->wr[k], C->wi[k], 1, C->B[k], C->B[k+1], NULL, 0);
+      k++;
+    }
+  }
+
+/* Exhausted modes: the leading ones within the tolerance */
+
+  for (m=1; m<=Mmax; m++)
+  {
+    if ((C->wi[m-1] > 0.0) || Cluster(C, m))   /* inside a pair/cluster */
+      continue;
+
+    FastBasis(C, m);
+    tau = 1.0/hypot(C->wr[m], C->wi[m]);
+    for (i=0; i<N; i++)
+    {
+      sum = err = 0.0;
+      for (k=0; k<m; k++) {
+        sum += C->A[k][i]*C->f[k];
+        err += fabs(C->A[k][i]*C->df[k]);
+      }
+      if (tau*(fabs(sum) - err) >= rtol*fabs(n[i]) + tol[i]) break;
+    }
+    if (i < N) break;
+
+    C->M = m;
+  }
+
+/* Left basis vectors with B A = I, and the pointers */
+
+  if (C->M > 0)
+  {
+    FastBasis(C, C->M);
+    for (i=0; i<N; i++)
+    {
+      for (k=0; k<C->M; k++)
+        C->f[k] = C->B[k][i];
+      lubksb(C->W, C->M, C->indx, C->f);
+      for (k=0; k<C->M; k++)
+        C->B[k][i] = C->f[k];
+    }
+
+    for (i=0; i<N; i++)
+      for (k=0; k<C->M; k++)
+        C->ptr[i] += C->A[k][i]*C->B[k][i];
+
+    C->tauf = 1.0/hypot(C->wr[C->M-1], C->wi[C->M-1]);
+  }
+  if (C->M < N)
+    C->taus = 1.0/MAX(hypot(C->wr[C->M], C->wi[C->M]), TINY_NUMBER);
+
+  return C->M;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Participation and importance indices of all reactions for the rates flux
+ * (see reaction_flux()) and the fast modes found by csp_modes()
+ */
+void csp_indices(ChemEvln *Evln, Real *flux, ChemCSP *C)
+{
+  int i, k, l, r, M = C->M;
+  Real sum;
+  EquationTerm *EqTerm;
+  Chemistry *Chem = Evln->Chem;
+
+  for (r=0; r<C->NR; r++) {
+    C->part[r] = C->imp[r] = C->s[r] = 0.0;
+    for (k=0; k<M; k++)
+      C->beta[k][r] = 0.0;
+  }
+
+  /* beta[k][r] = b^k S_r */
+  for (i=0; i<C->N; i++)
+    for (l=0; l<Chem->Equations[i].NTerm; l++)
+    {
+      EqTerm = &(Chem->Equations[i].EqTerm[l]);
+      for (k=0; k<M; k++)
+        C->beta[k][EqTerm->ind] += C->B[k][i]*EqTerm->dir;
+    }
+
+  for (k=0; k<M; k++)
+  {
+    sum = 0.0;
+    for (r=0; r<C->NR; r++)
+      sum += fabs(C->beta[k][r])*flux[r];
+    if (sum > 0.0)
+      for (r=0; r<C->NR; r++)
+        C->part[r] = MAX(C->part[r], fabs(C->beta[k][r])*flux[r]/sum);
+  }
+
+  /* s[r] = ((1-Q) S_r)_i for each slow species */
+  for (i=0; i<C->N; i++)
+  {
+    if (C->ptr[i] >= 0.5) continue;
+
+    for (l=0; l<Chem->Equations[i].NTerm; l++)
+    {
+      EqTerm = &(Chem->Equations[i].EqTerm[l]);
+      C->s[EqTerm->ind] += EqTerm->dir;
+    }
+
+    sum = 0.0;
+    for (r=0; r<C->NR; r++)
+    {
+      for (k=0; k<M; k++)
+        C->s[r] -= C->A[k][i]*C->beta[k][r];
+      C->s[r] = fabs(C->s[r])*flux[r];
+      sum += C->s[r];
+    }
+
+    for (r=0; r<C->NR; r++)
+    {
+      if (sum > 0.0)
+        C->imp[r] = MAX(C->imp[r], C->s[r]/sum);
+      C->s[r] = 0.0;
+    }
+  }
+
+  return;
+}
+
+/*============================================================================*/
+/*----------------------------- Private Functions ----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Balance a[1..n][1..n] by similarity transforms with powers of 2, so that
+ * the norms of each row and its column are of the same order (the densities
+ * of the species span many decades)
+ */
+void Balance(Real **a, int n)
+{
+  int i, j, done = 0;
+  Real c, r, f, g, s;
+
+  while (!done)
+  {
+    done = 1;
+    for (i=1; i<=n; i++)
+    {
+      c = r = 0.0;
+      for (j=1; j<=n; j++)
+        if (j != i) {
+          c += fabs(a[j][i]);
+          r += fabs(a[i][j]);
+        }
+      if ((c == 0.0) || (r == 0.0)) continue;
+
+      g = r/2.0;
+      f = 1.0;
+      s = c + r;
+      while (c < g) {
+        f *= 2.0;
+        c *= 4.0;
+      }
+      g = r*2.0;
+      while (c > g) {
+        f /= 2.0;
+        c /= 4.0;
+      }
+
+      if ((c + r)/f < 0.95*s)
+      {
+        done = 0;
+        for (j=1; j<=n; j++) a[i][j] /= f;
+        for (j=1; j<=n; j++) a[j][i] *= f;
+      }
+    }
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Reduce a[1..n][1..n] to upper Hessenberg form by elimination with
+ * pivoting; the elements below the subdiagonal are set to zero
+ */
+void Hessenberg(Real **a, int n)
+{
+  int i, j, m;
+  Real x, y;
+
+  for (m=2; m<n; m++)
+  {
+    x = 0.0;
+    i = m;
+    for (j=m; j<=n; j++)
+      if (fabs(a[j][m-1]) > fabs(x)) {
+        x = a[j][m-1];
+        i = j;
+      }
+
+    if (i != m) {
+      for (j=m-1; j<=n; j++) {
+        y = a[i][j];  a[i][j] = a[m][j];  a[m][j] = y;
+      }
+      for (j=1; j<=n; j++) {
+        y = a[j][i];  a[j][i] = a[j][m];  a[j][m] = y;
+      }
+    }
+
+    if (x != 0.0)
+      for (i=m+1; i<=n; i++)
+        if ((y = a[i][m-1]) != 0.0)
+        {
+          y /= x;
+          for (j=m; j<=n; j++) a[i][j] -= y*a[m][j];
+          for (j=1; j<=n; j++) a[j][m] += y*a[j][i];
+        }
+  }
+
+  for (i=3; i<=n; i++)
+    for (j=1; j<i-1; j++)
+      a[i][j] = 0.0;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Eigenvalues wr[1..n] + i wi[1..n] of the upper Hessenberg matrix
+ * a[1..n][1..n] (destroyed) by the shifted QR iteration; the two values of a
+ * complex pair have the same real part and opposite imaginary parts. Returns
+ * 0 on success, 1 if an eigenvalue did not converge.
+ */
+int HessQR(Real **a, int n, Real *wr, Real *wi)
+{
+  int nn, m, l, k, j, its, i, mmin;
+  Real z, y, x, w, v, u, t, s, r, q, p, anorm;
+
+  p = q = r = 0.0;
+  anorm = 0.0;
+  for (i=1; i<=n; i++)
+    for (j=MAX(i-1,1); j<=n; j++)
+      anorm += fabs(a[i][j]);
+
+  nn = n;
+  t = 0.0;
+  while (nn >= 1)
+  {
+    its = 0;
+    do {
+      /* look for a single small subdiagonal element */
+      for (l=nn; l>=2; l--) {
+        s = fabs(a[l-1][l-1]) + fabs(a[l][l]);
+        if (s == 0.0) s = anorm;
+        if ((Real)(fabs(a[l][l-1]) + s) == s) {
+          a[l][l-1] = 0.0;
+          break;
+        }
+      }
+
+      x = a[nn][nn];
+      if (l == nn)
+      {/* one root */
+        wr[nn] = x + t;
+        wi[nn--] = 0.0;
+      }
+      else
+      {
+        y = a[nn-1][nn-1];
+        w = a[nn][nn-1]*a[nn-1][nn];
+        if (l == nn-1)
+        {/* two roots */
+          p = 0.5*(y - x);
+          q = p*p + w;
+          z = sqrt(fabs(q));
+          x += t;
+          if (q >= 0.0) {
+            z = p + fabs(z)*SIGN(p);
+            wr[nn-1] = wr[nn] = x + z;
+            if (z != 0.0) wr[nn] = x - w/z;
+            wi[nn-1] = wi[nn] = 0.0;
+          }
+          else {
+            wr[nn-1] = wr[nn] = x + p;
+            wi[nn-1] = -(wi[nn] = z);
+          }
+          nn -= 2;
+        }
+        else
+        {/* no root yet: double-shift QR step */
+          if (its == CSP_MAXIT) return 1;
+          if ((its == 10) || (its == 20)) {     /* exceptional shift */
+            t += x;
+            for (i=1; i<=nn; i++) a[i][i] -= x;
+            s = fabs(a[nn][nn-1]) + fabs(a[nn-1][nn-2]);
+            y = x = 0.75*s;
+            w = -0.4375*s*s;
+          }
+          ++its;
+
+          for (m=nn-2; m>=l; m--) {
+            z = a[m][m];
+            r = x - z;
+            s = y - z;
+            p = (r*s - w)/a[m+1][m] + a[m][m+1];
+            q = a[m+1][m+1] - z - r - s;
+            r = a[m+2][m+1];
+            s = fabs(p) + fabs(q) + fabs(r);
+            p /= s;
+            q /= s;
+            r /= s;
+            if (m == l) break;
+            u = fabs(a[m][m-1])*(fabs(q) + fabs(r));
+            v = fabs(p)*(fabs(a[m-1][m-1]) + fabs(z) + fabs(a[m+1][m+1]));
+            if ((Real)(u + v) == v) break;
+          }
+
+          for (i=m+2; i<=nn; i++) {
+            a[i][i-2] = 0.0;
+            if (i != m+2) a[i][i-3] = 0.0;
+          }
+
+          for (k=m; k<=nn-1; k++)
+          {
+            if (k != m) {
+              p = a[k][k-1];
+              q = a[k+1][k-1];
+              r = 0.0;
+              if (k != nn-1) r = a[k+2][k-1];
+              if ((x = fabs(p) + fabs(q) + fabs(r)) != 0.0) {
+                p /= x;
+                q /= x;
+                r /= x;
+              }
+            }
+
+            s = sqrt(p*p + q*q + r*r)*SIGN(p);
+            if (s != 0.0)
+            {
+              if (k == m) {
+                if (l != m) a[k][k-1] = -a[k][k-1];
+              }
+              else
+                a[k][k-1] = -s*x;
+              p += s;
+              x = p/s;
+              y = q/s;
+              z = r/s;
+              q /= p;
+              r /= p;
+              for (j=k; j<=nn; j++) {
+                p = a[k][j] + q*a[k+1][j];
+                if (k != nn-1) {
+                  p += r*a[k+2][j];
+                  a[k+2][j] -= p*z;
+                }
+                a[k+1][j] -= p*y;
+                a[k][j] -= p*x;
+              }
+              mmin = (nn < k+3) ? nn : k+3;
+              for (i=l; i<=mmin; i++) {
+                p = x*a[i][k] + y*a[i][k+1];
+                if (k != nn-1) {
+                  p += z*a[i][k+2];
+                  a[i][k+2] -= p*r;
+                }
+                a[i][k+1] -= p*q;
+                a[i][k] -= p;
+              }
+            }
+          }
+        }
+      }
+    } while (l < nn-1);
+  }
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Whether the eigenvalue re1 + i im1 comes before re2 + i im2: larger
+ * modulus first, and of a complex pair the one with Im > 0
+ */
+int Faster(Real re1, Real im1, Real re2, Real im2)
+{
+  Real m1 = hypot(re1, im1), m2 = hypot(re2, im2);
+
+  if (m1 != m2) return (m1 > m2);
+  return (im1 > im2);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Whether mode k has the same eigenvalue as mode k-1, to CSP_CLUS
+ */
+int Cluster(ChemCSP *C, int k)
+{
+  if ((k <= 0) || (k >= C->N)) return 0;
+
+  return (hypot(C->wr[k]-C->wr[k-1], C->wi[k]-C->wi[k-1])
+          <= CSP_CLUS*hypot(C->wr[k], C->wi[k]));
+}
+
+/*----------------------------------------------------------------------------*/
+/* Right (trans=0) or left (trans=1) eigenvector of J for the eigenvalue
+ * re + i im, by inverse iteration, normalized to unit length and orthogonal
+ * to the np real vectors prev[0..np-1] of the same eigenvalue. For a complex
+ * eigenvalue the real and imaginary parts go into u and v; the complex
+ * system is solved in real form,
+ *
+ *   | J-re  im   | |u|   |u0|
+ *   | -im   J-re | |v| = |v0|
+ */
+void InvIter(ChemCSP *C, Real re, Real im, int trans, Real *u, Real *v,
+             Real **prev, int np)
+{
+  int i, j, it, N = C->N, n = (im != 0.0) ? 2*N : N;
+  Real d, nrm, dot, shift;
+
+  /* a small shift keeps the system regular */
+  shift = re*(1.0 + 1.0e-10);
+
+  for (i=0; i<n; i++)
+    for (j=0; j<n; j++)
+      C->W[i][j] = 0.0;
+  for (i=0; i<N; i++)
+    for (j=0; j<N; j++)
+    {
+      C->W[i][j] = trans ? C->J[j][i] : C->J[i][j];
+      if (n > N) C->W[i+N][j+N] = C->W[i][j];
+    }
+  for (i=0; i<N; i++)
+  {
+    C->W[i][i] -= shift;
+    if (n > N) {
+      C->W[i+N][i+N] -= shift;
+      C->W[i][i+N] = im;
+      C->W[i+N][i] = -im;
+    }
+  }
+
+  ludcmp(C->W, n, C->indx, &d);
+
+  for (i=0; i<n; i++)
+    C->x[i] = 1.0 + (Real)i/n;
+  for (it=0; it<CSP_NINV; it++)
+  {
+    lubksb(C->W, n, C->indx, C->x);
+    for (j=0; j<np; j++) {
+      dot = 0.0;
+      for (i=0; i<N; i++) dot += prev[j][i]*C->x[i];
+      for (i=0; i<N; i++) C->x[i] -= dot*prev[j][i];
+    }
+    nrm = 0.0;
+    for (i=0; i<n; i++)
+      nrm += SQR(C->x[i]);
+    nrm = sqrt(nrm);
+    for (i=0; i<n; i++)
+      C->x[i] /= MAX(nrm, TINY_NUMBER);
+  }
+
+  for (i=0; i<N; i++)
+  {
+    u[i] = C->x[i];
+    if (v != NULL) v[i] = C->x[i+N];
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Factor B A (in W, indx) for the m fastest modes and solve for their
+ * amplitudes f = (B A)^-1 B g, and their rounding errors df (the same with
+ * |B| and CSP_EPS times the sums of |rates|)
+ */
+void FastBasis(ChemCSP *C, int m)
+{
+  int i, k, l;
+  Real d, sum;
+
+  for (k=0; k<m; k++)
+  {
+    for (l=0; l<m; l++) {
+      sum = 0.0;
+      for (i=0; i<C->N; i++)
+        sum += C->B[k][i]*C->A[l][i];
+      C->W[k][l] = sum;
+    }
+
+    C->f[k] = C->df[k] = 0.0;
+    for (i=0; i<C->N; i++) {
+      C->f[k]  += C->B[k][i]*C->g[i];
+      C->df[k] += fabs(C->B[k][i])*C->gr[i]*CSP_EPS;
+    }
+  }
+
+  ludcmp(C->W, m, C->indx, &d);
+  lubksb(C->W, m, C->indx, C->f);
+  lubksb(C->W, m, C->indx, C->df);
+  for (k=0; k<m; k++)
+    C->df[k] = fabs(C->df[k]);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Write the equation of reaction r, "A + B -> C + D"
+ */
+void WriteEquation(FILE *fp, Chemistry *Chem, int r)
+{
+  int l, p;
+  char *sep = "";
+  ReactionInfo *R = &(Chem->Reactions[r]);
+
+  for (l=0; l<2; l++)
+    if ((p = R->reactant[l]) >= 0) {
+      fprintf(fp,"%s%s", sep, Chem->Species[p].name);
+      sep = " + ";
+    }
+  fprintf(fp," ->");
+  sep = " ";
+  for (l=0; l<4; l++)
+    if ((p = R->product[l]) >= 0) {
+      fprintf(fp,"%s%s", sep, Chem->Species[p].name);
+      sep = " + ";
+    }
+
+  return;
+}
+
+#undef CSP_MAXIT
+#undef CSP_NINV
+#undef CSP_CLUS
+#undef CSP_EPS
+
+#endif /* CHEMISTRY */
@@ -9,6 +9,8 @@
  *   init_numberden()  - calculate the initial number densities
  *   reset_numberden() - scale the number density to new densities
  *   denscale()        - calculate the number density variation scale
+ *   abstol_species()  - absolute tolerance of the solver for each species
+ *   initial_species() - mark the species present in the initial condition
  *
  * REFERENCES:
  *   Bai, X.-N. & Goodman, J., 2009, ApJ, 701, 737
@@ -42,9 +44,9 @@
 void init_numberden(ChemEvln *Evln, Real rho, int verbose)
 {
 
-  FILE *fp;
+  InputFile in;
   Real sum = 0.0;
-  char line[MAXLEN],fname[20],name[NL_SPE];
+  char *fname,name[NL_SPE];
   Chemistry   *Chem = Evln->Chem;
   ElementInfo *Ele  = Chem->Elements;
   SpeciesInfo *Spe;
@@ -76,26 +78,27 @@ void init_numberden(ChemEvln *Evln, Real rho, int verbose)
     for (i=0; i<Chem->N_Ele_tot; i++)
       Chem->Elements[i].abundance = 0.0;
 
-    sprintf(fname,"%s",par_gets("job","init_abundance"));
-    fp = fopen(fname,"r");
-    if(fp == NULL){
+    fname = par_gets("job","init_abundance");
+    if (open_input(&in, fname) != 0){
       ath_perr(-1,"[construct_species]: Unable to open the inital abundance file!\n");
       return;
     }
   
-    fgets(line,MAXLEN,fp);
+    input_skipline(&in);
 		/* N is total number of initial species */
-    fscanf(fp, "%d\n", &N);
+    N = input_int(&in, "number of species");
+    input_skipws(&in);
     if (N <= 0)
       ath_error("[density]: # of species with initial abundance must be positive!\n");
-    fgets(line,MAXLEN,fp);
+    input_skipline(&in);
     for (i=0; i<N; i++)
     {
-      fscanf(fp, "%s", name);
-      fscanf(fp, "%lf\n",&abun);
-      for (p=1;p<Chem->Ntot;p++) {
-    if(strcmp(Chem->Species[p].name, name)==0)
-  {
+      input_word(&in, name, NL_SPE, "a species name");
+      abun = input_real(&in, "abundance");
+      input_skipws(&in);
+      p = FindSpecies(Chem, name);
+      if (p > 0)  /* electron density is set by charge neutrality */
+      {
 /* calculate species relative abundance */
           Evln->NumDen[p] = abun;
           Spe = &(Chem->Species[p]);
@@ -103,10 +106,10 @@ void init_numberden(ChemEvln *Evln, Real rho, int verbose)
         /* calculate element abundance */
          for (j=0; j<Chem->N_Ele_tot; j++)
           Chem->Elements[j].abundance += abun*MAX(Spe->composition[j],0);
-       break;
       }
-      }// end loop for p
   }/* end iteration for i over all input species */
+  close_input(&in);
+  free(fname);
 
   /* Calculate the relative charge density */
   for (i=0; i<Chem->Ntot; i++)
@@ -260,4 +263,106 @@ void denscale(ChemEvln *Evln, int vb)
 }
 
 
+/*----------------------------------------------------------------------------*/
+/* Absolute tolerance of the solver for each species, tol[0..Ntot-1]
+ * mode: 0 - the same value atol for all species
+ *       1 - rel times the density variation scale DenScale (see denscale)
+ *       2 - rel times the maximum density allowed by the element abundances
+ *           (for e-, the smallest one of all species: the electrons are
+ *           usually much less abundant than the main carrier of H)
+ * In modes 1 and 2 atol is a floor.
+ */
+void abstol_species(ChemEvln *Evln, int mode, Real rel, Real atol, Real *tol)
+{
+  int i, j;
+  Real den, denmin, denmint = 0.0;
+  Chemistry *Chem = Evln->Chem;
+
+  for (i=0; i<Chem->Ntot; i++)
+    tol[i] = atol;
+
+  if (mode == 1)
+  {
+    for (i=0; i<Chem->Ntot; i++)
+      tol[i] = MAX(rel*Evln->DenScale[i], atol);
+  }
+  else if (mode == 2)
+  {
+    for (i=1; i<Chem->Ntot; i++) /* exclude electron */
+    {
+      denmin = 0.0;
+      for (j=0; j<Chem->N_Ele + Chem->NGrain; j++)
+        if (Chem->Species[i].composition[j] > 0)
+        {
+          den = Chem->Elements[j].abundance
+                /(Evln->Abn_Den*Chem->Species[i].composition[j]);
+          if ((denmin == 0.0) || (den < denmin))
+            denmin = den;
+        }
+
+      tol[i] = MAX(rel*denmin, atol);
+      if ((denmin > 0.0) && ((denmint == 0.0) || (denmin < denmint)))
+        denmint = denmin;
+    }
+
+    tol[0] = MAX(rel*denmint, atol);
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Mark the species with a nonzero initial number density (pop[i]=1), as set
+ * by init_numberden: the electron, the first single-element species of every
+ * element and grain type, or the species listed in job/init_abundance if
+ * problem/initcond>0 (grains are initialized in both cases).
+ */
+void initial_species(Chemistry *Chem, int *pop)
+{
+  InputFile in;
+  char *fname, name[NL_SPE];
+  int i, p, N, initcond;
+  Real abun;
+
+  initcond = par_getd_def("problem","initcond", 0);
+
+  for (i=0; i<Chem->Ntot; i++)
+    pop[i] = 0;
+
+  pop[0] = 1;   /* electron */
+
+  for (i=Chem->N_Ele; i<Chem->N_Ele+Chem->NGrain; i++)
+    pop[Chem->Elements[i].single[0]] = 1;
+
+  if (initcond > 0)
+  {
+    fname = par_gets("job","init_abundance");
+    if (open_input(&in, fname) != 0)
+      ath_error("[initial_species]: Unable to open the inital abundance file!\n");
+
+    input_skipline(&in);
+    N = input_int(&in, "number of species");
+    input_skipws(&in);
+    input_skipline(&in);
+    for (i=0; i<N; i++)
+    {
+      input_word(&in, name, NL_SPE, "a species name");
+      abun = input_real(&in, "abundance");
+      input_skipws(&in);
+      p = FindSpecies(Chem, name);
+      if ((p > 0) && (abun > 0.0))
+        pop[p] = 1;
+    }
+    close_input(&in);
+    free(fname);
+  }
+  else
+  {
+    for (i=0; i<Chem->N_Ele; i++)
+      pop[Chem->Elements[i].single[0]] = 1;
+  }
+
+  return;
+}
+
 #endif /* CHEMISTRY */
@@ -7,6 +7,8 @@
  *
  * CONTAINS PUBLIC FUNCTIONS:
  *   Cal_NIMHD()       - calculate the magnetic diffusivities
+ *   Cal_etasens()     - logarithmic derivatives of the diffusivities with
+ *                       respect to the number density of each species
  *   Cal_recomb()      - calculate the recombination time
  *
  * REFERENCES:
@@ -28,9 +30,14 @@
 
 /*==============================================================================
  * PRIVATE FUNCTION PROTOTYPES:
- *   There is no private function.
+ *   CondTerm()  - contribution of one species to the conductivities
+ *   LumpCond()  - contribution of the lumped grains (see grain_lump.c)
  *============================================================================*/
 
+void CondTerm(ChemEvln *Evln, int i, int q, Real n, Real *sO, Real *sH,
+              Real *sP);
+void LumpCond(ChemEvln *Evln, Real *sO, Real *sH, Real *sP);
+
 /*============================================================================*/
 /*---------------------------- Public Functions ------------------------------*/
 
@@ -43,18 +50,12 @@
  */
 void Cal_NIMHD(ChemEvln *Evln)
 {
-  int i, j, k;
+  int i;
   Chemistry *Chem = Evln->Chem;
 
-  Real pre, n15, mratio, mu, rate, beta;
+  Real sO, sH, sP;
   Real sig_O, sig_H, sig_P, sig_perp;
 
-  SpeciesInfo *Spe;
-
-  /* preliminaries */
-  n15 = Evln->rho/(MUN * 1.672e-9); /*  n / 10^15 cm^(-3)    */
-  pre = 14.4 / Evln->B;             /*  ec / B               */
-
   /* calculate the conductivities */
 
   sig_O = 0.0;
@@ -63,36 +64,26 @@ void Cal_NIMHD(ChemEvln *Evln)
 
   for (i=0; i<Chem->Ntot; i++)
   {
-    Spe = &(Chem->Species[i]);
-
-    if (Spe->charge != 0)
+    if (Chem->Species[i].charge != 0)
     {
-      if (i == 0)
-      { /* electron */
-        rate = 8.3e-9 * MAX(1.0,sqrt(Evln->T/100.0));
-      }
-      else if (i < Chem->GrInd)
-      { /* ions */
-        mu = MUN * Spe->mass/(MUN + Spe->mass);
-
-        rate = 2.0e-9 * sqrt(1.0/mu);
-      }
-      else
-      { /* grains */
-        rate = MAX(1.3e-9*fabs(Spe->charge),
-                   4.0e-3*SQR(Spe->gsize)*sqrt(Evln->T/100.0));
-//                 1.6e-7*SQR(Spe->gsize)*sqrt(Evln->T/100.0));
-      }
-
-      mratio = (MUN+Spe->mass)/Spe->mass;
-      beta = (9.59e-12 / (rate * n15)) * (Spe->charge * Evln->B / MUN) * mratio;
-
-      sig_O += pre * Evln->NumDen[i] * Spe->charge * beta;
-      sig_H += pre * Evln->NumDen[i] * Spe->charge / (1.0 + SQR(beta));
-      sig_P += pre * Evln->NumDen[i] * Spe->charge * beta / (1.0 + SQR(beta));
+      CondTerm(Evln, i, Chem->Species[i].charge, Evln->NumDen[i],
+               &sO, &sH, &sP);
+
+      sig_O += sO;
+      sig_H += sH;
+      sig_P += sP;
     }
   }
 
+  if (Chem->GrLump)
+  {
+    LumpCond(Evln, &sO, &sH, &sP);
+
+    sig_O += sO;
+    sig_H += sH;
+    sig_P += sP;
+  }
+
 //fprintf(stderr,"sigO=%e,sigH=%e,sigP=%e\n",sig_O,sig_H,sig_P);
 
   /* calculate the diffusivities */
@@ -106,6 +97,66 @@ void Cal_NIMHD(ChemEvln *Evln)
   return;
 }
 
+/*----------------------------------------------------------------------------*/
+/* Derivatives d ln(eta)/d ln(n_i) of the Ohmic, Hall and ambipolar
+ * diffusivities with respect to the number density of each species i at the
+ * current state of Evln (arrays of Ntot, zero for neutral species). Also sets
+ * eta_O, eta_H and eta_A. eta_H changes sign with B and density, so its
+ * derivative is taken relative to eta_perp = sqrt(eta_H^2 + (eta_O+eta_A)^2)
+ * instead of eta_H itself.
+ */
+void Cal_etasens(ChemEvln *Evln, Real *dO, Real *dH, Real *dA)
+{
+  int i;
+  Chemistry *Chem = Evln->Chem;
+  Real sO, sH, sP, sig_O, sig_H, sig_P, sig2, dsig2, deta;
+
+  Cal_NIMHD(Evln);
+
+  sig_O = 0.0;
+  sig_H = 0.0;
+  sig_P = 0.0;
+  for (i=0; i<Chem->Ntot; i++)
+    if (Chem->Species[i].charge != 0) {
+      CondTerm(Evln, i, Chem->Species[i].charge, Evln->NumDen[i],
+               &sO, &sH, &sP);
+      sig_O += sO;
+      sig_H += sH;
+      sig_P += sP;
+    }
+  if (Chem->GrLump) {
+    LumpCond(Evln, &sO, &sH, &sP);
+    sig_O += sO;
+    sig_H += sH;
+    sig_P += sP;
+  }
+  sig2 = SQR(sig_H) + SQR(sig_P);
+
+  /* each conductivity is linear in n_i: d sig/d ln(n_i) = term of i */
+  for (i=0; i<Chem->Ntot; i++)
+  {
+    dO[i] = dH[i] = dA[i] = 0.0;
+    if (Chem->Species[i].charge == 0) continue;
+
+    CondTerm(Evln, i, Chem->Species[i].charge, Evln->NumDen[i],
+             &sO, &sH, &sP);
+    dsig2 = 2.0*(sig_H*sH + sig_P*sP);
+
+    /* eta_O = c/sig_O */
+    dO[i] = -sO/sig_O;
+
+    /* eta_H = c sig_H/sig_perp^2, relative to eta_perp = c/sig_perp */
+    dH[i] = (sH - sig_H*dsig2/sig2)/sqrt(sig2);
+
+    /* eta_A = c sig_P/sig_perp^2 - eta_O */
+    deta = 7.15e19 * (sP/sig2 - sig_P*dsig2/SQR(sig2))
+         - Evln->eta_O * dO[i];
+    dA[i] = deta/Evln->eta_A;
+  }
+
+  return;
+}
+
 /*----------------------------------------------------------------------------*/
 /* Calculate recombination time based on the rate of change of magnetic
  * diffusivities. The recombination time is calculated by:
@@ -167,5 +218,81 @@ void Cal_recomb(ChemEvln *Evln, Real Bmin, Real Bmax, int  nB,   Real Dt,
   return;
 }
 
+/*============================================================================*/
+/*----------------------------- Private Functions ----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Contribution of species i, with the charge q and number density n, to the
+ * Ohmic (sO), Hall (sH) and Pedersen (sP) conductivities
+ */
+void CondTerm(ChemEvln *Evln, int i, int q, Real n, Real *sO, Real *sH,
+              Real *sP)
+{
+  Chemistry *Chem = Evln->Chem;
+  Real pre, n15, mratio, mu, rate, beta;
+  SpeciesInfo *Spe = &(Chem->Species[i]);
+
+  /* preliminaries */
+  n15 = Evln->rho/(MUN * 1.672e-9); /*  n / 10^15 cm^(-3)    */
+  pre = 14.4 / Evln->B;             /*  ec / B               */
+
+  if (i == 0)
+  { /* electron */
+    rate = 8.3e-9 * MAX(1.0,sqrt(Evln->T/100.0));
+  }
+  else if (i < Chem->GrInd)
+  { /* ions */
+    mu = MUN * Spe->mass/(MUN + Spe->mass);
+
+    rate = 2.0e-9 * sqrt(1.0/mu);
+  }
+  else
+  { /* grains */
+    rate = MAX(1.3e-9*fabs(q),
+               4.0e-3*SQR(Spe->gsize)*sqrt(Evln->T/100.0));
+//             1.6e-7*SQR(Spe->gsize)*sqrt(Evln->T/100.0));
+  }
+
+  mratio = (MUN+Spe->mass)/Spe->mass;
+  beta = (9.59e-12 / (rate * n15)) * (q * Evln->B / MUN) * mratio;
+
+  *sO = pre * n * q * beta;
+  *sH = pre * n * q / (1.0 + SQR(beta));
+  *sP = pre * n * q * beta / (1.0 + SQR(beta));
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Contribution of the charge states of the lumped grain species, from their
+ * charge distributions Evln->GrDist
+ */
+void LumpCond(ChemEvln *Evln, Real *sO, Real *sH, Real *sP)
+{
+  int k, Z, i, LS;
+  Real p, tO, tH, tP;
+  Chemistry *Chem = Evln->Chem;
+
+  LS = 2*Chem->GrZmax+1;
+  *sO = *sH = *sP = 0.0;
+
+  for (k=0; k<Chem->NGrain; k++)
+  {
+    i = Chem->GrInd + k;
+    for (Z=-Chem->GrZmax; Z<=Chem->GrZmax; Z++)
+    {
+      p = Evln->GrDist[k*LS+Z+Chem->GrZmax];
+      if ((Z == 0) || (p <= 0.0)) continue;
+
+      CondTerm(Evln, i, Z, p*Evln->NumDen[i], &tO, &tH, &tP);
+      *sO += tO;
+      *sH += tH;
+      *sP += tP;
+    }
+  }
+
+  return;
+}
+
 #endif /* CHEMISTRY */
 
@@ -9,12 +9,17 @@
  *
  * CONTAINS PUBLIC FUNCTIONS:
  *  - init_disk()         - read disk parameters
+ *  - XrayFit_disk()      - X-ray ionization fitting coefficients for Tx
  *  - Ionization_disk()   - calculate the ionization rate
+ *  - Ionization_disk1()  - ionization rate at a given column density
+ *  - Ionization_column() - ionization rate for a set of column densities
  *  - SurfDen_disk()      - disk surface density
  *  - Temp_disk()         - disk temperature
  *  - Height_disk()       - disk scale height
  *  - Rho_disk()          - mass density in the disk
  *  - SurfDenZ_disk()     - disk column density from the top
+ *  - SurfDenZ_column()   - column density from the top for a set of heights
+ *  - Av_disk()           - visual extinction from a given column density
  *
  * REFERENCES:
  *   Bai, X.-N. & Goodman, J., 2009, ApJ, 701, 737
@@ -69,19 +74,19 @@ void init_disk(Nebula *Disk)
   //Disk->RD_rate = par_getd_def("disk","RD_rate",7.0e-19);
   Disk->RD_rate = par_getd("disk","RD_rate");
 
+  XrayFit_disk(Disk);
+
   return;
 }
 
 /*----------------------------------------------------------------------------*/
-/* Obtain the ionization rate using a solar nebula model
- * Reference: Fromang et al. (2002), Igea & Glassgold (1999)
- *            fitting formula from Bai & Goodman (2009)
+/* Interpolate the X-ray ionization fitting coefficients to the source
+ * temperature Tx. They only depend on the disk parameters, and are stored in
+ * the Nebula structure by init_disk().
  */
-Real Ionization_disk(Nebula *Disk, Real radius, Real z)
+void XrayFit_disk(Nebula *Disk)
 {
-  Real sigma, sigmaz, nh1, nh2;
-  Real rate;
-  Real r1, col1, pow1, r2, col2, pow2, coef3, coef5, lnTx;
+  Real coef3, coef5, lnTx;
 
   /* fitting coefficients for Tx=3keV and Tx=5keV */
   Real r13,col13,pow13,r23,col23,pow23;
@@ -92,22 +97,6 @@ Real Ionization_disk(Nebula *Disk, Real radius, Real z)
   r15 = 2.0e-12;    col15 = 3.0e21;    pow15 = 0.50;
   r25 = 1.5e-15;    col25 = 1.0e24;    pow25 = 0.70;
 
-/*---------- Cosmic ray ionization rate ----------------
- */
-
-  /* disk column density */
-  sigma  = SurfDen_disk (Disk, radius);
-  sigmaz = SurfDenZ_disk(Disk, radius, z);
-
-  rate = Disk->CR_rate * (exp(-sigmaz/96.0) + exp(-(sigma-sigmaz)/96.0));
-
-/*---------- X-ray ionization rate ---------------------
- */
-
-  /* hydrogen column density (mean atomic weight = 1.425) */
-  nh1 =        sigmaz  * 6.02e23 / 1.425;
-  nh2 = (sigma-sigmaz) * 6.02e23 / 1.425;
-
   /* The following fitting formula applies for 1 < TX < 8 (keV) */
 
   if ((Disk->Tx < 1.0) || (Disk->Tx > 8.0))
@@ -118,25 +107,80 @@ Real Ionization_disk(Nebula *Disk, Real radius, Real z)
   coef3 = (log(5.0)-lnTx)/(log(5.0)-log(3.0));
   coef5 = (lnTx-log(3.0))/(log(5.0)-log(3.0));
 
-  r1   = exp(coef3*log(r13)   + coef5*log(r15));
-  col1 = exp(coef3*log(col13) + coef5*log(col15));
-  pow1 = exp(coef3*log(pow13) + coef5*log(pow15));
-  r2   = exp(coef3*log(r23)   + coef5*log(r25));
-  col2 = exp(coef3*log(col23) + coef5*log(col25));
-  pow2 = exp(coef3*log(pow23) + coef5*log(pow25));
+  Disk->xr1   = exp(coef3*log(r13)   + coef5*log(r15));
+  Disk->xcol1 = exp(coef3*log(col13) + coef5*log(col15));
+  Disk->xpow1 = exp(coef3*log(pow13) + coef5*log(pow15));
+  Disk->xr2   = exp(coef3*log(r23)   + coef5*log(r25));
+  Disk->xcol2 = exp(coef3*log(col23) + coef5*log(col25));
+  Disk->xpow2 = exp(coef3*log(pow23) + coef5*log(pow25));
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Obtain the ionization rate using a solar nebula model
+ * Reference: Fromang et al. (2002), Igea & Glassgold (1999)
+ *            fitting formula from Bai & Goodman (2009)
+ */
+Real Ionization_disk(Nebula *Disk, Real radius, Real z)
+{
+  Real sigmaz, rate;
+
+  sigmaz = SurfDenZ_disk(Disk, radius, z);
 
-  rate += 2.0*(Disk->Lx/1.0e29)*pow(radius,-2.2)
-          * (r1*(exp(-pow(nh1/col1,pow1)) + exp(-pow(nh2/col1,pow1)))
-           + r2*(exp(-pow(nh1/col2,pow2)) + exp(-pow(nh2/col2,pow2))));
+  Ionization_column(Disk, radius, 1, &sigmaz, &rate);
 
-/*---------- Radioactive decay ionization rate ---------------------
+  return rate;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Ionization rate at a given column density sigmaz (g/cm^2) from the top
  */
+Real Ionization_disk1(Nebula *Disk, Real radius, Real sigmaz)
+{
+  Real rate;
 
-  rate += Disk->RD_rate;
+  Ionization_column(Disk, radius, 1, &sigmaz, &rate);
 
   return rate;
 }
 
+/*----------------------------------------------------------------------------*/
+/* Ionization rate of nz cells with column densities sigz[0..nz-1] (g/cm^2)
+ * from the top at radius (AU). The radius dependent quantities are evaluated
+ * once, and the loop over cells has no branches or function calls other than
+ * exp/pow so that it can be vectorized.
+ */
+void Ionization_column(Nebula *Disk, Real radius, int nz, Real *sigz,
+                       Real *zeta)
+{
+  int i;
+  Real sigma, xpre, nh1, nh2;
+  Real CR = Disk->CR_rate, RD = Disk->RD_rate;
+  Real r1 = Disk->xr1, col1 = Disk->xcol1, pow1 = Disk->xpow1;
+  Real r2 = Disk->xr2, col2 = Disk->xcol2, pow2 = Disk->xpow2;
+
+  /* disk column density */
+  sigma = SurfDen_disk(Disk, radius);
+
+  /* X-ray flux at this radius */
+  xpre  = 2.0*(Disk->Lx/1.0e29)*pow(radius,-2.2);
+
+  for (i=0; i<nz; i++)
+  {
+    /* hydrogen column density (mean atomic weight = 1.425) */
+    nh1 =        sigz[i]  * 6.02e23 / 1.425;
+    nh2 = (sigma-sigz[i]) * 6.02e23 / 1.425;
+
+    /* cosmic ray + X-ray + radioactive decay ionization rate */
+    zeta[i] = CR * (exp(-sigz[i]/96.0) + exp(-(sigma-sigz[i])/96.0))
+            + xpre * (r1*(exp(-pow(nh1/col1,pow1)) + exp(-pow(nh2/col1,pow1)))
+                    + r2*(exp(-pow(nh1/col2,pow2)) + exp(-pow(nh2/col2,pow2))))
+            + RD;
+  }
+
+  return;
+}
 
 /*------------------------------------------------------------------------------
  * Disk surface density as a function of radius (AU)
@@ -231,67 +275,35 @@ Real SurfDenZ_disk(Nebula *Disk, Real radius, Real z)
   return 0.5 * sigma * (1.0 - Erf(z0/1.41421356));
 }
 
-
-
-/* ionization as a function of sigma and rho */
-Real Ionization_disk1(Nebula *Disk, Real radius, Real sigmaz)
-{
-  Real sigma,nh1, nh2;
-  Real rate;
-  Real r1, col1, pow1, r2, col2, pow2, coef3, coef5, lnTx;
-
-  /* fitting coefficients for Tx=3keV and Tx=5keV */
-  Real r13,col13,pow13,r23,col23,pow23;
-  Real r15,col15,pow15,r25,col25,pow25;
-
-  r13 = 3.0e-12;    col13 = 1.5e21;    pow13 = 0.40;
-  r23 = 0.5e-15;    col23 = 7.0e23;    pow23 = 0.65;
-  r15 = 2.0e-12;    col15 = 3.0e21;    pow15 = 0.50;
-  r25 = 1.5e-15;    col25 = 1.0e24;    pow25 = 0.70;
-
-/*---------- Cosmic ray ionization rate ----------------
- */
-
-  /* disk column density */
-  sigma  = SurfDen_disk (Disk, radius);
-
-  rate = Disk->CR_rate * (exp(-sigmaz/96.0) + exp(-(sigma-sigmaz)/96.0));
-
-/*---------- X-ray ionization rate ---------------------
+/*------------------------------------------------------------------------------
+ * Surface mass density from top to heights z[0..nz-1] (H) at radius (AU),
+ * evaluated in one pass (the total surface density is only computed once)
  */
+void SurfDenZ_column(Nebula *Disk, Real radius, int nz, Real *z, Real *sigz)
+{/* g/cm^2 */
 
-  /* hydrogen column density (mean atomic weight = 1.425) */
-  nh1 =        sigmaz  * 6.02e23 / 1.425;
-  nh2 = (sigma-sigmaz) * 6.02e23 / 1.425;
+  int i;
+  Real hsigma;
 
-  /* The following fitting formula applies for 1 < TX < 8 (keV) */
+  hsigma = 0.5 * SurfDen_disk(Disk, radius);
 
-  if ((Disk->Tx < 1.0) || (Disk->Tx > 8.0))
-    ath_error("The X-ray source temperature must be between 1 and 8 keV!\n");
+  for (i=0; i<nz; i++)
+    sigz[i] = hsigma * (1.0 - Erf(fabs(z[i])/1.41421356));
 
-  lnTx = log(Disk->Tx);
-
-  coef3 = (log(5.0)-lnTx)/(log(5.0)-log(3.0));
-  coef5 = (lnTx-log(3.0))/(log(5.0)-log(3.0));
-
-  r1   = exp(coef3*log(r13)   + coef5*log(r15));
-  col1 = exp(coef3*log(col13) + coef5*log(col15));
-  pow1 = exp(coef3*log(pow13) + coef5*log(pow15));
-  r2   = exp(coef3*log(r23)   + coef5*log(r25));
-  col2 = exp(coef3*log(col23) + coef5*log(col25));
-  pow2 = exp(coef3*log(pow23) + coef5*log(pow25));
-
-  rate += 2.0*(Disk->Lx/1.0e29)*pow(radius,-2.2)
-          * (r1*(exp(-pow(nh1/col1,pow1)) + exp(-pow(nh2/col1,pow1)))
-           + r2*(exp(-pow(nh1/col2,pow2)) + exp(-pow(nh2/col2,pow2))));
+  return;
+}
 
-/*---------- Radioactive decay ionization rate ---------------------
+/*------------------------------------------------------------------------------
+ * Visual extinction corresponding to the column density sigz (g/cm^2)
+ * Reference: Bohlin, Savage & Drake (1978), N_H/A_V = 1.87e21 cm^-2 mag^-1
  */
+Real Av_disk(Real sigz)
+{/* mag */
 
-  rate += Disk->RD_rate;
-
-  return rate;
+  /* hydrogen column density (mean atomic weight = 1.425) */
+  return sigz * 6.02e23 / 1.425 / 1.87e21;
 }
 
 
+
 #endif /* CHEMISTRY */
@@ -4,6 +4,9 @@
  *   based on the chemistry model.
  * CONTAINS PUBLIC FUNCTIONS:
  *   EleMakeup() - density makeup for charge/element conservation
+ *   jacobi()    - analytic Jacobian of the reaction equations
+ *   derivs()    - time derivatives of the number densities
+ *   check_solver_options() - report the solver options that are ignored
  * REFERENCES:
  *   Bai, X.-N. & Goodman, J., 2009, ApJ, 701, 737
  * History:
@@ -17,84 +20,417 @@
 #include <time.h>
 #include "../header/defs.h"
 #include "../header/chemistry.h"
+#include "../header/chemproto.h"
 #include "../header/prototypes.h"
 #include <cvode/cvode.h>             /* prototypes for CVODE fcts., consts. */
 #include <nvector/nvector_serial.h>  /* serial N_Vector types, fcts., macros */
 #include <cvode/cvode_spgmr.h>
+#include <cvode/cvode_bandpre.h>
 
 int EleMakeup( int verbose);
 int EleMakeup_sub(int q, Real dn);
 int ChargeMakeup ( Real dne);
 
 /* Functions Called by the Solver */
+static Real Derivative(int k, Real *n, int *use);
 static int f(realtype t, N_Vector u, N_Vector udot, void *user_data);
+static int f_perm(realtype t, N_Vector u, N_Vector udot, void *user_data);
+static int f_grain(realtype t, N_Vector u, N_Vector udot, void *user_data);
+static int f_lump(realtype t, N_Vector u, N_Vector udot, void *user_data);
+static int f_moiety(realtype t, N_Vector u, N_Vector udot, void *user_data);
+static int f_qssa(realtype t, N_Vector u, N_Vector udot, void *user_data);
+static int f_dac(realtype t, N_Vector u, N_Vector udot, void *user_data);
+static int Psetup(realtype t, N_Vector y, N_Vector fy, booleantype jok,
+                  booleantype *jcurPtr, realtype gamma, void *user_data,
+                  N_Vector tmp1, N_Vector tmp2, N_Vector tmp3);
+static int Psolve(realtype t, N_Vector y, N_Vector fy, N_Vector r, N_Vector z,
+                  realtype gamma, realtype delta, int lr, void *user_data,
+                  N_Vector tmp);
 static int check_flag(void *flagvalue, char *funcname, int opt);
+static void ScaleRates(Chemistry *Chem, Real *K, Real nH, Real *Kv);
+static void *DACSolver(ChemDAC *D, Real t, Real *x, Real *tol, int atolmode,
+                       Real reltol, Real abstol, N_Vector *numden,
+                       N_Vector *vatol);
+
+/* rate coefficients for the solver variables (Evln.K for number densities) */
+static Real *Ksv;
+
+/* work: solver variables in species order for f_perm (0..Ntot-1) */
+static Real *Nsp = NULL;
+
+/* set while evolve() integrates the full network before choosing the fast
+ * species of problem/qssa=1 */
+static int qssfull = 0;
 
 /*============================================================================*/
 int evolve(Real tend, Real dttry, Real abstol)
 {
   realtype t,reltol=1.e-6;
-  int flag, status,verbose,i;
-  N_Vector numden,dndt,vrtol;
+  int flag, status,verbose,i,precond,grcharge,moiety,repivot,nsv,i0,atolmode;
+  int abnvar, qssa, grlump, dac, dacevery = 1, ndac = 0;
+  long int mu, ml, nfe, nfeBP, npivot, nst, netf, nni, ncfn;
+  long int nfe0, nfeBP0, nst0, netf0, nni0, ncfn0;
+  Real atolrel, *tol, scale, *x, *Kv = NULL, t0 = 0.0, tq;
+  ChemPrecond Prec;
+  GrCharging Grc;
+  GrLumping Grl;
+  ChemMoiety Mo;
+  ChemQSSA Qs;
+  ChemDAC Dac;
+  N_Vector numden,dndt,vatol;
   void* cvode_mem;
   Chemistry *Chem = Evln.Chem;
+  ChemOrder *Ord = Chem->Order;
   numden = cvode_mem = NULL;
 
-  dndt = N_VNew_Serial(Chem->Ntot);
-  numden = N_VNew_Serial(Chem->Ntot);
-  vrtol = N_VNew_Serial(Chem->Ntot);
+  /* with abnvar=1 the solver variables are the abundances x = n*Abn_Den, so
+   * that they are of order unity in every cell; a term with N reactants
+   * then has the rate coefficient K*n_H^(N-1). All arrays used inside the
+   * solver (x, Ksv, the moiety totals, the grain bin densities, the
+   * tolerances) are in the units of the solver variables. */
+  abnvar = par_geti_def("problem","abnvar",0);
+  scale = (abnvar == 1) ? Evln.Abn_Den : 1.0;
+  x = (Real*)calloc_1d_array(Chem->Ntot, sizeof(Real));
+  for(i=0;i<Chem->Ntot;i++)
+    x[i] = Evln.NumDen[i]*scale;
+  Ksv = Evln.K;
+  if (abnvar == 1) {
+    Kv = (Real*)calloc_1d_array(MAX(Chem->NReaction,1), sizeof(Real));
+    ScaleRates(Chem, Evln.K, 1.0/Evln.Abn_Den, Kv);
+    Ksv = Kv;
+  }
+
+  /* with the grain charge states in detailed balance (grain_charge.c), only
+   * the gas species 1..GrInd-1 are evolved, in their natural order; the
+   * electrons follow from charge neutrality. The solver evolves species
+   * i0..i0+nsv-1. */
+  grcharge = (Chem->NGrain > 0) && (par_geti_def("problem","grcharge",0) == 1);
+  /* the same with the charge states of each grain type lumped into one
+   * species (grain_lump.c): the grains are not evolved either */
+  grlump = Chem->GrLump;
+  precond = par_geti_def("problem","precond",0);
+  nsv = Chem->Ntot;
+  i0 = 0;
+
+  /* with the conserved moieties eliminated (moiety.c), only the independent
+   * species are evolved, at positions Mo.pos[] of the state vector; the
+   * conservation laws then hold exactly and EleMakeup is not needed */
+  moiety = !grlump && (par_geti_def("problem","moiety",0) == 1);
+  repivot = 0;
+  npivot = 0;
+
+  /* with the fast species in quasi-steady state (qssa.c), only the slow
+   * species are evolved, at positions Qs.pos[] of the state vector. Unless
+   * they are listed, the fast species are chosen from the state at
+   * problem/qssstart, reached with the full network; the rates do not
+   * depend on time, so the evolution then continues from t0. */
+  qssa = !grlump && !moiety && !qssfull &&
+         (par_geti_def("problem","qssa",0) == 1);
+  tq = par_getd_def("problem","qssstart",1.0)*OneYear;
+  if (qssa && !par_exist("problem","qsslist") && (tq > dttry) && (tq < tend))
+  {
+    free_1d_array(x);
+    if (Kv != NULL) free_1d_array(Kv);
+    qssfull = 1;
+    status = evolve(tq, dttry, abstol);
+    qssfull = 0;
+    if (status != 0) return(status);
+    t0 = Evln.t/1.2;   /* Evln.t is the next output time */
+
+    x = (Real*)calloc_1d_array(Chem->Ntot, sizeof(Real));
+    for(i=0;i<Chem->Ntot;i++)
+      x[i] = Evln.NumDen[i]*scale;
+    Ksv = Evln.K;
+    if (abnvar == 1) {
+      Kv = (Real*)calloc_1d_array(MAX(Chem->NReaction,1), sizeof(Real));
+      ScaleRates(Chem, Evln.K, 1.0/Evln.Abn_Den, Kv);
+      Ksv = Kv;
+    }
+  }
+
+  /* with the dynamic adaptive chemistry (adaptive.c), only the active
+   * species are evolved, at positions Dac.pos[] of the state vector, with
+   * the active reactions; the other species are frozen. The selection is
+   * made again every dacevery output steps, and the solver started again
+   * at the current time when the active species change. */
+  dac = !grlump && !moiety && (par_geti_def("problem","qssa",0) != 1) &&
+        (par_geti_def("problem","dac",0) == 1);
+  nfe0 = nfeBP0 = nst0 = netf0 = nni0 = ncfn0 = 0;
+
+  /* the options these modes ignore are reported once by
+   * check_solver_options() */
+  if (moiety)
+  {
+    Ord = NULL;
+    precond = 0;
+    grcharge = 0;
+    init_moiety(Chem, x, &Mo);
+    nsv = Mo.NI;
+  }
+  else if (qssa)
+  {
+    Ord = NULL;
+    precond = 0;
+    grcharge = 0;
+    init_qssa(Chem, Ksv, x, par_getd_def("problem","qsstau",1.0)*OneYear,
+              par_getd_def("problem","qssfrac",1.0e-6), &Qs);
+    qssa_solve(&Qs, Chem, Ksv, x);
+    nsv = Qs.NS;
+  }
+  else if (dac)
+  {
+    Ord = NULL;
+    precond = 0;
+    grcharge = 0;
+    init_dac(Chem, Ksv, x, &Dac);
+    dacevery = MAX(par_geti_def("problem","dacevery",10),1);
+    ndac = 0;
+    nsv = Dac.NA;
+  }
+  else if (grlump)
+  {
+    Ord = NULL;
+    precond = 0;
+    grcharge = 0;
+    nsv = Chem->GrInd-1;
+    i0 = 1;
+    init_grlump(Chem, x, 1.0/scale, Evln.T, &Grl);
+  }
+  else if (grcharge)
+  {
+    Ord = NULL;
+    precond = 0;
+    nsv = Chem->GrInd-1;
+    i0 = 1;
+    init_grcharge(Chem, x, &Grc);
+  }
+
+  /* position of species i in the state vector */
+#define SV(i) ((Ord != NULL) ? Ord->iperm[i] : (i)-i0)
+  if (Ord != NULL)
+    Nsp = (Real*)calloc_1d_array(Chem->Ntot, sizeof(Real));
+
+  dndt = N_VNew_Serial(nsv);
+  numden = N_VNew_Serial(nsv);
+  vatol = N_VNew_Serial(nsv);
+
+  /* absolute tolerance of each species (scalar atol with atolmode=0), atol
+   * being in the units of the solver variables */
+  atolmode = par_geti_def("problem","atolmode",0);
+  atolrel = par_getd_def("problem","atolrel",1.0e-15);
+  tol = (Real*)calloc_1d_array(Chem->Ntot, sizeof(Real));
+  abstol_species(&Evln, atolmode, atolrel, abstol/scale, tol);
+  for(i=0;i<Chem->Ntot;i++)
+    tol[i] *= scale;
 
   /* initialize number density for calculation */
-  for(i=0;i<Chem->Ntot;i++){
-    NV_Ith_S(numden,i) = Evln.NumDen[i]; 
+  for(i=0;i<nsv;i++){
+    if (moiety)
+      NV_Ith_S(numden,i) = x[Mo.ind[i]];
+    else if (qssa)
+      NV_Ith_S(numden,i) = x[Qs.slow[i]];
+    else if (dac)
+      NV_Ith_S(numden,i) = x[Dac.act[i]];
+    else
+      NV_Ith_S(numden,SV(i+i0)) = x[i+i0];
     NV_Ith_S(dndt,i) = 0.0;
-    NV_Ith_S(vrtol,i) = 1.e0;///Evln.DenScale[i];
+    if (moiety)
+      NV_Ith_S(vatol,i) = tol[Mo.ind[i]];
+    else if (qssa)
+      NV_Ith_S(vatol,i) = tol[Qs.slow[i]];
+    else if (dac)
+      NV_Ith_S(vatol,i) = tol[Dac.act[i]];
+    else
+      NV_Ith_S(vatol,SV(i+i0)) = tol[i+i0];
   }
 
   /* init CVode */ 
   cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
   if(check_flag((void *)cvode_mem, "CVodeCreate", 0)) return(1);
 
-  flag = CVodeInit(cvode_mem,f,0.0,numden);
+  if (moiety)
+    flag = CVodeInit(cvode_mem,f_moiety,t0,numden);
+  else if (qssa)
+    flag = CVodeInit(cvode_mem,f_qssa,t0,numden);
+  else if (dac)
+    flag = CVodeInit(cvode_mem,f_dac,t0,numden);
+  else if (grlump)
+    flag = CVodeInit(cvode_mem,f_lump,t0,numden);
+  else if (grcharge)
+    flag = CVodeInit(cvode_mem,f_grain,t0,numden);
+  else
+    flag = CVodeInit(cvode_mem,(Ord != NULL) ? f_perm : f,t0,numden);
   if(check_flag(&flag,"CVodeInit", 1)) return(1);
 
-  //flag = CVodeSVtolerances(cvode_mem, abstol, vrtol);
-  //if (check_flag(&flag, "CVodeSVtolerances", 1)) return(1); 
-  flag = CVodeSStolerances(cvode_mem, reltol, abstol);
-  if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+  if (atolmode == 0) {
+    flag = CVodeSStolerances(cvode_mem, reltol, abstol);
+    if (check_flag(&flag, "CVodeSStolerances", 1)) return(1);
+  }
+  else {
+    flag = CVodeSVtolerances(cvode_mem, reltol, vatol);
+    if (check_flag(&flag, "CVodeSVtolerances", 1)) return(1);
+  }
 
-  flag = CVSpgmr(cvode_mem,PREC_LEFT,Chem->Ntot);
-  //flag = CVSpgmr(cvode_mem,PREC_RIGHT,Chem->Ntot);
+  /* the preconditioner data is taken from the user data by CVSpgmr */
+  if (moiety) {
+    flag = CVodeSetUserData(cvode_mem, &Mo);
+    if(check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+  }
+  if (qssa) {
+    flag = CVodeSetUserData(cvode_mem, &Qs);
+    if(check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+  }
+  if (dac) {
+    flag = CVodeSetUserData(cvode_mem, &Dac);
+    if(check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+  }
+  if (grcharge) {
+    flag = CVodeSetUserData(cvode_mem, &Grc);
+    if(check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+  }
+  if (grlump) {
+    flag = CVodeSetUserData(cvode_mem, &Grl);
+    if(check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+  }
+  if (precond == 1) {
+    init_precond(Chem, &Prec);
+    flag = CVodeSetUserData(cvode_mem, &Prec);
+    if(check_flag(&flag, "CVodeSetUserData", 1)) return(1);
+  }
+
+  /* the block preconditioner is not exact: precondition from the right, so
+   * that the Krylov iteration tests the true residual */
+  if (precond == 1)
+    flag = CVSpgmr(cvode_mem,PREC_RIGHT,Chem->Ntot);
+  else
+    flag = CVSpgmr(cvode_mem,PREC_LEFT,nsv);
   flag = CVSpilsSetGSType(cvode_mem, MODIFIED_GS);
     if(check_flag(&flag, "CVSpilsSetGSType", 1)) return(1);
   /* Set preconditioner setup and solve routines Precond and PSolve,
      and the pointer to the user-defined block data */
-  //flag = CVSpilsSetPreconditioner(cvode_mem, Precond, PSolve);
-  //if(check_flag(&flag, "CVSpilsSetPreconditioner", 1)) return(1);
-  flag = CVBandPrecInit(cvode_mem,Chem->Ntot,Chem->Ntot,Chem->Ntot); //N, mu, ml
-  if(check_flag(&flag,"CVBandPrecInit", 0)) return(1); 
+  mu = ml = nsv;
+  if (precond == 1)
+  {/* gas/grain block preconditioner */
+    flag = CVSpilsSetPreconditioner(cvode_mem, Psetup, Psolve);
+    if(check_flag(&flag, "CVSpilsSetPreconditioner", 1)) return(1);
+  }
+  else
+  {/* full bandwidth unless the species are ordered for a narrow band */
+    if (Ord != NULL) {
+      mu = Ord->mu;
+      ml = Ord->ml;
+    }
+    flag = CVBandPrecInit(cvode_mem,nsv,mu,ml); //N, mu, ml
+    if(check_flag(&flag,"CVBandPrecInit", 0)) return(1); 
+  }
   flag = CVodeSetMaxNumSteps(cvode_mem, 500000);
 
   clock_t c0, c1; /* Timing the code */
   c0 = clock();
   ath_pout(0,"\n Chemical evolution started...\n");
   verbose = 0;
-  Evln.t = dttry;
+  Evln.t = (t0 > 0.0) ? 1.2*t0 : dttry;
   while(Evln.t<tend)
   {
     //coeff_adj(&Evln);
     /* copy species number density to cvode to evolve */
     for(i=0;i<Chem->Ntot;i++)
-      NV_Ith_S(numden,i) = Evln.NumDen[i];
+      x[i] = Evln.NumDen[i]*scale;
+    if (moiety)
+    {
+      for(i=0;i<nsv;i++)
+        NV_Ith_S(numden,i) = x[Mo.ind[i]];
+      /* the state vector holds other species after a change of the
+       * dependent ones */
+      if (repivot) {
+        flag = CVodeReInit(cvode_mem, t, numden);
+        if(check_flag(&flag, "CVodeReInit", 1)) return(1);
+        if (atolmode != 0) {
+          for(i=0;i<nsv;i++)
+            NV_Ith_S(vatol,i) = tol[Mo.ind[i]];
+          flag = CVodeSVtolerances(cvode_mem, reltol, vatol);
+          if (check_flag(&flag, "CVodeSVtolerances", 1)) return(1);
+        }
+        repivot = 0;
+      }
+    }
+    else if (qssa)
+      for(i=0;i<nsv;i++)
+        NV_Ith_S(numden,i) = x[Qs.slow[i]];
+    else if (dac)
+    {
+      /* a new selection from the current state; another set of active
+       * species needs a new solver, of another size */
+      if ((++ndac % dacevery == 0) && dac_select(&Dac, Chem, Ksv, x))
+      {
+        CVodeGetNumRhsEvals(cvode_mem, &nfe);
+        CVBandPrecGetNumRhsEvals(cvode_mem, &nfeBP);
+        CVodeGetNumSteps(cvode_mem, &nst);
+        CVodeGetNumErrTestFails(cvode_mem, &netf);
+        CVodeGetNumNonlinSolvIters(cvode_mem, &nni);
+        CVodeGetNumNonlinSolvConvFails(cvode_mem, &ncfn);
+        nfe0 += nfe;   nfeBP0 += nfeBP;
+        nst0 += nst;   netf0 += netf;
+        nni0 += nni;   ncfn0 += ncfn;
+        CVodeFree(&cvode_mem);
+        N_VDestroy_Serial(numden);
+        N_VDestroy_Serial(vatol);
+        nsv = Dac.NA;
+        cvode_mem = DACSolver(&Dac, t, x, tol, atolmode, reltol, abstol,
+                              &numden, &vatol);
+        if (cvode_mem == NULL) return(1);
+      }
+      /* the frozen species take the accepted state, with the changes of
+       * EleMakeup(), not the last iterate seen by f_dac */
+      for(i=0;i<Dac.N;i++)
+        Dac.n[i] = x[i];
+      for(i=0;i<nsv;i++)
+        NV_Ith_S(numden,i) = x[Dac.act[i]];
+      Dac.nstep++;
+      Dac.sumNA += Dac.NA;
+      Dac.sumNRA += Dac.NRA;
+    }
+    else
+      for(i=i0;i<i0+nsv;i++)
+        NV_Ith_S(numden,SV(i)) = x[i];
     flag = CVode(cvode_mem,Evln.t, numden, &t, CV_NORMAL);
     Evln.t *= 1.2;
     //Evln.t = MIN(1.2*Evln.t, 1e4*OneYear+Evln.t);
 
     /* copy species # density back and impose conservation */
+    if (moiety)
+    {
+      moiety_expand(&Mo, NV_DATA_S(numden), x);
+      repivot = moiety_pivot(&Mo, x);
+      npivot += repivot;
+    }
+    else if (qssa)
+    {
+      for(i=0;i<nsv;i++)
+        x[Qs.slow[i]] = NV_Ith_S(numden,i);
+      qssa_solve(&Qs, Chem, Ksv, x);
+    }
+    else if (dac)
+    {
+      for(i=0;i<nsv;i++)
+        x[Dac.act[i]] = NV_Ith_S(numden,i);
+    }
+    else
+    {
+      for(i=i0;i<i0+nsv;i++)
+        x[i] = NV_Ith_S(numden,SV(i));
+      if (grcharge)
+        grcharge_balance(&Grc, Ksv, x);
+      if (grlump) {
+        grlump_balance(&Grl, Ksv, x);
+        for (i=0; i<Grl.NBin*Grl.LS; i++)
+          Evln.GrDist[i] = Grl.p[i];
+      }
+    }
     for(i=0;i<Chem->Ntot;i++)
-      Evln.NumDen[i] = NV_Ith_S(numden,i);
+      Evln.NumDen[i] = x[i]/scale;
     ath_pout(0,"evolution time (yr) = %e\n",Evln.t/OneYear);
-    status = EleMakeup(verbose);
+    status = moiety ? 0 : EleMakeup(verbose);
 
     /* ends if evolution time is too large */
     c1 = clock();
@@ -102,9 +438,94 @@ int evolve(Real tend, Real dttry, Real abstol)
       break;
   }
 
+#undef SV
+
+  /* solver cost, for comparing species orderings and preconditioners */
+  c1 = clock();
+  CVodeGetNumRhsEvals(cvode_mem, &nfe);
+  if (precond == 1) {
+    ath_pout(0,"Evolution took %.3f s (CPU), %ld RHS evaluations, %ld block "
+               "preconditioner setups (%d gas species, %d coupled to %d "
+               "grain species).\n", (double)(c1-c0)/CLOCKS_PER_SEC, nfe,
+               Prec.nsetup, Prec.NG, Prec.nc, Prec.NL);
+    final_precond(&Prec);
+  }
+  else if (moiety) {
+    CVBandPrecGetNumRhsEvals(cvode_mem, &nfeBP);
+    ath_pout(0,"Evolution took %.3f s (CPU), %ld RHS evaluations + %ld in the "
+               "band preconditioner, %d of %d species evolved (%d conservation "
+               "laws, %ld changes of the dependent species).\n",
+               (double)(c1-c0)/CLOCKS_PER_SEC, nfe, nfeBP, nsv, Mo.N, Mo.NC,
+               npivot);
+    final_moiety(&Mo);
+  }
+  else if (qssa) {
+    CVBandPrecGetNumRhsEvals(cvode_mem, &nfeBP);
+    ath_pout(0,"Evolution took %.3f s (CPU), %ld RHS evaluations + %ld in the "
+               "band preconditioner, %d of %d species evolved (%d in quasi-"
+               "steady state, %ld of %ld solutions not converged).\n",
+               (double)(c1-c0)/CLOCKS_PER_SEC, nfe, nfeBP, nsv, Qs.N, Qs.NF,
+               Qs.nfail, Qs.nsolve);
+    final_qssa(&Qs);
+  }
+  else if (dac) {
+    CVodeGetNumRhsEvals(cvode_mem, &nfe);
+    CVBandPrecGetNumRhsEvals(cvode_mem, &nfeBP);
+    ath_pout(0,"Evolution took %.3f s (CPU), %ld RHS evaluations + %ld in the "
+               "band preconditioner, on average %.1f of %d species and %.1f "
+               "of %d reactions active (%ld of %ld selections changed the "
+               "active species).\n", (double)(c1-c0)/CLOCKS_PER_SEC,
+               nfe0+nfe, nfeBP0+nfeBP, Dac.sumNA/MAX(Dac.nstep,1), Dac.N,
+               Dac.sumNRA/MAX(Dac.nstep,1), Dac.NR, Dac.nchange-1,
+               Dac.nsel-1);
+    final_dac(&Dac);
+  }
+  else if (grcharge) {
+    CVBandPrecGetNumRhsEvals(cvode_mem, &nfeBP);
+    ath_pout(0,"Evolution took %.3f s (CPU), %ld RHS evaluations + %ld in the "
+               "band preconditioner, %d gas species with e- and %d grain "
+               "bins in charge balance.\n", (double)(c1-c0)/CLOCKS_PER_SEC,
+               nfe, nfeBP, nsv, Grc.NBin);
+    final_grcharge(&Grc);
+  }
+  else if (grlump) {
+    CVBandPrecGetNumRhsEvals(cvode_mem, &nfeBP);
+    ath_pout(0,"Evolution took %.3f s (CPU), %ld RHS evaluations + %ld in the "
+               "band preconditioner, %d gas species with e- and %d lumped "
+               "grain types in charge balance (%s closure).\n",
+               (double)(c1-c0)/CLOCKS_PER_SEC, nfe, nfeBP, nsv, Grl.NBin,
+               (Grl.closure == 1) ? "Gaussian" : "detailed balance");
+    /* rate coefficients of the captures at the final state */
+    for (i=0; i<Grl.NC; i++)
+      Evln.K[Grl.reac[i]] = Grl.keff[i];
+    final_grlump(&Grl);
+  }
+  else {
+    CVBandPrecGetNumRhsEvals(cvode_mem, &nfeBP);
+    ath_pout(0,"Evolution took %.3f s (CPU), %ld RHS evaluations + %ld in the "
+               "band preconditioner (mu=%ld, ml=%ld).\n",
+               (double)(c1-c0)/CLOCKS_PER_SEC, nfe, nfeBP, mu, ml);
+  }
+
+  Evln.nfe = nfe0 + nfe + ((precond == 1) ? 0 : nfeBP0 + nfeBP);
+
+  CVodeGetNumSteps(cvode_mem, &nst);
+  CVodeGetNumErrTestFails(cvode_mem, &netf);
+  CVodeGetNumNonlinSolvIters(cvode_mem, &nni);
+  CVodeGetNumNonlinSolvConvFails(cvode_mem, &ncfn);
+  ath_pout(0,"Solver statistics: %ld steps, %ld error test failures, %ld "
+             "nonlinear iterations, %ld convergence failures (atolmode=%d).\n",
+             nst0+nst, netf0+netf, nni0+nni, ncfn0+ncfn, atolmode);
+
   /* finalize and return the status */
+  free_1d_array(tol);
+  free_1d_array(x);
+  if (Kv != NULL) free_1d_array(Kv);
+  if (Nsp != NULL) free_1d_array(Nsp);
+  Nsp = NULL;
   N_VDestroy_Serial(dndt);
   N_VDestroy_Serial(numden);
+  N_VDestroy_Serial(vatol);
   CVodeFree(&cvode_mem);
   ath_pout(0,"Evolution completed at t=%e yr, with Abn(e-)=%e.\n",
      Evln.t/OneYear, Evln.NumDen[0]*Evln.Abn_Den);
@@ -112,30 +533,299 @@ int evolve(Real tend, Real dttry, Real abstol)
 }
 
 /*----------------------------------------------------------------------------*/
-/* user provided routine for calculating the Jacobi matrix
+/* Analytic Jacobian jacob[k][p] = d(dn_k/dt)/dn_p at the number densities
+ * numden, with the rate coefficients of Evln (0..Ntot-1 in species order)
  */
-
-static int f(realtype t, N_Vector numden, N_Vector dndt, void *user_data)
+void jacobi(ChemEvln *Evln, Real *numden, Real **jacob)
 {
-  int i, j, k, p;
-  Real sum,rate;
+  int i, j, k, m, p;
+  Real val;
   EquationTerm *EqTerm;
-  for (k=0; k<Chem.Ntot; k++)
-  {
-    sum  = 0.0;
-    for (i=0; i<Chem.Equations[k].NTerm; i++)
+  Chemistry *Chem = Evln->Chem;
+
+  for (k=0; k<Chem->Ntot; k++)
+    for (p=0; p<Chem->Ntot; p++)
+      jacob[k][p] = 0.0;
+
+  for (k=0; k<Chem->Ntot; k++)
+    for (i=0; i<Chem->Equations[k].NTerm; i++)
     {
-      EqTerm = &(Chem.Equations[k].EqTerm[i]);
-      rate = Evln.K[EqTerm->ind] * EqTerm->dir;
+      EqTerm = &(Chem->Equations[k].EqTerm[i]);
       for (j=0; j<EqTerm->N; j++)
       {
-        p = EqTerm->lab[j];
-        rate *= NV_Ith_S(numden,p);
+        /* derivative with respect to the j-th factor */
+        val = Evln->K[EqTerm->ind] * EqTerm->dir;
+        for (m=0; m<EqTerm->N; m++)
+          if (m != j) val *= numden[EqTerm->lab[m]];
+        jacob[k][EqTerm->lab[j]] += val;
       }
+    }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Time derivatives drv[k] = dn_k/dt at the number densities numden, with the
+ * rate coefficients of Evln
+ */
+void derivs(ChemEvln *Evln, Real *numden, Real *drv)
+{
+  int i, j, k;
+  Real sum, rate;
+  EquationTerm *EqTerm;
+  Chemistry *Chem = Evln->Chem;
+
+  for (k=0; k<Chem->Ntot; k++)
+  {
+    sum = 0.0;
+    for (i=0; i<Chem->Equations[k].NTerm; i++)
+    {
+      EqTerm = &(Chem->Equations[k].EqTerm[i]);
+      rate = Evln->K[EqTerm->ind] * EqTerm->dir;
+      for (j=0; j<EqTerm->N; j++)
+        rate *= numden[EqTerm->lab[j]];
       sum += rate;
     }
-   NV_Ith_S(dndt,k) = sum;
+    drv[k] = sum;
   }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Report the solver options that evolve() ignores, once at setup. The modes
+ * problem/grlump, moiety, qssa, dac and grcharge exclude each other in this
+ * order of precedence, and each excludes problem/reorder and problem/precond.
+ */
+void check_solver_options(Chemistry *Chem)
+{
+  int m, k, on[7];
+  char *name[7] = {"grlump", "moiety", "qssa", "dac", "grcharge",
+                   "reorder", "precond"};
+
+  on[0] = Chem->GrLump;
+  on[1] = (par_geti_def("problem","moiety",0) == 1);
+  on[2] = (par_geti_def("problem","qssa",0) == 1);
+  on[3] = (par_geti_def("problem","dac",0) == 1);
+  on[4] = (Chem->NGrain > 0) && (par_geti_def("problem","grcharge",0) == 1);
+  on[5] = (par_geti_def("problem","reorder",0) == 1);
+  on[6] = (par_geti_def("problem","precond",0) == 1);
+
+  /* the mode evolve() runs in */
+  for (m=0; m<5; m++)
+    if (on[m]) break;
+  if (m == 5) return;
+
+  for (k=m+1; k<7; k++)
+    if (on[k])
+      ath_pout(0,"problem/%s is ignored with problem/%s=1.\n", name[k],
+                 name[m]);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* dn_k/dt of species k at the number densities n (in species order), with the
+ * rate coefficients Ksv; with use != NULL, only the terms of the reactions r
+ * with use[r] = 1 are included. All the functions below evaluate the
+ * equations through it.
+ */
+
+static Real Derivative(int k, Real *n, int *use)
+{
+  int i, j;
+  Real sum,rate;
+  EquationTerm *EqTerm;
+
+  sum  = 0.0;
+  for (i=0; i<Chem.Equations[k].NTerm; i++)
+  {
+    EqTerm = &(Chem.Equations[k].EqTerm[i]);
+    if ((use != NULL) && (use[EqTerm->ind] == 0)) continue;
+    rate = Ksv[EqTerm->ind] * EqTerm->dir;
+    for (j=0; j<EqTerm->N; j++)
+      rate *= n[EqTerm->lab[j]];
+    sum += rate;
+  }
+  return sum;
+}
+
+/*----------------------------------------------------------------------------*/
+/* user provided routine for calculating the Jacobi matrix
+ */
+
+static int f(realtype t, N_Vector numden, N_Vector dndt, void *user_data)
+{
+  int k;
+  Real *n = NV_DATA_S(numden);
+
+  for (k=0; k<Chem.Ntot; k++)
+    NV_Ith_S(dndt,k) = Derivative(k, n, NULL);
+  return(0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The same as f, with species k at position iperm[k] of the state vector
+ */
+
+static int f_perm(realtype t, N_Vector numden, N_Vector dndt, void *user_data)
+{
+  int k;
+  int *iperm = Chem.Order->iperm;
+
+  for (k=0; k<Chem.Ntot; k++)
+    Nsp[k] = NV_Ith_S(numden,iperm[k]);
+
+  for (k=0; k<Chem.Ntot; k++)
+    NV_Ith_S(dndt,iperm[k]) = Derivative(k, Nsp, NULL);
+  return(0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The same as f for the gas species 1..GrInd-1 only (at positions 0..GrInd-2
+ * of the state vector), with the electrons and grain charge states in
+ * balance (grain_charge.c)
+ */
+
+static int f_grain(realtype t, N_Vector numden, N_Vector dndt, void *user_data)
+{
+  int k;
+  GrCharging *G = (GrCharging*)user_data;
+  Real *n = G->n;
+
+  for (k=1; k<G->NG; k++)
+    n[k] = NV_Ith_S(numden,k-1);
+  grcharge_balance(G, Ksv, n);
+
+  for (k=1; k<G->NG; k++)
+    NV_Ith_S(dndt,k-1) = Derivative(k, n, NULL);
+  return(0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The same as f_grain with the lumped grain species (grain_lump.c), the
+ * capture rate coefficients following the charge distributions
+ */
+
+static int f_lump(realtype t, N_Vector numden, N_Vector dndt, void *user_data)
+{
+  int k;
+  GrLumping *L = (GrLumping*)user_data;
+  Real *n = L->n;
+
+  for (k=1; k<L->NG; k++)
+    n[k] = NV_Ith_S(numden,k-1);
+  grlump_balance(L, Ksv, n);
+
+  for (k=1; k<L->NG; k++)
+    NV_Ith_S(dndt,k-1) = Derivative(k, n, NULL);
+  return(0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The same as f for the independent species only (moiety.c), with the
+ * dependent ones from the conservation laws
+ */
+
+static int f_moiety(realtype t, N_Vector numden, N_Vector dndt, void *user_data)
+{
+  int c;
+  ChemMoiety *Mo = (ChemMoiety*)user_data;
+  Real *n = Mo->n;
+
+  moiety_expand(Mo, NV_DATA_S(numden), n);
+
+  for (c=0; c<Mo->NI; c++)
+    NV_Ith_S(dndt,c) = Derivative(Mo->ind[c], n, NULL);
+  return(0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The same as f for the slow species only (qssa.c), with the fast ones in
+ * quasi-steady state
+ */
+
+static int f_qssa(realtype t, N_Vector numden, N_Vector dndt, void *user_data)
+{
+  int c;
+  ChemQSSA *Q = (ChemQSSA*)user_data;
+  Real *n = Q->n;
+
+  for (c=0; c<Q->NS; c++)
+    n[Q->slow[c]] = NV_Ith_S(numden,c);
+  qssa_solve(Q, &Chem, Ksv, n);
+
+  for (c=0; c<Q->NS; c++)
+    NV_Ith_S(dndt,c) = Derivative(Q->slow[c], n, NULL);
+  return(0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* The same as f for the active species only (adaptive.c), with the active
+ * reactions
+ */
+
+static int f_dac(realtype t, N_Vector numden, N_Vector dndt, void *user_data)
+{
+  int c;
+  ChemDAC *D = (ChemDAC*)user_data;
+  Real *n = D->n;
+
+  for (c=0; c<D->NA; c++)
+    n[D->act[c]] = NV_Ith_S(numden,c);
+
+  for (c=0; c<D->NA; c++)
+    NV_Ith_S(dndt,c) = Derivative(D->act[c], n, D->ruse);
+  return(0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Setup of the block preconditioner (precond.c); the Jacobian is always
+ * evaluated anew since it is cheap compared to the factorization
+ */
+
+static int Psetup(realtype t, N_Vector y, N_Vector fy, booleantype jok,
+                  booleantype *jcurPtr, realtype gamma, void *user_data,
+                  N_Vector tmp1, N_Vector tmp2, N_Vector tmp3)
+{
+  int k;
+  Real *n = NV_DATA_S(tmp1);
+
+  /* number densities in species order */
+  for (k=0; k<Chem.Ntot; k++)
+    n[k] = NV_Ith_S(y, (Chem.Order != NULL) ? Chem.Order->iperm[k] : k);
+
+  *jcurPtr = TRUE;
+
+  return precond_setup((ChemPrecond*)user_data, &Chem, Ksv, n, gamma);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Solve of the block preconditioner (precond.c)
+ */
+
+static int Psolve(realtype t, N_Vector y, N_Vector fy, N_Vector r, N_Vector z,
+                  realtype gamma, realtype delta, int lr, void *user_data,
+                  N_Vector tmp)
+{
+  int k;
+  int *iperm;
+  Real *x = NV_DATA_S(tmp);
+
+  if (Chem.Order == NULL) {
+    precond_solve((ChemPrecond*)user_data, NV_DATA_S(r), NV_DATA_S(z));
+    return(0);
+  }
+
+  iperm = Chem.Order->iperm;
+  for (k=0; k<Chem.Ntot; k++)
+    x[k] = NV_Ith_S(r, iperm[k]);
+
+  precond_solve((ChemPrecond*)user_data, x, x);
+
+  for (k=0; k<Chem.Ntot; k++)
+    NV_Ith_S(z, iperm[k]) = x[k];
+
   return(0);
 }
 
@@ -247,6 +937,18 @@ int EleMakeup(int verbose)
       ChargeDen += NumDen[i] * Chem->Species[i].charge;
   }
 
+  /* mean charge of the lumped grains (grain_lump.c), which cannot make up
+   * for a negative charge density */
+  if (Chem->GrLump)
+  {
+    l = 2*Chem->GrZmax+1;
+    for (k=0; k<Chem->NGrain; k++)
+      for (j=0; j<l; j++)
+        ChargeDen += NumDen[Chem->GrInd+k] * (j-Chem->GrZmax)
+                   * Evln.GrDist[k*l+j];
+    ChargeDen = MAX(ChargeDen, 0.0);
+  }
+
 /* Make up for the charge density */
 
   if (ChargeDen >= 0.0)
@@ -389,6 +1091,77 @@ int ChargeMakeup(Real dne)
   return 0;
 }
 
+/*----------------------------------------------------------------------------*/
+/* Rate coefficients Kv of the equations for the abundances: a term with N
+ * reactants is multiplied by nH^(N-1)
+ */
+static void ScaleRates(Chemistry *Chem, Real *K, Real nH, Real *Kv)
+{
+  int i, k;
+  EquationTerm *EqTerm;
+
+  for (i=0; i<Chem->NReaction; i++)
+    Kv[i] = K[i];
+
+  for (k=0; k<Chem->Ntot; k++)
+    for (i=0; i<Chem->Equations[k].NTerm; i++)
+    {
+      EqTerm = &(Chem->Equations[k].EqTerm[i]);
+      Kv[EqTerm->ind] = K[EqTerm->ind] * pow(nH, EqTerm->N-1);
+    }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* New solver for the active species of problem/dac=1 (adaptive.c), from the
+ * densities x at time t, with the settings of evolve(); numden and vatol are
+ * allocated for the active species. Returns NULL on failure.
+ */
+static void *DACSolver(ChemDAC *D, Real t, Real *x, Real *tol, int atolmode,
+                       Real reltol, Real abstol, N_Vector *numden,
+                       N_Vector *vatol)
+{
+  int i, flag;
+  void *cvode_mem;
+
+  *numden = N_VNew_Serial(D->NA);
+  *vatol = N_VNew_Serial(D->NA);
+  for (i=0; i<D->N; i++)
+    D->n[i] = x[i];
+  for (i=0; i<D->NA; i++) {
+    NV_Ith_S((*numden),i) = x[D->act[i]];
+    NV_Ith_S((*vatol),i) = tol[D->act[i]];
+  }
+
+  cvode_mem = CVodeCreate(CV_BDF, CV_NEWTON);
+  if(check_flag((void *)cvode_mem, "CVodeCreate", 0)) return(NULL);
+
+  flag = CVodeInit(cvode_mem,f_dac,t,*numden);
+  if(check_flag(&flag,"CVodeInit", 1)) return(NULL);
+
+  if (atolmode == 0) {
+    flag = CVodeSStolerances(cvode_mem, reltol, abstol);
+    if (check_flag(&flag, "CVodeSStolerances", 1)) return(NULL);
+  }
+  else {
+    flag = CVodeSVtolerances(cvode_mem, reltol, *vatol);
+    if (check_flag(&flag, "CVodeSVtolerances", 1)) return(NULL);
+  }
+
+  flag = CVodeSetUserData(cvode_mem, D);
+  if(check_flag(&flag, "CVodeSetUserData", 1)) return(NULL);
+
+  flag = CVSpgmr(cvode_mem,PREC_LEFT,D->NA);
+  flag = CVSpilsSetGSType(cvode_mem, MODIFIED_GS);
+  if(check_flag(&flag, "CVSpilsSetGSType", 1)) return(NULL);
+  flag = CVBandPrecInit(cvode_mem,D->NA,D->NA,D->NA);
+  if(check_flag(&flag,"CVBandPrecInit", 0)) return(NULL);
+  flag = CVodeSetMaxNumSteps(cvode_mem, 500000);
+
+  return(cvode_mem);
+}
+
 /* Check flag for CVode Setup */
 static int check_flag(void *flagvalue, char *funcname, int opt)
 {
@@ -0,0 +1,432 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: flux_analysis.c
+ *
+ * PURPOSE: Contains functions to find the main formation and destruction
+ *   channels of every species over the cells of a column. The rates of all
+ *   reactions are computed in one pass over the reactions (reaction_flux()),
+ *   then the terms of each species are ranked by partial selection: the
+ *   largest channels are taken first, until they cover the fraction
+ *   problem/fluxfrac (default 0.9) of the total formation or destruction rate
+ *   of the species, or problem/fluxtopk (default 5) channels are taken
+ *   (flux_channels()). A reaction appearing twice in the equation of a species
+ *   (A + A -> ...) is one channel with twice the rate.
+ *
+ *   Enabled by problem/fluxan=1 (see main.c). The cells are evolved as in
+ *   main.c and distributed over problem/nproc worker processes by
+ *   run_cells(), as in reduce_grid.c. The channels of all cells are written
+ *   to job/fluxout, in the format job/fluxfmt:
+ *
+ *     csv: one line per channel, with the columns
+ *            cell,z,species,dir,rank,reaction,rate,fraction,equation
+ *          dir being "form" or "dest", reaction the label of the reaction
+ *          (from 0, in the order of the reaction file), fraction the share of
+ *          the total rate of the species in this direction;
+ *     bin: the header
+ *            char magic[8] = "CHEMFLX1"; int nc, Ntot, NReaction, k;
+ *            Real frac; char name[Ntot][NL_SPE];
+ *          then for each cell
+ *            Real z; Real stat[NSTAT]; Real tot[2*Ntot]; int nch[2*Ntot];
+ *            int reac[2*Ntot*k]; Real rate[2*Ntot*k];
+ *          in the layout of FluxTable (chemistry.h), stat being the results
+ *          of solve_cell() and Real a double, in the byte order of the host.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   flux_analysis()   - main channels of all species over a column
+ *   init_fluxtable()  - allocate a channel table
+ *   final_fluxtable() - free a channel table
+ *   reaction_flux()   - rates of all reactions in one cell
+ *   flux_channels()   - main channels of all species from the reaction rates
+ *
+ * REFERENCES:
+ *   D. Wiebe, et al. 2003, A&A, 399, 197-210
+==============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+
+#ifdef CHEMISTRY
+
+/* Arrays of flux_analysis() filled by the cells */
+typedef struct FluxWork_s {
+
+  Nebula *Disk;
+  ChemColumn *Col;
+  Real *flux;                /* reaction rates of the last cell */
+  FluxTable *Tab;            /* channels of each cell */
+  Real **stat;               /* results of solve_cell() in each cell */
+
+}FluxWork;
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   FluxCell()   - evolve one cell and find its channels
+ *   FluxIO()     - send or receive the results of one cell through a pipe
+ *   TableIO()    - send or receive the channels of one cell through a pipe
+ *   WriteCSV()   - write the channels of all cells as text
+ *   WriteBin()   - write the channels of all cells as binary
+ *============================================================================*/
+
+void FluxCell(int c, void *arg);
+int  FluxIO(int fd, int c, int out, void *arg);
+int  TableIO(int fd, FluxTable *F, int out);
+void WriteCSV(FILE *fp, Chemistry *Chem, ChemColumn *Col, FluxTable *Tab);
+void WriteBin(FILE *fp, Chemistry *Chem, ChemColumn *Col, FluxTable *Tab,
+              Real **stat);
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Find the main channels of all species in the cells of the column Col and
+ * write them to job/fluxout (see main.c)
+ */
+void flux_analysis(Nebula *Disk, ChemColumn *Col)
+{
+  int c, k, nc, nproc, nrec, binary;
+  Real frac, *flux, **stat;
+  FluxTable *Tab;
+  char *fname, *fmt;
+  FILE *fp;
+  FluxWork W;
+  Chemistry *Chem = Evln.Chem;
+
+  nc = Col->nz;
+  k = MAX(par_geti_def("problem","fluxtopk",5), 1);
+  frac = par_getd_def("problem","fluxfrac",0.9);
+  nproc = MIN(MAX(par_geti_def("problem","nproc",1),1), MAX(nc,1));
+
+  fmt = par_gets_def("job","fluxfmt","csv");
+  if ((strcmp(fmt,"csv") != 0) && (strcmp(fmt,"bin") != 0))
+    ath_error("[flux_analysis]: job/fluxfmt must be csv or bin, not %s!\n",fmt);
+  binary = (strcmp(fmt,"bin") == 0);
+  free(fmt);
+
+  flux = (Real*)calloc_1d_array(MAX(Chem->NReaction,1), sizeof(Real));
+  stat = (Real**)calloc_2d_array(MAX(nc,1), NSTAT, sizeof(Real));
+  Tab  = (FluxTable*)calloc_1d_array(MAX(nc,1), sizeof(FluxTable));
+  for (c=0; c<nc; c++)
+    init_fluxtable(Chem, k, frac, &(Tab[c]));
+
+  ath_pout(0,"\nFlux analysis over %d cells with %d process(es): up to %d "
+             "channels covering %g of the rate of each species.\n",
+              nc, nproc, k, frac);
+
+/* Evaluate the cells, in this process or in nproc workers */
+
+  W.Disk = Disk;  W.Col = Col;
+  W.flux = flux;  W.Tab = Tab;  W.stat = stat;
+
+  nrec = run_cells(nc, nproc, FluxCell, FluxIO, &W);
+
+  if (nrec != nc)
+    ath_error("[flux_analysis]: only %d of %d cells were evaluated!\n",nrec,nc);
+
+/* Output */
+
+  fname = par_gets_def("job","fluxout", binary ? "flux.bin" : "flux.csv");
+  if ((fp = fopen(fname, binary ? "wb" : "w")) == NULL)
+    ath_error("[flux_analysis]: Error open file %s\n",fname);
+
+  if (binary)
+    WriteBin(fp, Chem, Col, Tab, stat);
+  else
+    WriteCSV(fp, Chem, Col, Tab);
+  fclose(fp);
+
+  ath_pout(0,"Channels of %d species in %d cells written to %s.\n",
+              Chem->Ntot, nc, fname);
+  free(fname);
+
+  for (c=0; c<nc; c++)
+    final_fluxtable(&(Tab[c]));
+  free_1d_array(Tab);
+  free_1d_array(flux);
+  free_2d_array(stat);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Allocate a table of up to k channels per species and direction, covering
+ * the fraction frac of the total rate
+ */
+void init_fluxtable(Chemistry *Chem, int k, Real frac, FluxTable *F)
+{
+  int i, nt = 1;
+
+  F->N = Chem->Ntot;
+  F->k = k;
+  F->frac = frac;
+
+  F->tot  = (Real*)calloc_1d_array(2*F->N, sizeof(Real));
+  F->nch  = (int*)calloc_1d_array(2*F->N, sizeof(int));
+  F->reac = (int*)calloc_1d_array(2*F->N*k, sizeof(int));
+  F->rate = (Real*)calloc_1d_array(2*F->N*k, sizeof(Real));
+
+  for (i=0; i<F->N; i++)
+    nt = MAX(nt, Chem->Equations[i].NTerm);
+  F->wind  = (int*)calloc_1d_array(nt, sizeof(int));
+  F->wrate = (Real*)calloc_1d_array(nt, sizeof(Real));
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Free a channel table
+ */
+void final_fluxtable(FluxTable *F)
+{
+  free_1d_array(F->tot);
+  free_1d_array(F->nch);
+  free_1d_array(F->reac);
+  free_1d_array(F->rate);
+  free_1d_array(F->wind);
+  free_1d_array(F->wrate);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Rate (cm^-3 s^-1) of every reaction at the state of Evln, flux[0..NReaction-1]
+ * (0 for the reactions not in use)
+ */
+void reaction_flux(ChemEvln *Evln, Real *flux)
+{
+  int r;
+  ReactionInfo *R;
+  Chemistry *Chem = Evln->Chem;
+
+  for (r=0; r<Chem->NReaction; r++)
+  {
+    R = &(Chem->Reactions[r]);
+    if (R->use != 1) {
+      flux[r] = 0.0;
+      continue;
+    }
+
+    /* the same product as the terms of the equations (init_equations.c) */
+    flux[r] = Evln->K[r] * Evln->NumDen[R->reactant[0]];
+    if (R->reactant[1] >= 0)
+      flux[r] *= Evln->NumDen[R->reactant[1]];
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Main formation and destruction channels of all species for the reaction
+ * rates flux (see reaction_flux()), into F
+ */
+void flux_channels(Chemistry *Chem, Real *flux, FluxTable *F)
+{
+  int d, i, j, m, n, l, s, t, ind;
+  Real tot, sum, x;
+  EquationTerm *EqTerm;
+
+  for (d=0; d<2; d++)
+  for (i=0; i<F->N; i++)
+  {
+    /* the terms of species i in direction d, a reaction appearing twice
+     * being in adjacent terms */
+    n = 0;
+    tot = 0.0;
+    for (l=0; l<Chem->Equations[i].NTerm; l++)
+    {
+      EqTerm = &(Chem->Equations[i].EqTerm[l]);
+      if ((EqTerm->dir > 0) != (d == 0)) continue;
+
+      ind = EqTerm->ind;
+      if ((n > 0) && (F->wind[n-1] == ind))
+        F->wrate[n-1] += flux[ind];
+      else {
+        F->wind[n] = ind;
+        F->wrate[n++] = flux[ind];
+      }
+      tot += flux[ind];
+    }
+
+    /* partial selection sort: the largest remaining term is moved to
+     * position m, until the channels cover frac of the total */
+    j = d*F->N + i;
+    sum = 0.0;
+    for (m=0; (m<F->k) && (m<n) && (tot>0.0) && (sum<F->frac*tot); m++)
+    {
+      s = m;
+      for (l=m+1; l<n; l++)
+        if (F->wrate[l] > F->wrate[s]) s = l;
+
+      x = F->wrate[s];  F->wrate[s] = F->wrate[m];  F->wrate[m] = x;
+      t = F->wind[s];   F->wind[s]  = F->wind[m];   F->wind[m]  = t;
+
+      F->reac[j*F->k+m] = F->wind[m];
+      F->rate[j*F->k+m] = F->wrate[m];
+      sum += F->wrate[m];
+    }
+
+    F->tot[j] = tot;
+    F->nch[j] = m;
+  }
+
+  return;
+}
+
+/*============================================================================*/
+/*----------------------------- Private Functions ----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Evolve cell c of the column (solve_cell()) and find its channels; arg is
+ * the FluxWork of flux_analysis()
+ */
+void FluxCell(int c, void *arg)
+{
+  FluxWork *W = (FluxWork*)arg;
+
+  solve_cell(W->Disk, W->Col, c, W->stat[c]);
+
+  reaction_flux(&Evln, W->flux);
+  flux_channels(Evln.Chem, W->flux, &(W->Tab[c]));
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Write (out=1) or read (out=0) the results of cell c to/from the pipe fd;
+ * return 0 if the data ended
+ */
+int FluxIO(int fd, int c, int out, void *arg)
+{
+  FluxWork *W = (FluxWork*)arg;
+
+  if (out) {
+    write_pipe(fd, W->stat[c], NSTAT*sizeof(Real));
+    return TableIO(fd, &(W->Tab[c]), 1);
+  }
+
+  return read_pipe(fd, W->stat[c], NSTAT*sizeof(Real)) &&
+         TableIO(fd, &(W->Tab[c]), 0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Write (out=1) or read (out=0) the channels of F to/from the pipe fd; return
+ * 0 if the data ended
+ */
+int TableIO(int fd, FluxTable *F, int out)
+{
+  int nt = 2*F->N, nk = 2*F->N*F->k;
+
+  if (out) {
+    write_pipe(fd, F->tot,  nt*sizeof(Real));
+    write_pipe(fd, F->nch,  nt*sizeof(int));
+    write_pipe(fd, F->reac, nk*sizeof(int));
+    write_pipe(fd, F->rate, nk*sizeof(Real));
+    return 1;
+  }
+
+  return read_pipe(fd, F->tot,  nt*sizeof(Real)) &&
+         read_pipe(fd, F->nch,  nt*sizeof(int))  &&
+         read_pipe(fd, F->reac, nk*sizeof(int))  &&
+         read_pipe(fd, F->rate, nk*sizeof(Real));
+}
+
+/*----------------------------------------------------------------------------*/
+/* One line per channel of every cell (see the top of the file)
+ */
+void WriteCSV(FILE *fp, Chemistry *Chem, ChemColumn *Col, FluxTable *Tab)
+{
+  int c, d, i, j, m, l, p, r, k;
+  char *sep;
+  ReactionInfo *R;
+  FluxTable *F;
+
+  fprintf(fp,"cell,z,species,dir,rank,reaction,rate,fraction,equation\n");
+
+  for (c=0; c<Col->nz; c++)
+  {
+    F = &(Tab[c]);
+    k = F->k;
+    for (i=0; i<F->N; i++)
+    for (d=0; d<2; d++)
+    {
+      j = d*F->N + i;
+      for (m=0; m<F->nch[j]; m++)
+      {
+        r = F->reac[j*k+m];
+        fprintf(fp,"%d,%g,%s,%s,%d,%d,%.6e,%.6e,", c, Col->z[c],
+                   Chem->Species[i].name, (d == 0) ? "form" : "dest", m+1, r,
+                   F->rate[j*k+m], F->rate[j*k+m]/F->tot[j]);
+
+        R = &(Chem->Reactions[r]);
+        sep = "";
+        for (l=0; l<2; l++)
+          if ((p = R->reactant[l]) >= 0) {
+            fprintf(fp,"%s%s", sep, Chem->Species[p].name);
+            sep = " + ";
+          }
+        fprintf(fp," ->");
+        sep = " ";
+        for (l=0; l<4; l++)
+          if ((p = R->product[l]) >= 0) {
+            fprintf(fp,"%s%s", sep, Chem->Species[p].name);
+            sep = " + ";
+          }
+        fprintf(fp,"\n");
+      }
+    }
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Header and the tables of every cell (see the top of the file)
+ */
+void WriteBin(FILE *fp, Chemistry *Chem, ChemColumn *Col, FluxTable *Tab,
+              Real **stat)
+{
+  int c, i, hdr[4];
+  char magic[8] = {'C','H','E','M','F','L','X','1'}, name[NL_SPE];
+  FluxTable *F = &(Tab[0]);
+  Real x;
+
+  hdr[0] = Col->nz;
+  hdr[1] = Chem->Ntot;
+  hdr[2] = Chem->NReaction;
+  hdr[3] = (Col->nz > 0) ? F->k : 0;
+
+  fwrite(magic, sizeof(char), 8, fp);
+  fwrite(hdr, sizeof(int), 4, fp);
+  x = (Col->nz > 0) ? F->frac : 0.0;
+  fwrite(&x, sizeof(Real), 1, fp);
+  for (i=0; i<Chem->Ntot; i++) {
+    memset(name, 0, NL_SPE);
+    memcpy(name, Chem->Species[i].name,
+           MIN(strlen(Chem->Species[i].name), NL_SPE-1));
+    fwrite(name, sizeof(char), NL_SPE, fp);
+  }
+
+  for (c=0; c<Col->nz; c++)
+  {
+    F = &(Tab[c]);
+    x = Col->z[c];
+    fwrite(&x, sizeof(Real), 1, fp);
+    fwrite(stat[c], sizeof(Real), NSTAT, fp);
+    fwrite(F->tot,  sizeof(Real), 2*F->N, fp);
+    fwrite(F->nch,  sizeof(int),  2*F->N, fp);
+    fwrite(F->reac, sizeof(int),  2*F->N*F->k, fp);
+    fwrite(F->rate, sizeof(Real), 2*F->N*F->k, fp);
+  }
+
+  if (ferror(fp))
+    ath_error("[flux_analysis]: Error writing the flux table!\n");
+
+  return;
+}
+
+#endif /* CHEMISTRY */
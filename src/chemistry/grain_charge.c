@@ -0,0 +1,378 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: grain_charge.c
+ *
+ * PURPOSE: Contains functions to treat the charge distribution of the grains
+ *   as a quasi-steady subsystem, for models with many grain size bins. Each
+ *   bin adds 2*GrCharge+1 species to the ODE system, while its charge states
+ *   relax much faster than the gas-phase chemistry evolves.
+ *
+ *   The charge of a grain changes by one at a time, through the capture of
+ *   electrons (Z -> Z-1) and of ions (Z -> Z+1) in the ion/e- + grain
+ *   reactions (rtype 2, rate coefficients from IonGrCoeff/EleStickCoeff).
+ *   The steady state of such a birth-death chain satisfies detailed balance
+ *   between neighbouring charges:
+ *
+ *     n(Z+1) * d(Z+1) = n(Z) * u(Z),   u(Z) = sum_i K_i n_i (ion capture)
+ *                                      d(Z) = sum_e K_e n_e (e- capture)
+ *
+ *   so the distribution of each bin follows from one sweep over its ladder
+ *   (done in logarithms, as the ratios span many orders of magnitude), and is
+ *   normalized to the number density of the bin. The cost is linear in the
+ *   number of bins.
+ *
+ *   The charge carried by the grains comes from the gas, so the electron
+ *   density is set by charge neutrality together with the grain charge:
+ *
+ *     n_e = sum_ions q_i n_i + sum_grains Z n(Z; n_e)
+ *
+ *   The right hand side decreases with n_e, and the root is found by
+ *   bisection in ln(n_e), starting from a bracket around the previous root.
+ *   The root and the ladder sweep are shared with the lumped grains
+ *   (grain_lump.c).
+ *
+ *   Enabled by problem/grcharge=1 (see evolve.c): the solver then evolves the
+ *   gas species other than the electrons only, and the electrons and grain
+ *   charge states are recomputed from them at every evaluation of the
+ *   reaction rates. Grain-grain charge exchange is not included.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   init_grcharge()    - find the charging reactions of each grain species
+ *   final_grcharge()   - free the grain charging subsystem
+ *   grcharge_balance() - electrons and grain charge states for given densities
+ *   grcharge_root()    - electron density of charge neutrality
+ *   grcharge_ladder()  - detailed balance distribution of one charge ladder
+==============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+
+#ifdef CHEMISTRY
+
+/* logarithm of a rate that vanishes */
+#define LOG_ZERO (-1.0e30)
+/* relative accuracy of the electron density */
+#define NE_TOL 1.0e-12
+
+/* arguments of BinCharge() */
+typedef struct BinArg_s {
+
+  GrCharging *G;
+  Real *n;             /* number densities of all species: 0..Ntot-1 */
+
+}BinArg;
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   BinCharge() - charge distribution of all bins for a given n_e
+ *============================================================================*/
+
+Real BinCharge(void *arg, Real ne);
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Find the reactions changing the charge of each grain species by +1 (up) or
+ * -1 (down), and the number density of each bin from the densities n of all
+ * species
+ */
+void init_grcharge(Chemistry *Chem, Real *n, GrCharging *G)
+{
+  int b, i, j, l, r, s, g, pass;
+  ReactionInfo *R;
+
+  G->NG = Chem->GrInd;
+  G->NL = Chem->Ntot - Chem->GrInd;
+  G->LS = 2*Chem->GrCharge+1;
+  G->NBin = Chem->NGrain;
+
+  G->up = (int*)calloc_1d_array(G->NL+1, sizeof(int));
+  G->dn = (int*)calloc_1d_array(G->NL+1, sizeof(int));
+
+  /* two passes: count the transitions of each grain species, then store the
+   * reaction and the gas reactant of each */
+  for (pass=0; pass<2; pass++)
+  {
+    if (pass == 1)
+    {
+      for (l=0; l<G->NL; l++) {
+        G->up[l+1] += G->up[l];
+        G->dn[l+1] += G->dn[l];
+      }
+      G->ureac = (int*)calloc_1d_array(MAX(G->up[G->NL],1), sizeof(int));
+      G->ugas  = (int*)calloc_1d_array(MAX(G->up[G->NL],1), sizeof(int));
+      G->dreac = (int*)calloc_1d_array(MAX(G->dn[G->NL],1), sizeof(int));
+      G->dgas  = (int*)calloc_1d_array(MAX(G->dn[G->NL],1), sizeof(int));
+    }
+
+    for (r=0; r<Chem->NReaction; r++)
+    {
+      R = &(Chem->Reactions[r]);
+      if ((R->rtype != 2) || (R->use != 1)) continue;
+
+      /* grain and gas reactant, grain product */
+      s = -1;
+      for (j=0; j<2; j++)
+        if (R->reactant[j] >= Chem->GrInd) s = R->reactant[j];
+      i = (s == R->reactant[0]) ? R->reactant[1] : R->reactant[0];
+
+      g = -1;
+      for (j=0; j<4; j++)
+        if (R->product[j] >= Chem->GrInd) g = R->product[j];
+
+      if ((s < 0) || (i < 0) || (i >= Chem->GrInd)) continue;
+
+      l = s - Chem->GrInd;
+
+      if (g == s+1)
+      {
+        if (pass == 0)
+          G->up[l+1]++;
+        else {
+          G->ureac[G->up[l]] = r;
+          G->ugas[G->up[l]++] = i;
+        }
+      }
+      else if (g == s-1)
+      {
+        if (pass == 0)
+          G->dn[l+1]++;
+        else {
+          G->dreac[G->dn[l]] = r;
+          G->dgas[G->dn[l]++] = i;
+        }
+      }
+    }
+  }
+
+  /* the second pass moved the starts to the ends: shift back */
+  for (l=G->NL; l>0; l--) {
+    G->up[l] = G->up[l-1];
+    G->dn[l] = G->dn[l-1];
+  }
+  G->up[0] = 0;
+  G->dn[0] = 0;
+
+  /* number density of each bin (conserved) */
+  G->ntot = (Real*)calloc_1d_array(MAX(G->NBin,1), sizeof(Real));
+  for (b=0; b<G->NBin; b++)
+  {
+    G->ntot[b] = 0.0;
+    for (l=b*G->LS; l<(b+1)*G->LS; l++)
+      G->ntot[b] += n[G->NG+l];
+  }
+
+  G->charge = (int*)calloc_1d_array(MAX(G->NG,1), sizeof(int));
+  for (i=0; i<G->NG; i++)
+    G->charge[i] = Chem->Species[i].charge;
+
+  G->ne = n[0];
+
+  G->ue = (Real*)calloc_1d_array(MAX(G->NL,1), sizeof(Real));
+  G->ui = (Real*)calloc_1d_array(MAX(G->NL,1), sizeof(Real));
+  G->de = (Real*)calloc_1d_array(MAX(G->NL,1), sizeof(Real));
+  G->di = (Real*)calloc_1d_array(MAX(G->NL,1), sizeof(Real));
+  G->lf = (Real*)calloc_1d_array(MAX(G->LS,1), sizeof(Real));
+  G->n  = (Real*)calloc_1d_array(MAX(Chem->Ntot,1), sizeof(Real));
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Free the grain charging subsystem
+ */
+void final_grcharge(GrCharging *G)
+{
+  free_1d_array(G->up);
+  free_1d_array(G->dn);
+  free_1d_array(G->ureac);
+  free_1d_array(G->ugas);
+  free_1d_array(G->dreac);
+  free_1d_array(G->dgas);
+  free_1d_array(G->ntot);
+  free_1d_array(G->charge);
+  free_1d_array(G->ue);
+  free_1d_array(G->ui);
+  free_1d_array(G->de);
+  free_1d_array(G->di);
+  free_1d_array(G->lf);
+  free_1d_array(G->n);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Set the electron density n[0] and the number densities n[GrInd..Ntot-1] of
+ * all grain charge states for the gas densities n[1..GrInd-1] and the rate
+ * coefficients K
+ */
+void grcharge_balance(GrCharging *G, Real *K, Real *n)
+{
+  int k, l, m;
+  Real qion, qmax, ne;
+  BinArg A;
+
+  /* charging rates, split into the electron and the other contributions */
+  for (l=0; l<G->NL; l++)
+  {
+    G->ue[l] = 0.0;  G->ui[l] = 0.0;
+    for (m=G->up[l]; m<G->up[l+1]; m++)
+      if (G->ugas[m] == 0) G->ue[l] += K[G->ureac[m]];
+      else                 G->ui[l] += K[G->ureac[m]] * n[G->ugas[m]];
+
+    G->de[l] = 0.0;  G->di[l] = 0.0;
+    for (m=G->dn[l]; m<G->dn[l+1]; m++)
+      if (G->dgas[m] == 0) G->de[l] += K[G->dreac[m]];
+      else                 G->di[l] += K[G->dreac[m]] * n[G->dgas[m]];
+  }
+
+  qion = 0.0;
+  for (k=1; k<G->NG; k++)
+    qion += G->charge[k] * n[k];
+
+  qmax = 0.0;
+  for (k=0; k<G->NBin; k++)
+    qmax += (G->LS/2) * G->ntot[k];
+  qmax = MAX(qion + qmax, TINY_NUMBER);
+
+  A.G = G;
+  A.n = n;
+  ne = grcharge_root(BinCharge, &A, G->ne, qion, qmax);
+
+  n[0] = ne;
+  G->ne = ne;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Electron density ne of charge neutrality, ne = qion + Q(ne), where the grain
+ * charge density Q(ne) = charge(arg, ne) decreases with ne and qmax bounds
+ * ne. The root is bracketed starting from the previous one ne0 and found by
+ * bisection in ln(ne); charge() is called last at the root.
+ */
+Real grcharge_root(Real (*charge)(void *arg, Real ne), void *arg, Real ne0,
+                   Real qion, Real qmax)
+{
+  Real lo, hi, ne;
+
+/* Bracket the root of ne - qion - Q(ne), starting from the previous one */
+
+  ne = ((ne0 > 0.0) && (ne0 <= qmax)) ? ne0 : MIN(MAX(qion,1.0e-10*qmax),qmax);
+  lo = ne;
+  hi = ne;
+
+  if (ne - qion - charge(arg, ne) < 0.0)
+  {
+    do {
+      lo = hi;
+      hi = MIN(10.0*hi, qmax);
+    } while ((hi < qmax) && (hi - qion - charge(arg, hi) < 0.0));
+  }
+  else
+  {
+    do {
+      hi = lo;
+      lo = 0.1*lo;
+    } while ((lo > 1.0e-40*qmax) && (lo - qion - charge(arg, lo) > 0.0));
+  }
+
+/* Bisection in ln(ne) */
+
+  while (hi > (1.0+NE_TOL)*lo)
+  {
+    ne = sqrt(lo*hi);
+    if (ne - qion - charge(arg, ne) < 0.0)
+      lo = ne;
+    else
+      hi = ne;
+  }
+
+  ne = sqrt(lo*hi);
+  charge(arg, ne);
+
+  return ne;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Set p[0..LS-1] to the detailed balance distribution (normalized to 1) of
+ * one charge ladder for the electron density ne, state i going to i+1 at the
+ * rate ue[i]*ne + ui[i] (ue may be NULL) and to i-1 at de[i]*ne + di[i];
+ * lf is a work array (0..LS-1). Returns the mean charge, that of state i
+ * being i-LS/2.
+ */
+Real grcharge_ladder(int LS, Real ne, Real *ue, Real *ui, Real *de, Real *di,
+                     Real *lf, Real *p)
+{
+  int i;
+  Real u, d, lmax, sum, z;
+
+  /* ln p(i) up to a constant, from the most negative charge upwards */
+  lf[0] = 0.0;
+  lmax = 0.0;
+
+  for (i=1; i<LS; i++)
+  {
+    u = ((ue != NULL) ? ue[i-1]*ne : 0.0) + ui[i-1];
+    d = de[i]*ne + di[i];
+
+    lf[i] = lf[i-1] + ((u > 0.0) ? log(u) : LOG_ZERO)
+                    - ((d > 0.0) ? log(d) : LOG_ZERO);
+    lmax = MAX(lmax, lf[i]);
+  }
+
+  sum = 0.0;
+  for (i=0; i<LS; i++) {
+    lf[i] = exp(lf[i] - lmax);
+    sum += lf[i];
+  }
+
+  z = 0.0;
+  for (i=0; i<LS; i++) {
+    p[i] = lf[i] / sum;
+    z += (i - LS/2) * p[i];
+  }
+
+  return z;
+}
+
+/*============================================================================*/
+/*----------------------------- Private Functions ----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Set n[GrInd..Ntot-1] to the detailed balance distribution of all bins for
+ * the electron density ne, and return the total grain charge density
+ */
+Real BinCharge(void *arg, Real ne)
+{
+  int b, i, l0;
+  GrCharging *G = ((BinArg*)arg)->G;
+  Real *n = ((BinArg*)arg)->n, *p, z, q = 0.0;
+
+  for (b=0; b<G->NBin; b++)
+  {
+    l0 = b*G->LS;
+    p = &(n[G->NG+l0]);
+
+    z = grcharge_ladder(G->LS, ne, &(G->ue[l0]), &(G->ui[l0]), &(G->de[l0]),
+                        &(G->di[l0]), G->lf, p);
+
+    for (i=0; i<G->LS; i++)
+      p[i] *= G->ntot[b];
+    q += G->ntot[b] * z;
+  }
+
+  return q;
+}
+
+#undef LOG_ZERO
+#undef NE_TOL
+
+#endif /* CHEMISTRY */
@@ -0,0 +1,361 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: grain_lump.c
+ *
+ * PURPOSE: Contains functions for the lumped representation of the grain
+ *   charge states. With problem/grlump=1 each grain type is a single species
+ *   grk (init_species.c) instead of a ladder of 2*GrCharge+1 charge states,
+ *   and the ladder reactions (ion/e- + grain, grain + grain) are replaced by
+ *   one capture reaction of each charged species on each grain type (rtype 7,
+ *   init_reactions.c), in which the grain is a catalyst:
+ *
+ *     e-  + grk -> grk                     (Z > -GrCharge)
+ *     X+  + grk -> X[m] + grk              (0 <= Z < GrCharge)
+ *     X+  + grk -> X + grk   (or the dissociative recombination products
+ *                             of an ion without neutral counterpart; Z < 0)
+ *     X-  + grk -> X[m] + grk              (-GrCharge < Z <= 0)
+ *     X-  + grk -> X + grk                 (Z > 0)
+ *
+ *   Z being the charge of the grain the capture occurs at, as in the ladder.
+ *   This removes 2*GrCharge species and most of the reactions of each grain
+ *   type. The rate coefficient of a capture is the mean of the Draine & Sutin
+ *   (1987) rate coefficient (ChargeGrCoeff()) over the charge distribution
+ *   p(Z) of the grain type. The charge states relax much faster than the
+ *   gas-phase chemistry evolves, so p(Z) is taken in steady state, with one
+ *   of two closures (problem/grclosure):
+ *
+ *     0: detailed balance (default), exact for the ladder (grain_charge.c):
+ *          p(Z+1) d(Z+1) = p(Z) u(Z),   u(Z) = sum_ions K_i(Z) n_i
+ *                                       d(Z) = sum_e/anions K(Z) n
+ *     1: Gaussian, from the first two moments only: the mean charge is the
+ *        root Z0 of f(Z) = ln u(Z) - ln d(Z+1) = 0 (shifted by 1/2), the
+ *        variance -1/f'(Z0), f being interpolated linearly between integers.
+ *
+ *   The charge carried by the grains comes from the gas, so the electron
+ *   density follows from charge neutrality,
+ *
+ *     n_e = sum_ions q_i n_i + sum_k n_k <Z>_k(n_e),
+ *
+ *   with the root finder of grain_charge.c (grcharge_root()); the detailed
+ *   balance closure uses its ladder sweep (grcharge_ladder()). evolve.c then
+ *   evolves the gas species other than the electrons, and recomputes the
+ *   electrons, the distributions and the capture rate coefficients at every
+ *   evaluation of the reaction rates. The distributions of the final state are kept in
+ *   Evln.GrDist for the grain conductivities in Cal_NIMHD() and the charge
+ *   density in EleMakeup(). Grain-grain charge exchange is not included.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   init_grlump()    - tabulate the capture rate coefficients of each charge
+ *   final_grlump()   - free the lumped grain charge data
+ *   grlump_balance() - electrons, charge distributions and capture rates
+ *   grlump_range()   - grain charges a lumped capture reaction occurs at
+ *
+ * REFERENCES:
+ *   Draine, B. T. & Sutin, B., 1987, ApJ, 320, 803
+ *   Okuzumi, S., 2009, ApJ, 698, 1122
+==============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+
+#ifdef CHEMISTRY
+
+/* logarithm of a rate that vanishes */
+#define LOG_ZERO (-1.0e30)
+/* smallest variance of the Gaussian closure */
+#define VAR_MIN 1.0e-3
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   LumpCharge() - charge distribution of all grain types for a given n_e
+ *   LumpGauss()  - Gaussian distribution of one grain type
+ *============================================================================*/
+
+Real LumpCharge(void *arg, Real ne);
+void LumpGauss(GrLumping *L, int b, Real ne);
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Find the lumped capture reactions and tabulate their rate coefficients for
+ * each grain charge at the temperature T, with the densities n of all species
+ * and the factor fac converting two-body rate coefficients to the units of n
+ */
+void init_grlump(Chemistry *Chem, Real *n, Real fac, Real T, GrLumping *L)
+{
+  int b, c, i, r, Z;
+  ReactionInfo *R;
+
+  L->NG = Chem->GrInd;
+  L->NBin = Chem->NGrain;
+  L->ZM = Chem->GrZmax;
+  L->LS = 2*L->ZM+1;
+  L->fac = fac;
+
+  L->closure = par_geti_def("problem","grclosure",0);
+  if ((L->closure != 0) && (L->closure != 1))
+    ath_error("[init_grlump]: problem/grclosure must be 0 or 1!\n");
+
+  L->NC = 0;
+  for (r=0; r<Chem->NReaction; r++)
+    if ((Chem->Reactions[r].rtype == 7) && (Chem->Reactions[r].use == 1))
+      L->NC++;
+
+  L->reac = (int*)calloc_1d_array(MAX(L->NC,1), sizeof(int));
+  L->gas  = (int*)calloc_1d_array(MAX(L->NC,1), sizeof(int));
+  L->bin  = (int*)calloc_1d_array(MAX(L->NC,1), sizeof(int));
+  L->dz   = (int*)calloc_1d_array(MAX(L->NC,1), sizeof(int));
+  L->zlo  = (int*)calloc_1d_array(MAX(L->NC,1), sizeof(int));
+  L->zhi  = (int*)calloc_1d_array(MAX(L->NC,1), sizeof(int));
+  L->Kz   = (Real**)calloc_2d_array(MAX(L->NC,1), L->LS, sizeof(Real));
+  L->keff = (Real*)calloc_1d_array(MAX(L->NC,1), sizeof(Real));
+
+  c = 0;
+  for (r=0; r<Chem->NReaction; r++)
+  {
+    R = &(Chem->Reactions[r]);
+    if ((R->rtype != 7) || (R->use != 1)) continue;
+
+    L->reac[c] = r;
+    L->gas[c]  = R->reactant[0];
+    L->bin[c]  = R->reactant[1] - Chem->GrInd;
+    L->dz[c]   = grlump_range(Chem, r, &(L->zlo[c]), &(L->zhi[c]));
+
+    for (Z=-L->ZM; Z<=L->ZM; Z++)
+      L->Kz[c][Z+L->ZM] = ((Z >= L->zlo[c]) && (Z <= L->zhi[c])) ?
+                          LumpGrCoeff(Chem, r, Z, T) : 0.0;
+    c++;
+  }
+
+  /* number density of each grain type (conserved) */
+  L->ntot = (Real*)calloc_1d_array(MAX(L->NBin,1), sizeof(Real));
+  for (b=0; b<L->NBin; b++)
+    L->ntot[b] = n[L->NG+b];
+
+  L->charge = (int*)calloc_1d_array(MAX(L->NG,1), sizeof(int));
+  for (i=0; i<L->NG; i++)
+    L->charge[i] = Chem->Species[i].charge;
+
+  L->ne = n[0];
+
+  L->ui = (Real*)calloc_1d_array(MAX(L->NBin*L->LS,1), sizeof(Real));
+  L->de = (Real*)calloc_1d_array(MAX(L->NBin*L->LS,1), sizeof(Real));
+  L->di = (Real*)calloc_1d_array(MAX(L->NBin*L->LS,1), sizeof(Real));
+  L->p  = (Real*)calloc_1d_array(MAX(L->NBin*L->LS,1), sizeof(Real));
+  L->lf = (Real*)calloc_1d_array(L->LS, sizeof(Real));
+  L->n  = (Real*)calloc_1d_array(MAX(Chem->Ntot,1), sizeof(Real));
+  for (i=0; i<Chem->Ntot; i++)
+    L->n[i] = n[i];
+
+  /* neutral grains until the first balance */
+  for (b=0; b<L->NBin; b++)
+    L->p[b*L->LS+L->ZM] = 1.0;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Free the lumped grain charge data
+ */
+void final_grlump(GrLumping *L)
+{
+  free_1d_array(L->reac);
+  free_1d_array(L->gas);
+  free_1d_array(L->bin);
+  free_1d_array(L->dz);
+  free_1d_array(L->zlo);
+  free_1d_array(L->zhi);
+  free_2d_array(L->Kz);
+  free_1d_array(L->keff);
+  free_1d_array(L->ntot);
+  free_1d_array(L->charge);
+  free_1d_array(L->ui);
+  free_1d_array(L->de);
+  free_1d_array(L->di);
+  free_1d_array(L->p);
+  free_1d_array(L->lf);
+  free_1d_array(L->n);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Set the electron density n[0], the charge distributions L->p and the
+ * capture rate coefficients K of the lumped reactions (in the units of n,
+ * and L->keff in cgs) for the gas densities n[1..NG-1]
+ */
+void grlump_balance(GrLumping *L, Real *K, Real *n)
+{
+  int b, c, k, l, Z;
+  Real qion, qmax, ne, Kn;
+
+  /* charging rates by grain charge, split into the electron and the other
+   * contributions */
+  for (l=0; l<L->NBin*L->LS; l++) {
+    L->ui[l] = 0.0;  L->de[l] = 0.0;  L->di[l] = 0.0;
+  }
+
+  for (c=0; c<L->NC; c++)
+  {
+    l = L->bin[c]*L->LS + L->ZM;
+    for (Z=L->zlo[c]; Z<=L->zhi[c]; Z++)
+    {
+      Kn = L->fac * L->Kz[c][Z+L->ZM];
+      if (L->gas[c] == 0)  L->de[l+Z] += Kn;
+      else if (L->dz[c] > 0) L->ui[l+Z] += Kn * n[L->gas[c]];
+      else                 L->di[l+Z] += Kn * n[L->gas[c]];
+    }
+  }
+
+  qion = 0.0;
+  for (k=1; k<L->NG; k++)
+    qion += L->charge[k] * n[k];
+
+  qmax = 0.0;
+  for (b=0; b<L->NBin; b++)
+    qmax += L->ZM * L->ntot[b];
+  qmax = MAX(qion + qmax, TINY_NUMBER);
+
+  ne = grcharge_root(LumpCharge, L, L->ne, qion, qmax);
+
+  n[0] = ne;
+  L->ne = ne;
+
+/* Mean capture rate coefficients over the distributions */
+
+  for (c=0; c<L->NC; c++)
+  {
+    l = L->bin[c]*L->LS + L->ZM;
+    L->keff[c] = 0.0;
+    for (Z=L->zlo[c]; Z<=L->zhi[c]; Z++)
+      L->keff[c] += L->p[l+Z] * L->Kz[c][Z+L->ZM];
+    K[L->reac[c]] = L->fac * L->keff[c];
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Range zlo..zhi of the grain charges the lumped capture reaction r occurs
+ * at, as in the ladder of charge states; returns the change of the grain
+ * charge (+1/-1)
+ */
+int grlump_range(Chemistry *Chem, int r, int *zlo, int *zhi)
+{
+  int j, mantle = 0, ZM = Chem->GrZmax;
+  ReactionInfo *R = &(Chem->Reactions[r]);
+  int g = R->reactant[0], q = Chem->Species[g].charge;
+
+  for (j=0; j<4; j++)
+    if ((R->product[j] >= 0) && (Chem->Species[R->product[j]].type == 4))
+      mantle = 1;
+
+  if (g == 0) {               /* e- : Z -> Z-1 */
+    *zlo = -ZM+1;  *zhi = ZM;
+  }
+  else if (q > 0) {           /* X+ : Z -> Z+1 */
+    *zlo = mantle ? 0 : -ZM;
+    *zhi = mantle ? ZM-1 : -1;
+  }
+  else {                      /* X- : Z -> Z-1 */
+    *zlo = mantle ? -ZM+1 : 1;
+    *zhi = mantle ? 0 : ZM;
+  }
+
+  return (q > 0) ? 1 : -1;
+}
+
+/*============================================================================*/
+/*----------------------------- Private Functions ----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Set L->p to the charge distribution of all grain types for the electron
+ * density ne, and return the total grain charge density
+ */
+Real LumpCharge(void *arg, Real ne)
+{
+  int b, i, l0;
+  GrLumping *L = (GrLumping*)arg;
+  Real q = 0.0, z;
+
+  for (b=0; b<L->NBin; b++)
+  {
+    l0 = b*L->LS;
+
+    if (L->closure == 1)
+    {
+      LumpGauss(L, b, ne);
+      z = 0.0;
+      for (i=0; i<L->LS; i++)
+        z += (i - L->ZM) * L->p[l0+i];
+    }
+    else /* no electron captures raise the charge */
+      z = grcharge_ladder(L->LS, ne, NULL, &(L->ui[l0]), &(L->de[l0]),
+                          &(L->di[l0]), L->lf, &(L->p[l0]));
+
+    q += L->ntot[b] * z;
+  }
+
+  return q;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Gaussian distribution of grain type b, from the root and the slope of
+ * f(Z) = ln u(Z) - ln d(Z+1), which decreases with Z
+ */
+void LumpGauss(GrLumping *L, int b, Real ne)
+{
+  int i, l0 = b*L->LS;
+  Real u, d, f0, f1, z0, var, lmax, sum;
+
+  /* first ladder position i with f(i) < 0 */
+  f0 = f1 = 0.0;
+  for (i=0; i<L->LS-1; i++)
+  {
+    u = L->ui[l0+i];
+    d = L->de[l0+i+1]*ne + L->di[l0+i+1];
+    f0 = f1;
+    f1 = ((u > 0.0) ? log(u) : LOG_ZERO) - ((d > 0.0) ? log(d) : LOG_ZERO);
+    if (f1 < 0.0) break;
+  }
+
+  if ((i == 0) || (i == L->LS-1))
+  {/* at the end of the ladder */
+    z0 = (i == 0) ? 0.0 : (Real)(L->LS-1);
+    var = VAR_MIN;
+  }
+  else
+  {
+    z0 = (i-1) + f0/(f0-f1) + 0.5;
+    var = MAX(1.0/(f0-f1), VAR_MIN);
+  }
+
+  lmax = LOG_ZERO;
+  for (i=0; i<L->LS; i++) {
+    L->lf[i] = -SQR(i-z0)/(2.0*var);
+    lmax = MAX(lmax, L->lf[i]);
+  }
+
+  sum = 0.0;
+  for (i=0; i<L->LS; i++) {
+    L->lf[i] = exp(L->lf[i] - lmax);
+    sum += L->lf[i];
+  }
+
+  for (i=0; i<L->LS; i++)
+    L->p[l0+i] = L->lf[i] / sum;
+
+  return;
+}
+
+#undef LOG_ZERO
+#undef VAR_MIN
+
+#endif /* CHEMISTRY */
@@ -5,6 +5,7 @@
  *
  * CONTAINS PUBLIC FUNCTIONS:
  *   init_chemistry()  - initialize a chemistry model
+ *   build_chemistry() - construct a chemistry model from the input files
  *   init_chemevln()   - initialize a chemical evolution calculation
  *   final_chemistry() - finalize the chemistry model
  *   final_chemevln()  - finalize a chemical evolution calculation
@@ -26,9 +27,53 @@
 
 /*----------------------------------------------------------------------------*/
 /* Initiate the chemistry structure
+ * If job/netcache is set, the model is mapped from that network cache when it
+ * is up to date, otherwise it is built from the input files and cached. The
+ * cache holds the full network; pruning (problem/prune) is applied after.
  */
 void init_chemistry(Chemistry *Chem)
 {
+  char *cache = NULL;
+
+  if (par_exist("job","netcache"))
+    cache = par_gets("job","netcache");
+
+  if ((cache == NULL) || (read_netcache(Chem, cache) != 0))
+  {
+    build_chemistry(Chem);
+
+    if (cache != NULL)
+      write_netcache(Chem, cache);
+  }
+
+  if (cache != NULL) free(cache);
+
+  /* Remove the species and reactions unreachable from the initial condition */
+  if (par_geti_def("problem","prune",0) == 1)
+    prune_chemistry(Chem);
+
+  /* Bandwidth reducing order of the species in the solver if required */
+  Chem->Order = NULL;
+  if (par_geti_def("problem","reorder",0) == 1)
+    init_ordering(Chem);
+
+  /* Tabulate the temperature dependent rate coefficients if required */
+  Chem->RTab = NULL;
+  if (par_geti_def("problem","ratetab",0) == 1)
+    init_ratetable(Chem);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Construct the chemistry structure from the species and reaction files
+ */
+void build_chemistry(Chemistry *Chem)
+{
+  Chem->Arena = NULL;
+  Chem->Arena_size = 0;
+  Chem->NetMap = NULL;
+  Chem->NetMap_size = 0;
 
   /* Read all elements, species and dust properties
    * Arrays of Elements, Species, GrSize, GrFrac, NumDen, DenScale are initiated
@@ -48,6 +93,12 @@ void init_chemistry(Chemistry *Chem)
 	ath_pout(0,"init equations!\n");
   init_equations(Chem);
 
+  /* Move all arrays into one contiguous block */
+  pack_chemistry(Chem);
+
+  Chem->RTab = NULL;
+  Chem->Order = NULL;
+
   return;
 }
 
@@ -56,9 +107,12 @@ void init_chemistry(Chemistry *Chem)
  */
 void init_chemevln(Chemistry *Chem, ChemEvln *Evln)
 {
+  int i;
+
   if (Chem != NULL) {
 
     Evln->t = 0.0;
+    Evln->nfe = 0;
 
     Evln->Chem = Chem;
 
@@ -69,6 +123,15 @@ void init_chemevln(Chemistry *Chem, ChemEvln *Evln)
     Evln->DenScale = (Real*)calloc_1d_array(Chem->Ntot, sizeof(Real));
     Evln->K        = (Real*)calloc_1d_array(Chem->NReaction, sizeof(Real));
     Evln->rate_adj = (Real*)calloc_1d_array(Chem->NReaction, sizeof(Real));
+
+    /* lumped grains are neutral until evolved */
+    Evln->GrDist = NULL;
+    if (Chem->GrLump) {
+      Evln->GrDist = (Real*)calloc_1d_array(Chem->NGrain*(2*Chem->GrZmax+1),
+                                            sizeof(Real));
+      for (i=0; i<Chem->NGrain; i++)
+        Evln->GrDist[i*(2*Chem->GrZmax+1)+Chem->GrZmax] = 1.0;
+    }
   }
   else {
     ath_error("[init_chemevln]: The Chemistry model is NULL!\n");
@@ -88,6 +151,7 @@ void dup_chemevln(ChemEvln *Evln, ChemEvln *Evln_new)
   if (Chem != NULL) {
 
     Evln_new->t    = Evln->t;
+    Evln_new->nfe  = Evln->nfe;
 
     Evln_new->Chem = Evln->Chem;
 
@@ -111,6 +175,14 @@ void dup_chemevln(ChemEvln *Evln, ChemEvln *Evln_new)
       Evln_new->rate_adj[i] = Evln->rate_adj[i];
     }
 
+    Evln_new->GrDist = NULL;
+    if (Chem->GrLump) {
+      Evln_new->GrDist = (Real*)calloc_1d_array(
+                           Chem->NGrain*(2*Chem->GrZmax+1), sizeof(Real));
+      for (i=0; i<Chem->NGrain*(2*Chem->GrZmax+1); i++)
+        Evln_new->GrDist[i] = Evln->GrDist[i];
+    }
+
     Evln_new->rho     = Evln->rho;
     Evln_new->T       = Evln->T;
     Evln_new->B       = Evln->B;
@@ -128,25 +200,18 @@ void dup_chemevln(ChemEvln *Evln, ChemEvln *Evln_new)
  */
 void final_chemistry(Chemistry *Chem)
 {
-  int i;
-
-  for (i=0; i<Chem->Ntot; i++)
-    free(Chem->Species[i].composition);
+  final_ratetable(Chem);
+  final_ordering(Chem);
 
-  for (i=0; i<Chem->NReaction; i++)
-    free(Chem->Reactions[i].coeff);
+  /* all arrays live in the arena, which is either mapped from the network
+   * cache or allocated by pack_chemistry */
+  if (Chem->NetMap != NULL)
+    final_netcache(Chem);
+  else
+    free(Chem->Arena);
 
-  for (i=0; i<Chem->Ntot; i++)
-    free(Chem->Equations[i].EqTerm);
-
-  if (Chem->NGrain > 0) {
-    free(Chem->GrSize);
-    free(Chem->GrFrac);
-  }
-  free(Chem->Elements);
-  free(Chem->Species);
-  free(Chem->Reactions);
-  free(Chem->Equations);
+  Chem->Arena = NULL;
+  Chem->Arena_size = 0;
 
   return;
 }
@@ -167,6 +232,7 @@ void final_chemevln(ChemEvln *Evln)
   free(Evln->rate_adj);
   free(Evln->NumDen);
   free(Evln->DenScale);
+  if (Evln->GrDist != NULL) free(Evln->GrDist);
 
   return;
 }
@@ -25,8 +25,6 @@
 
 #ifdef CHEMISTRY
 
-#define DNE 10
-
 /*==============================================================================
  * PRIVATE FUNCTION PROTOTYPES:
  *   InsertTerm()    - insert a reaction term into the evolution equation
@@ -43,57 +41,71 @@ void OutputEquation(Chemistry *Chem);
  */
 void init_equations(Chemistry *Chem)
 {
-  int i, k, l;
+  int i, k, l, pass;
   int a, b, c, d, e, f;
   int nreactant;
+  EquationTerm *EqTerm;
 
 /* Memory allocation */
   Chem->Equations = (EquationInfo*)calloc_1d_array(Chem->Ntot,
                                                     sizeof(EquationInfo));
 	ath_pout(0,"chem-ntot: %d\n",Chem->Ntot);
-  for (i=0; i<Chem->Ntot; i++)
-  {
-    Chem->Equations[i].NTerm = 0;
-    Chem->Equations[i].EqTerm_size = DNE;
-    Chem->Equations[i].EqTerm = (EquationTerm*)calloc_1d_array(DNE,
-                                                     sizeof(EquationTerm));
-  }
 	ath_pout(0,"Construct equations\n");
 
-/* Construct equation */
-  for (i=0; i<Chem->Ntot; i++)
-    Chem->Equations[i].NTerm = 0;
-
-  l = 0;
-  for (i=0; i<Chem->NReaction; i++)
+/* Construct equation: the first pass only counts the terms of each species,
+ * the second pass fills them into one array */
+  for (pass=0; pass<2; pass++)
   {
-    nreactant = 2;
-    a = Chem->Reactions[i].reactant[0];
-    b = Chem->Reactions[i].reactant[1];
-    c = Chem->Reactions[i].product[0];
-    d = Chem->Reactions[i].product[1];
-    e = Chem->Reactions[i].product[2];
-    f = Chem->Reactions[i].product[3];
-    if (Chem->Reactions[i].use == 1)
+    for (i=0; i<Chem->Ntot; i++)
+      Chem->Equations[i].NTerm = 0;
+
+    l = 0;
+    for (i=0; i<Chem->NReaction; i++)
     {
-      if ((b >= 0) || (b == -10))
+      nreactant = 2;
+      a = Chem->Reactions[i].reactant[0];
+      b = Chem->Reactions[i].reactant[1];
+      c = Chem->Reactions[i].product[0];
+      d = Chem->Reactions[i].product[1];
+      e = Chem->Reactions[i].product[2];
+      f = Chem->Reactions[i].product[3];
+      if (Chem->Reactions[i].use == 1)
       {
-        if (b == -10)
-          nreactant = 1;  /* no second reactant */
-        InsertTerm(Chem, a, nreactant, i, -1);
-        InsertTerm(Chem, c, nreactant, i, 1);
-        if (b >= 0) InsertTerm(Chem, b, nreactant, i, -1);
-        if (d >= 0) InsertTerm(Chem, d, nreactant, i, 1);
-        if (e >= 0) InsertTerm(Chem, e, nreactant, i, 1);
-        if (f >= 0) InsertTerm(Chem, f, nreactant, i, 1);
+        if ((b >= 0) || (b == -10))
+        {
+          if (b == -10)
+            nreactant = 1;  /* no second reactant */
+          InsertTerm(Chem, a, nreactant, i, -1);
+          InsertTerm(Chem, c, nreactant, i, 1);
+          if (b >= 0) InsertTerm(Chem, b, nreactant, i, -1);
+          if (d >= 0) InsertTerm(Chem, d, nreactant, i, 1);
+          if (e >= 0) InsertTerm(Chem, e, nreactant, i, 1);
+          if (f >= 0) InsertTerm(Chem, f, nreactant, i, 1);
+        }
+        /* neutral+grain and desorption reactions, contain all kinds of grains */
+        else
+        {
+          InsertTerm(Chem, a, 1, i, -1);
+          InsertTerm(Chem, c, 1, i, 1);
+        }
+        l += 1;
       }
-      /* neutral+grain and desorption reactions, contain all kinds of grains */
-      else
+    }
+
+    if (pass == 0)
+    {/* exact size allocation, equations stored back to back */
+      k = 0;
+      for (i=0; i<Chem->Ntot; i++)
+        k += Chem->Equations[i].NTerm;
+
+      EqTerm = (EquationTerm*)calloc_1d_array(MAX(k,1), sizeof(EquationTerm));
+
+      for (i=0; i<Chem->Ntot; i++)
       {
-        InsertTerm(Chem, a, 1, i, -1);
-        InsertTerm(Chem, c, 1, i, 1);
+        Chem->Equations[i].EqTerm = EqTerm;
+        Chem->Equations[i].EqTerm_size = Chem->Equations[i].NTerm;
+        EqTerm += Chem->Equations[i].NTerm;
       }
-      l += 1;
     }
   }
 
@@ -106,6 +118,7 @@ void init_equations(Chemistry *Chem)
 /*----------------------------------------------------------------------------*/
 /* Inserting a reaction term in species a from reaction k
  * sign = 1 (a is a product) or -1 (a is a reactant)
+ * In the counting pass (no EqTerm array yet) the term is only counted.
  */
 void InsertTerm(Chemistry *Chem, int a, int nreactant, int k, int sign)
 {
@@ -117,12 +130,8 @@ void InsertTerm(Chemistry *Chem, int a, int nreactant, int k, int sign)
   m = Eq->NTerm;
   Eq->NTerm += 1;
 
-  if (Eq->NTerm > Eq->EqTerm_size)
-  {/* reallocate if there are more reaction terms */
-    Eq->EqTerm = (EquationTerm*)realloc(Eq->EqTerm, 
-                                 (Eq->EqTerm_size+DNE)*sizeof(EquationTerm));
-    Eq->EqTerm_size += DNE;
-  }
+  if (Eq->EqTerm == NULL)  /* counting pass */
+    return;
 
   /* Insert equation term */
   Eq->EqTerm[m].N = nreactant;
@@ -167,6 +176,4 @@ void OutputEquation(Chemistry *Chem)
   fclose(AllE);
 }
 
-#undef DNE
-
 #endif /* CHEMISTRY */
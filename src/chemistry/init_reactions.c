@@ -19,6 +19,10 @@
  *    CE    H2+   Mg    Mg+   H2   0    0    3.0E-9  0      0     1      100000
  *    RR    Mg+   e-    Mg    0    0    0    3.0E-11 -0.5   0     1      100000
  *
+ *  A gas-phase reaction listed more than once (in any order of its reactants
+ *  and products) with different temperature ranges is combined into a single
+ *  reaction with several temperature ranges.
+ *
  *  This code further construct all grain related reactions, termed into 
  *  different types. For details on reaction construction, see Bai & Goodman
  *  (2009).
@@ -48,17 +52,25 @@
 
 #ifdef CHEMISTRY
 
-#define DNR 20 /* number of reactions added each time */
+#define DNR 20 /* initial size of the reaction array */
 
 /*==============================================================================
  * PRIVATE FUNCTION PROTOTYPES:
+ *   PairKey()             - order a pair of species labels
+ *   FindPair()            - find a product pair in the inverse table
+ *   ReactionKey()         - canonical key of a reaction
  *   AddReactionTRange()   - add another temperature range
- *   CheckInverse()        - check if two reactions are inverse to each other
- *   ReactionCmp()         - compare current reaction with the previous one
+ *   MergeTRange()         - merge the temperature range of a duplicate
+ *   TRangeOverlap()       - check if the temperature ranges overlap
+ *   ReactionCmp()         - compare two reactions
  *============================================================================*/
+void PairKey(int p, int q, int *a, int *b);
+int  FindPair(Chemistry *Chem, int *table, int size, int a, int b);
+void ReactionKey(ReactionInfo *R, int *key);
 void AddReactionTRange(Chemistry *Chem, int n);
-int  CheckInverse(Chemistry *Chem, int i, int j);
-int  ReactionCmp(Chemistry *Chem, int n);
+void MergeTRange(Chemistry *Chem, int m, int n);
+int  TRangeOverlap(Chemistry *Chem, int m, int n);
+int  ReactionCmp(Chemistry *Chem, int m, int n);
 
 
 /*============================================================================*/
@@ -70,17 +82,17 @@ int  ReactionCmp(Chemistry *Chem, int n);
  */
 void init_reactions(Chemistry *Chem)
 {
-  FILE *fp;
-  int h, i, j, k, l, m, n, sgn;
+  InputFile in;
+  int h, i, j, k, l, m, n, n0, sgn, size, *table;
+  int key[7], key1[7];
   int Ns_Gr = 2*Chem->GrCharge+1;
   int speclab[10];
-  char line[MAXLEN],name[NL_SPE],fname[20],mantle[NL_SPE];
+  char name[NL_SPE],*fname,mantle[NL_SPE];
   char name1[NL_SPE],name2[NL_SPE],name3[NL_SPE],name4[NL_SPE];
   Real coef;
-  sprintf(fname,"%s",par_gets("job","read_reaction"));
-  fp = fopen(fname,"r");
+  fname = par_gets("job","read_reaction");
 
-  if(fp == NULL){
+  if (open_input(&in, fname) != 0){
     ath_perr(-1,"[init_reactions]: Unable to open the ChemReactions.txt!\n");
     return;
   }
@@ -91,14 +103,15 @@ void init_reactions(Chemistry *Chem)
 
 /*------------------ Read and construct ionization reactions -----------------*/
 
-  fgets(line,MAXLEN,fp);
-  fgets(line,MAXLEN,fp);
-  fscanf(fp, "%d\n", &k);	/* Number of ionization reactions */
+  input_skipline(&in);
+  input_skipline(&in);
+  k = input_int(&in, "number of ionization reactions");
+  input_skipws(&in);
   if (k < 0)
     ath_error("[init_reactions]: Number of ionization reactions must >=0!\n");
 
-  fgets(line,MAXLEN,fp);
-  fgets(line,MAXLEN,fp);
+  input_skipline(&in);
+  input_skipline(&in);
 
   for (i=0; i<k; i++)
   {
@@ -106,19 +119,14 @@ void init_reactions(Chemistry *Chem)
     InsertReactionInit(Chem);
 
     Chem->Reactions[n].rtype = 0;   /* Type is Ionization */
-    fscanf(fp, "%s", name);
-    Chem->Reactions[n].reactant[0] = FindSpecies(Chem, name); /* reactant 1 */
-    fscanf(fp, "%s", name);
-    Chem->Reactions[n].reactant[1] = FindSpecies(Chem, name); /* reactant 2 */
-    fscanf(fp, "%s", name);
-    Chem->Reactions[n].product[0] = FindSpecies(Chem, name);  /* product 1 */
-    fscanf(fp, "%s", name);
-    Chem->Reactions[n].product[1] = FindSpecies(Chem, name);  /* product 2 */
-    fscanf(fp, "%s", name);
-    Chem->Reactions[n].product[2] = FindSpecies(Chem, name);  /* product 3 */
-    fscanf(fp, "%s", name);
-    Chem->Reactions[n].product[3] = FindSpecies(Chem, name);  /* product 4 */
-    fscanf(fp, "%lf\n", &coef);
+    Chem->Reactions[n].reactant[0] = input_species(&in, Chem, name); /* reactant 1 */
+    Chem->Reactions[n].reactant[1] = input_species(&in, Chem, name); /* reactant 2 */
+    Chem->Reactions[n].product[0] = input_species(&in, Chem, name);  /* product 1 */
+    Chem->Reactions[n].product[1] = input_species(&in, Chem, name);  /* product 2 */
+    Chem->Reactions[n].product[2] = input_species(&in, Chem, name);  /* product 3 */
+    Chem->Reactions[n].product[3] = input_species(&in, Chem, name);  /* product 4 */
+    coef = input_real(&in, "ionization ratio");
+    input_skipws(&in);
     Chem->Reactions[n].coeff[0].gamma = coef; /* coefficient 3: probability */
     Chem->Reactions[n].use = 1;
 
@@ -132,13 +140,22 @@ void init_reactions(Chemistry *Chem)
 
 /*----------- Read and construct other gas-phase chemical reactions ----------*/
 
-  fgets(line,MAXLEN,fp);
-  fscanf(fp, "%d\n", &k);	/* Number of chemical reactions; */
+  input_skipline(&in);
+  k = input_int(&in, "number of gas-phase reactions");	/* Number of chemical reactions; */
+  input_skipws(&in);
   if (k < 0)
     ath_error("[init_reactions]: Number of chemical reactions must be >=0!\n");
 
-  fgets(line,MAXLEN,fp);
-  fgets(line,MAXLEN,fp);
+  input_skipline(&in);
+  input_skipline(&in);
+
+  /* table of the canonical keys of all gas-phase reactions */
+  n0 = Chem->NReaction;
+  size = 16;
+  while (size < 2*k) size *= 2;
+  table = (int*)calloc_1d_array(size, sizeof(int));
+  for (h=0; h<size; h++)
+    table[h] = -1;
 
   for (i=0; i<k; i++)
   {
@@ -146,31 +163,21 @@ void init_reactions(Chemistry *Chem)
     InsertReactionInit(Chem);
 
     Chem->Reactions[n].rtype = 1;   /* Type is gas-phase reaction */
-    fscanf(fp, "%s", name);         /* sub-type */
+    input_word(&in, name, NL_SPE, "a reaction sub-type"); /* sub-type */
     if (strcmp(name,"PH") == 0)     /* photo-reaction */
       Chem->Reactions[n].rtype = 10;
-    fscanf(fp, "%s", name);
-    Chem->Reactions[n].reactant[0] = FindSpecies(Chem, name); /* reactant 1 */
-    fscanf(fp, "%s", name);
-    Chem->Reactions[n].reactant[1] = FindSpecies(Chem, name); /* reactant 2 */
-    fscanf(fp, "%s", name);
-    Chem->Reactions[n].product[0] = FindSpecies(Chem, name);  /* product 1 */
-    fscanf(fp, "%s", name);
-    Chem->Reactions[n].product[1] = FindSpecies(Chem, name);  /* product 2 */
-    fscanf(fp, "%s", name);
-    Chem->Reactions[n].product[2] = FindSpecies(Chem, name);  /* product 3 */
-    fscanf(fp, "%s", name);
-    Chem->Reactions[n].product[3] = FindSpecies(Chem, name);  /* product 4 */
-    fscanf(fp, "%lf", &coef);
-    Chem->Reactions[n].coeff[0].alpha = coef;      /* coefficient 1 */
-    fscanf(fp, "%lf", &coef);
-    Chem->Reactions[n].coeff[0].beta = coef;       /* coefficient 2 */
-    fscanf(fp, "%lf", &coef);
-    Chem->Reactions[n].coeff[0].gamma = coef;      /* coefficient 3 */
-    fscanf(fp, "%lf", &coef);
-    Chem->Reactions[n].coeff[0].Tmin = coef;       /* coefficient 4: Tmin */
-    fscanf(fp, "%lf\n", &coef);
-    Chem->Reactions[n].coeff[0].Tmax = coef;       /* coefficient 5: Tmax */
+    Chem->Reactions[n].reactant[0] = input_species(&in, Chem, name); /* reactant 1 */
+    Chem->Reactions[n].reactant[1] = input_species(&in, Chem, name); /* reactant 2 */
+    Chem->Reactions[n].product[0] = input_species(&in, Chem, name);  /* product 1 */
+    Chem->Reactions[n].product[1] = input_species(&in, Chem, name);  /* product 2 */
+    Chem->Reactions[n].product[2] = input_species(&in, Chem, name);  /* product 3 */
+    Chem->Reactions[n].product[3] = input_species(&in, Chem, name);  /* product 4 */
+    Chem->Reactions[n].coeff[0].alpha = input_real(&in, "alpha"); /* coefficient 1 */
+    Chem->Reactions[n].coeff[0].beta  = input_real(&in, "beta");  /* coefficient 2 */
+    Chem->Reactions[n].coeff[0].gamma = input_real(&in, "gamma"); /* coefficient 3 */
+    Chem->Reactions[n].coeff[0].Tmin  = input_real(&in, "Tmin");  /* coefficient 4: Tmin */
+    Chem->Reactions[n].coeff[0].Tmax  = input_real(&in, "Tmax");  /* coefficient 5: Tmax */
+    input_skipws(&in);
     Chem->Reactions[n].use = 1;
 
     if (CheckReaction(Chem, Chem->Reactions[n]) < 0)
@@ -179,29 +186,41 @@ void init_reactions(Chemistry *Chem)
        ath_perr(-1,"[init_reactions]: Error in reaction %d!\n", n+1);
     }
 
-    /* If this reaction is the same as last one, but temperature ranges are 
-     * different, we should combine them */
-    if (ReactionCmp(Chem, n) == 0)
+    /* If this reaction is the same as the last one, or the same as an earlier
+     * one but in a different temperature range, we should combine them */
+    m = -1;
+    if ((n > n0) && (ReactionCmp(Chem, n-1, n) == 0))
+      m = n-1;
+    else
     {
-      n -= 1;
-      m = Chem->Reactions[n].NumTRange;
-      AddReactionTRange(Chem, n);
-
-      /* Sort by temperature (Insert sorting method) */
-      j = 0;
-      while (j < m)
-        if (  Chem->Reactions[n+1].coeff[0].Tmin 
-            > Chem->Reactions[ n ].coeff[j].Tmin )   j++;
-        else break;
+      ReactionKey(&(Chem->Reactions[n]), key);
+      h = fnv1a(FNV1A_BASIS, key, 7*sizeof(int)) & (size-1);
+      while (table[h] >= 0)
+      {
+        ReactionKey(&(Chem->Reactions[table[h]]), key1);
+        if (memcmp(key, key1, 7*sizeof(int)) == 0) break;
+        h = (h+1) & (size-1);
+      }
 
-      for (l=m-1; l>=j; l--)
-        Chem->Reactions[n].coeff[l+1] = Chem->Reactions[n].coeff[l];
+      if (table[h] < 0)
+        table[h] = n;
+      else if (TRangeOverlap(Chem, table[h], n) == 0)
+        m = table[h];
+      else {
+        ath_pout(0,"Warning: reactions %d and %d are duplicates!\n",
+                    table[h]+1, n+1);
+      }
+    }
 
-      Chem->Reactions[n].coeff[j] = Chem->Reactions[n+1].coeff[0];
+    if (m >= 0)
+    {
+      MergeTRange(Chem, m, n);
       Chem->NReaction -= 1;
     }
   }
 
+  free_1d_array(table);
+
 /*---------------------- Construct grain-phase reactions ---------------------*/
 
   /* e- + gr(n+): 2 * Chem->GrCharge reactions */
@@ -374,6 +393,93 @@ void init_reactions(Chemistry *Chem)
     }
   }
 
+  /* Lumped grain charge states (see grain_lump.c): one capture reaction of
+   * each charged species on each grain type, the grain grk being a catalyst.
+   * The rate coefficient is the mean over the charge distribution of those
+   * of the charge states it occurs at, as in the reactions above. */
+
+  if (Chem->GrLump)
+  for (k=0; k<Chem->NGrain; k++)
+  {
+    m = Chem->GrInd + k;
+
+    /* e- + grk -> grk */
+    n = Chem->NReaction;
+    InsertReactionInit(Chem);
+    Chem->Reactions[n].rtype = 7;        /* Type is lumped ion-grain reaction */
+    Chem->Reactions[n].reactant[0] = 0;              /* reactant 1: electron */
+    Chem->Reactions[n].reactant[1] = m;              /* reactant 2: grain */
+    Chem->Reactions[n].product[0] = m;               /* product 1: grain */
+    Chem->Reactions[n].coeff[0].alpha = Chem->Species[0].mass;
+    Chem->Reactions[n].coeff[0].gamma = 1.0;
+    Chem->Reactions[n].use = 1;
+
+    /* X+/- + grk -> X[m] + grk (charge of the same sign or zero) and
+     * X+/- + grk -> X + grk (opposite charge) */
+    for (j=Chem->N_Neu_f+1; j<Chem->NeuInd+2*Chem->N_Neu; j++)
+    {
+      if ((j > 3*Chem->N_Neu_f) && (j < Chem->NeuInd+Chem->N_Neu))
+        continue;                                    /* not an ion */
+
+      for (l=1; l<=2; l++)
+      {
+        n = Chem->NReaction;
+        InsertReactionInit(Chem);
+        Chem->Reactions[n].rtype = 7;
+        Chem->Reactions[n].reactant[0] = j;          /* reactant 1: ion */
+        Chem->Reactions[n].reactant[1] = m;          /* reactant 2: grain */
+
+        if (j <= 2*Chem->N_Neu_f)                    /* X+, with X- */
+          Chem->Reactions[n].product[0] = (l == 1) ?
+                   j + (k+2)*Chem->N_Neu_f : j - Chem->N_Neu_f;
+        else if (j <= 3*Chem->N_Neu_f)               /* X- */
+          Chem->Reactions[n].product[0] = (l == 1) ?
+                   j + (k+1)*Chem->N_Neu_f : j - 2*Chem->N_Neu_f;
+        else                                         /* X+, no X- */
+          Chem->Reactions[n].product[0] = (l == 1) ?
+                   j + (k+1)*Chem->N_Neu : j - Chem->N_Neu;
+
+        Chem->Reactions[n].product[1] = m;           /* product 2: grain */
+        Chem->Reactions[n].coeff[0].alpha = Chem->Species[j].mass;
+        Chem->Reactions[n].coeff[0].beta  = Chem->Species[j].Eb;
+        Chem->Reactions[n].coeff[0].gamma = 1.0;
+        Chem->Reactions[n].use = 1;
+      }
+    }
+
+    /* X+ + grk -> grk + Y + Z + ..., with the branching ratios of the
+     * dissociative recombination of X+ (negative grain charge only) */
+    for (j=Chem->SIonInd; j<Chem->SIonInd+Chem->N_Ion_s; j++)
+    {
+      h = 0;	coef = 0.0;
+      for (i=0; i<Chem->NReaction; i++)
+        if ((Chem->Reactions[i].rtype == 1) &&
+            (Chem->Reactions[i].reactant[0] == j) &&
+            (Chem->Reactions[i].reactant[1] == 0))
+        {
+          speclab[h] = i;		h += 1;
+          coef += Chem->Reactions[i].coeff[0].alpha;
+        }
+
+      for (l=0; l<h; l++)
+      {
+        n = Chem->NReaction;
+        InsertReactionInit(Chem);
+        Chem->Reactions[n].rtype = 7;
+        Chem->Reactions[n].reactant[0] = j;          /* reactant 1: ion */
+        Chem->Reactions[n].reactant[1] = m;          /* reactant 2: grain */
+        Chem->Reactions[n].product[0] = m;           /* product 1: grain */
+        Chem->Reactions[n].product[1] = Chem->Reactions[speclab[l]].product[0];
+        Chem->Reactions[n].product[2] = Chem->Reactions[speclab[l]].product[1];
+        Chem->Reactions[n].product[3] = Chem->Reactions[speclab[l]].product[2];
+        Chem->Reactions[n].coeff[0].alpha = Chem->Species[j].mass;
+        Chem->Reactions[n].coeff[0].gamma =
+               Chem->Reactions[speclab[l]].coeff[0].alpha/coef;
+        Chem->Reactions[n].use = 1;
+      }
+    }
+  }
+
   /* Neutral + gr(n+): Chem->N_Neu + Chem->N_Neu_s reactions */
 
   for (j=1; j<=Chem->N_Neu_f; j++)
@@ -559,21 +665,22 @@ void init_reactions(Chemistry *Chem)
 
   if (Chem->NGrain > 0)
   {
-    fgets(line,MAXLEN,fp);
-    fscanf(fp, "%d\n", &k);       /* Number of grain-surface reactions; */
+    input_skipline(&in);
+    k = input_int(&in, "number of grain-surface reactions"); /* Number of grain-surface reactions; */
+    input_skipws(&in);
     if (k < 0)
       ath_error("[init_reactions]: Number of grain-surface reactions must be >=0!\n");
 
-    fgets(line,MAXLEN,fp);
-    fgets(line,MAXLEN,fp);
+    input_skipline(&in);
+    input_skipline(&in);
 
     for (i=0; i<k; i++)
     {
-      fscanf(fp, "%s", name1);
-      fscanf(fp, "%s", name2);
-      fscanf(fp, "%s", name3);
-      fscanf(fp, "%s", name4);
-      fscanf(fp, "%lf", &coef);
+      input_species(&in, Chem, name1);
+      input_species(&in, Chem, name2);
+      input_species(&in, Chem, name3);
+      input_species(&in, Chem, name4);
+      coef = input_real(&in, "activation energy");
 
       for (j=0;j<Chem->NGrain;j++)
       {
@@ -634,7 +741,8 @@ void init_reactions(Chemistry *Chem)
   }
 
 
-  fclose(fp);
+  close_input(&in);
+  free(fname);
 
 /*----------------------- End of constructing reactions ----------------------*/
 
@@ -669,10 +777,12 @@ void InsertReactionInit(Chemistry *Chem)
   Chem->NReaction += 1;
   n = Chem->NReaction-1;
   if (n >= Chem->Reaction_size)
-  {
+  {/* double the array; the new slots have no coefficients yet */
     Chem->Reactions = (ReactionInfo*)realloc(Chem->Reactions,
-                      (Chem->Reaction_size+DNR)*sizeof(ReactionInfo));
-    Chem->Reaction_size += DNR;
+                      2*Chem->Reaction_size*sizeof(ReactionInfo));
+    memset(Chem->Reactions+Chem->Reaction_size, 0,
+           Chem->Reaction_size*sizeof(ReactionInfo));
+    Chem->Reaction_size *= 2;
   }
 
   React = &(Chem->Reactions[n]);
@@ -734,32 +844,98 @@ int CheckReaction(Chemistry *Chem, ReactionInfo Reaction)
 
 /*----------------------------------------------------------------------------*/
 /* Find inverse of all reactions
+ * Reaction j is the inverse of reaction i if both have at most two products
+ * and the reactants of i are the products of j. Each reaction not yet paired
+ * is matched with the first such j>i. The reactions are grouped by the
+ * (order independent) pair of their products in a hash table, so that every
+ * reaction is checked against its candidates only.
  */
 int FindInverse(Chemistry *Chem)
 {
-  int i, j, r, n, ni;
+  int i, j, k, n, ni, size, lo, hi, a, b;
+  int *table, *start, *cnt, *slot, *list;
+  ReactionInfo *R;
 
   n = Chem->NReaction;
   ni = 0;  /* number of reversible reaction pairs */
 
+  size = 16;
+  while (size < 2*n) size *= 2;
+
+  table = (int*)calloc_1d_array(size, sizeof(int)); /* first reaction */
+  start = (int*)calloc_1d_array(size, sizeof(int)); /* start in list */
+  cnt   = (int*)calloc_1d_array(size, sizeof(int)); /* number of reactions */
+  slot  = (int*)calloc_1d_array(MAX(n,1), sizeof(int));
+  list  = (int*)calloc_1d_array(MAX(n,1), sizeof(int));
+
+  for (k=0; k<size; k++)
+    table[k] = -1;
+
+  /* group the reactions by their products */
+  for (j=0; j<n; j++)
+  {
+    R = &(Chem->Reactions[j]);
+    slot[j] = -1;
+    if (R->product[2] >= 0) continue;   /* More than 2 products */
+
+    PairKey(R->product[0], R->product[1], &a, &b);
+    k = FindPair(Chem, table, size, a, b);
+    if (table[k] < 0) table[k] = j;
+
+    slot[j] = k;
+    cnt[k] += 1;
+  }
+
+  for (k=1; k<size; k++)
+    start[k] = start[k-1] + cnt[k-1];
+
+  for (k=0; k<size; k++)
+    cnt[k] = 0;
+
+  /* reactions of each group in ascending order */
+  for (j=0; j<n; j++)
+    if (slot[j] >= 0)
+    {
+      k = slot[j];
+      list[start[k]+cnt[k]] = j;
+      cnt[k] += 1;
+    }
+
+  /* match the reactants of each reaction */
   for (i=0; i<n; i++)
-    if (Chem->Reactions[i].inverse < 0)
+  {
+    R = &(Chem->Reactions[i]);
+    if ((R->inverse >= 0) || (R->product[2] >= 0)) continue;
+
+    PairKey(R->reactant[0], R->reactant[1], &a, &b);
+    k = FindPair(Chem, table, size, a, b);
+    if (table[k] < 0) continue;
+
+    /* first reaction j>i in the group (bisection) */
+    lo = start[k];
+    hi = start[k] + cnt[k];
+    while (lo < hi)
     {
-      j = i+1;
-      r = 0;
-      while ((j<n) && (r == 0))
-      {
-        r = CheckInverse(Chem, i, j);
-        if (r == 1)
-        {
-          Chem->Reactions[i].inverse = j;
-          Chem->Reactions[j].inverse = i;
-        }
-        j++;
-      }
-      if (r == 1) ni ++;
+      j = (lo+hi)/2;
+      if (list[j] <= i) lo = j+1;
+      else hi = j;
     }
 
+    if (lo < start[k] + cnt[k])
+    {
+      j = list[lo];
+      Chem->Reactions[i].inverse = j;
+      Chem->Reactions[j].inverse = i;
+      ni++;
+    }
+  }
+
+  free_1d_array(table);
+  free_1d_array(start);
+  free_1d_array(cnt);
+  free_1d_array(slot);
+  free_1d_array(list);
+
   return ni;
 }
 
@@ -800,24 +976,65 @@ void PrintReaction(Chemistry *Chem, int i, Real K)
 /*----------------------------- Private Functions ----------------------------*/
 
 /*----------------------------------------------------------------------------*/
-/* Check whether reaction i and j are inverse reactions (1: Yes; 0: No)
+/* Order a pair of species labels: a <= b
  */
-int CheckInverse(Chemistry *Chem, int i, int j)
+void PairKey(int p, int q, int *a, int *b)
 {
-  if (Chem->Reactions[i].product[2] >= 0) return 0;  /* More than 2 products */
-  if (Chem->Reactions[j].product[2] >= 0) return 0;  /* More than 2 products */
+  *a = MIN(p,q);
+  *b = MAX(p,q);
 
-  if (  (Chem->Reactions[i].reactant[0] == Chem->Reactions[j].product[0])
-     && (Chem->Reactions[i].reactant[1] == Chem->Reactions[j].product[1]))
-    return 1;
+  return;
+}
 
-  if (  (Chem->Reactions[i].reactant[0] == Chem->Reactions[j].product[1])
-     && (Chem->Reactions[i].reactant[1] == Chem->Reactions[j].product[0]))
-    return 1;
+/*----------------------------------------------------------------------------*/
+/* Find the slot of the product pair (a,b) in the table of FindInverse. The
+ * returned slot is empty (-1) if there is no reaction with these products.
+ */
+int FindPair(Chemistry *Chem, int *table, int size, int a, int b)
+{
+  int key[2], p, q;
+  uint32_t h;
 
-  return 0;
+  key[0] = a;   key[1] = b;
+  h = fnv1a(FNV1A_BASIS, key, 2*sizeof(int)) & (size-1);
+
+  while (table[h] >= 0)
+  {
+    PairKey(Chem->Reactions[table[h]].product[0],
+            Chem->Reactions[table[h]].product[1], &p, &q);
+    if ((p == a) && (q == b)) break;
+    h = (h+1) & (size-1);
+  }
+
+  return (int)h;
 }
 
+/*----------------------------------------------------------------------------*/
+/* Canonical key of a reaction: its type, followed by the sorted reactants and
+ * the sorted products. The key does not depend on the order in which the
+ * species are listed.
+ */
+void ReactionKey(ReactionInfo *R, int *key)
+{
+  int i, j, t;
+
+  key[0] = R->rtype;
+  key[1] = R->reactant[0];   key[2] = R->reactant[1];
+  key[3] = R->product[0];    key[4] = R->product[1];
+  key[5] = R->product[2];    key[6] = R->product[3];
+
+  PairKey(key[1], key[2], &key[1], &key[2]);
+
+  for (i=4; i<7; i++)  /* insertion sort of the products */
+  {
+    t = key[i];
+    for (j=i-1; (j>=3) && (key[j]>t); j--)
+      key[j+1] = key[j];
+    key[j+1] = t;
+  }
+
+  return;
+}
 
 /*---------------------------------------------------------------------------*/
 /* Add another temperature range of the nth reaction
@@ -835,30 +1052,66 @@ void AddReactionTRange(Chemistry *Chem, int n)
 
 
 /*----------------------------------------------------------------------------*/
-/* Compare whether the nth reaction is the same as the previous one
+/* Merge the (single) temperature range of reaction n into reaction m, keeping
+ * the ranges of m sorted by Tmin
+ */
+void MergeTRange(Chemistry *Chem, int m, int n)
+{
+  int j, l, nt;
+
+  nt = Chem->Reactions[m].NumTRange;
+  AddReactionTRange(Chem, m);
+
+  /* Sort by temperature (Insert sorting method) */
+  j = 0;
+  while (j < nt)
+    if (  Chem->Reactions[n].coeff[0].Tmin
+        > Chem->Reactions[m].coeff[j].Tmin )   j++;
+    else break;
+
+  for (l=nt-1; l>=j; l--)
+    Chem->Reactions[m].coeff[l+1] = Chem->Reactions[m].coeff[l];
+
+  Chem->Reactions[m].coeff[j] = Chem->Reactions[n].coeff[0];
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Check whether the temperature range of reaction n overlaps with any range
+ * of reaction m (1: Yes; 0: No)
+ */
+int TRangeOverlap(Chemistry *Chem, int m, int n)
+{
+  int j;
+  Coefficient *c = &(Chem->Reactions[n].coeff[0]);
+
+  for (j=0; j<Chem->Reactions[m].NumTRange; j++)
+    if (  (c->Tmin < Chem->Reactions[m].coeff[j].Tmax)
+       && (Chem->Reactions[m].coeff[j].Tmin < c->Tmax))
+      return 1;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Compare whether reaction n is the same as reaction m, with the species
+ * listed in the same order (0: the same)
  */
-int ReactionCmp(Chemistry *Chem, int n)
+int ReactionCmp(Chemistry *Chem, int m, int n)
 {
-  int i, p, q;
+  int i;
 
-  if (n == 0)
-    return -1;  /* Not the same */
+  if (Chem->Reactions[m].rtype != Chem->Reactions[n].rtype)
+    return -1;
 
   for (i=0; i<2; i++)
-  {
-    p = Chem->Reactions[n-1].reactant[i];
-    q = Chem->Reactions[n].reactant[i];
-    if (strcmp(Chem->Species[p].name, Chem->Species[q].name) != 0)
+    if (Chem->Reactions[m].reactant[i] != Chem->Reactions[n].reactant[i])
       return -1;
-  }
 
   for (i=0; i<4; i++)
-  {
-    p = Chem->Reactions[n-1].product[i];
-    q = Chem->Reactions[n].product[i];
-    if (strcmp(Chem->Species[p].name, Chem->Species[q].name) != 0)
+    if (Chem->Reactions[m].product[i] != Chem->Reactions[n].product[i])
       return -1;
-  }
 
   return 0;     /* They are the same */
 }
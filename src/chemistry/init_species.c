@@ -31,11 +31,13 @@
  *
  *  This code further construct all grain related species, such as neutral and
  *  charged grains, mantle species, etc. For details on species construction,
- *  see Bai & Goodman (2009).
+ *  see Bai & Goodman (2009). With problem/grlump=1 the charge states of each
+ *  grain type are lumped into the single species grk (see grain_lump.c).
  *
  * CONTAINS PUBLIC FUNCTIONS:
  *   init_species()
  *   FindSpecies()
+ *   HashSpecies()
  *
  * REFERENCES:
  *   Bai, X.-N. & Goodman, J., 2009, ApJ, 701, 737
@@ -59,9 +61,14 @@
  * PRIVATE FUNCTION PROTOTYPES:
  *   Analyze()    - analyze the composition of a chemical species
  *   FindElem()   - find an element from the species
+ *   BuildHash()  - build an open addressing table of names
+ *   LookupHash() - find a name in the table
  *============================================================================*/
 void Analyze(Chemistry *Chem, int i);
 int  FindElem(Chemistry *Chem, char name[NL_SPE], int p, int *l);
+int *BuildHash(char *names, size_t stride, int n, int *size);
+int  LookupHash(int *table, int size, char *names, size_t stride,
+                const char *name);
 void OutputSpecies(Chemistry *Chem);
 
 /*============================================================================*/
@@ -73,15 +80,14 @@ void OutputSpecies(Chemistry *Chem);
  */
 void init_species(Chemistry *Chem)
 {
-  FILE *fp;
+  InputFile in;
   int i, j, k, p, n;
-  char line[MAXLEN],mantle[8],fname[20];
+  char mantle[8],*fname;
   Real sumgas, grtot, ratio;
   printf("read species begin");
-  sprintf(fname,"%s",par_gets("job","read_species"));
-  fp = fopen(fname,"r");
+  fname = par_gets("job","read_species");
 
-  if(fp == NULL){
+  if (open_input(&in, fname) != 0){
     ath_perr(-1,"[construct_species]: Unable to open the species name file!\n");
     return;
   }
@@ -90,21 +96,31 @@ void init_species(Chemistry *Chem)
 
 /* Elements info */
 
-  fgets(line,MAXLEN,fp);
-  fscanf(fp, "%d\n", &(Chem->N_Ele));
+  input_skipline(&in);
+  Chem->N_Ele = input_int(&in, "number of elements");
+  input_skipws(&in);
   if (Chem->N_Ele <= 0)
     ath_error("[init_species]: Number of element must be positive!\n");
 
-  fgets(line,MAXLEN,fp);
-  fscanf(fp, "%d\n", &(Chem->NGrain));
+  input_skipline(&in);
+  Chem->NGrain = input_int(&in, "number of grain types");
+  input_skipws(&in);
   if (Chem->NGrain < 0)
     ath_error("[init_species]: Number of grain types must be non-negative!\n");
 
-  fgets(line,MAXLEN,fp);
-  fscanf(fp, "%d\n", &(Chem->GrCharge));
+  input_skipline(&in);
+  Chem->GrCharge = input_int(&in, "maximum grain charge");
+  input_skipws(&in);
   if (Chem->GrCharge <= 0)
     ath_error("[init_species]: Number of grain charges must be positive!\n");
 
+  /* lumped grain charge states: one species of each grain type, whose charge
+   * distribution runs over -GrZmax..GrZmax */
+  Chem->GrLump = (Chem->NGrain > 0) && (par_geti_def("problem","grlump",0) == 1);
+  Chem->GrZmax = Chem->GrCharge;
+  if (Chem->GrLump)
+    Chem->GrCharge = 0;
+
 /* Initiate element arrays */
 
   Chem->N_Ele_tot= Chem->N_Ele+Chem->NGrain;
@@ -122,12 +138,13 @@ void init_species(Chemistry *Chem)
 
   sumgas = 0.0;
 
-  fgets(line,MAXLEN,fp);
+  input_skipline(&in);
   for (i=0; i<Chem->N_Ele; i++)
   {
-    fscanf(fp, "%s", Chem->Elements[i].name);
-    fscanf(fp, "%lf", &(Chem->Elements[i].mass));
-    fscanf(fp, "%lf\n", &(Chem->Elements[i].abundance));
+    input_word(&in, Chem->Elements[i].name, NL_ELE, "an element name");
+    Chem->Elements[i].mass      = input_real(&in, "element mass");
+    Chem->Elements[i].abundance = input_real(&in, "element abundance");
+    input_skipws(&in);
 
     sumgas += Chem->Elements[i].mass * Chem->Elements[i].abundance;
 
@@ -140,24 +157,31 @@ void init_species(Chemistry *Chem)
                  Chem->Elements[i].name);
   }
 
+  /* Hashed index of element names (used by Analyze) */
+  Chem->ElHash_size = 0;
+  Chem->ElHash = BuildHash(Chem->Elements[0].name, sizeof(ElementInfo),
+                           Chem->N_Ele, &(Chem->ElHash_size));
+
 /* Read grain info */
 
   grtot = 0.0;
 
-  fgets(line,MAXLEN,fp);
-  fscanf(fp, "%lf\n", &(Chem->GrDen));
+  input_skipline(&in);
+  Chem->GrDen = input_real(&in, "grain mass density");
+  input_skipws(&in);
   if (Chem->GrCharge < 0)
     ath_error("[init_species]: Grain mass density must be non-negative!\n");
 
-  fgets(line,MAXLEN,fp);
+  input_skipline(&in);
   for (i=0; i<Chem->NGrain; i++)
   {
     k = Chem->N_Ele+i;  /* label of grain element */
 
     sprintf(Chem->Elements[k].name, "gr%d", i+1);/* Grain as an element */
 
-    fscanf(fp, "%lf", &(Chem->GrSize[i]));     /* Size of this grain */
-    fscanf(fp, "%lf\n", &(Chem->GrFrac[i]));   /* Mass fraction of this grain */
+    Chem->GrSize[i] = input_real(&in, "grain size");      /* Size of this grain */
+    Chem->GrFrac[i] = input_real(&in, "grain mass ratio");/* Mass fraction of this grain */
+    input_skipws(&in);
 
     /* Grain mass (m_p) */
     Chem->Elements[k].mass = 2.505e12*Chem->GrDen*pow(Chem->GrSize[i],3.0);
@@ -189,23 +213,27 @@ void init_species(Chemistry *Chem)
 
 /* Number of species */
 
-  fgets(line,MAXLEN,fp); /* Neutral species with ion counterpart */
-  fscanf(fp, "%d\n", &(Chem->N_Neu_f));
+  input_skipline(&in); /* Neutral species with ion counterpart */
+  Chem->N_Neu_f = input_int(&in, "number of neutral species");
+  input_skipws(&in);
   if (Chem->N_Neu_f < 0)
     ath_error("[init_species]: Number of full neutral species must be >=0!\n");
 
-  fgets(line,MAXLEN,fp); /* Neutral species with ion counterpart */
-  fscanf(fp, "%d\n", &(Chem->N_Neu));
+  input_skipline(&in); /* Neutral species with ion counterpart */
+  Chem->N_Neu = input_int(&in, "number of neutral species");
+  input_skipws(&in);
   if (Chem->N_Neu < 0)
     ath_error("[init_species]: Number of neutral species must be >=0!\n");
 
-  fgets(line,MAXLEN,fp); /* Neutral species without ion counterpart */
-  fscanf(fp, "%d\n", &(Chem->N_Neu_s));
+  input_skipline(&in); /* Neutral species without ion counterpart */
+  Chem->N_Neu_s = input_int(&in, "number of special neutral species");
+  input_skipws(&in);
   if (Chem->N_Neu_s < 0)
     ath_error("[init_species]: Number of special neutral species must >=0 !\n");
 
-  fgets(line,MAXLEN,fp); /* Ion species without neutral counterpart */
-  fscanf(fp, "%d\n", &(Chem->N_Ion_s));
+  input_skipline(&in); /* Ion species without neutral counterpart */
+  Chem->N_Ion_s = input_int(&in, "number of special ion species");
+  input_skipws(&in);
   if (Chem->N_Ion_s < 0)
     ath_error("[init_species]: Number of special ion species must be >=0!\n");
 
@@ -238,11 +266,12 @@ void init_species(Chemistry *Chem)
 
 /* Read and construct Neutral species with +/- ionized counterpart */
 
-  fgets(line,MAXLEN,fp);
+  input_skipline(&in);
   for (i=1; i<=Chem->N_Neu_f; i++)
   {
-    fscanf(fp, "%s", Chem->Species[i].name);
-    fscanf(fp, "%lf\n", &(Chem->Species[i].Eb));    /* Binding energy */
+    input_word(&in, Chem->Species[i].name, NL_SPE-5, "a species name");
+    Chem->Species[i].Eb = input_real(&in, "binding energy");  /* Binding energy */
+    input_skipws(&in);
     Chem->Species[i].gsize = 0.0;                   /* Not used */
     Chem->Species[i].type  = 1;  /* neutral */
 
@@ -315,8 +344,9 @@ void init_species(Chemistry *Chem)
 
   for (i=p; i<p+Chem->N_Neu; i++)
   {
-    fscanf(fp, "%s", Chem->Species[i].name);
-    fscanf(fp, "%lf\n", &(Chem->Species[i].Eb));    /* Binding energy */
+    input_word(&in, Chem->Species[i].name, NL_SPE-5, "a species name");
+    Chem->Species[i].Eb = input_real(&in, "binding energy");  /* Binding energy */
+    input_skipws(&in);
     Chem->Species[i].gsize = 0.0;                   /* Not used */
     Chem->Species[i].type   = 1;
 
@@ -372,10 +402,10 @@ void init_species(Chemistry *Chem)
 
   for (i=p; i<p+Chem->N_Neu_s; i++)
   {
-    fscanf(fp, "%s", Chem->Species[i].name);
-    fscanf(fp, "%lf", &(Chem->Species[i].Eb));
+    input_word(&in, Chem->Species[i].name, NL_SPE-5, "a species name");
+    Chem->Species[i].Eb = input_real(&in, "binding energy");
     Chem->Species[i].gsize = 0.0;                   /* Not used */
-    Chem->Species[n].type   = 1;
+    Chem->Species[i].type   = 1;
 
     if (Chem->Species[i].Eb < 0)
       ath_error("[init_species]: Binding energy must be non-negative!\n");
@@ -412,13 +442,13 @@ void init_species(Chemistry *Chem)
 
   for (i=p; i<p+Chem->N_Ion_s; i++)
   {
-    fscanf(fp, "%s", Chem->Species[i].name);
+    input_word(&in, Chem->Species[i].name, NL_SPE, "a species name");
     Chem->Species[i].Eb = 0.0;        /* Not used */
-    Chem->Species[n].gsize = 0.0;     /* Not used */
+    Chem->Species[i].gsize = 0.0;     /* Not used */
 
     /* Analyze the name of this species to obtain its compositon (IMPORTANT!) */
     Analyze(Chem, i);
-    Chem->Species[n].type   = 2;
+    Chem->Species[i].type   = 2;
   }
 
 /* Construct grains */
@@ -447,7 +477,7 @@ void init_species(Chemistry *Chem)
     {
       Chem->Species[i].mass = Chem->Elements[Chem->N_Ele+k].mass;
       Chem->Species[i].charge = i-n-Chem->GrCharge-1;
-      Chem->Species[n].type   = 3;
+      Chem->Species[i].type   = 3;
 
       Chem->Species[i].numelem = 1;
       for (j=0; j<Chem->N_Ele_tot; j++)
@@ -464,7 +494,13 @@ void init_species(Chemistry *Chem)
     Chem->Elements[Chem->N_Ele+k].single[0] = n+Chem->GrCharge+1;
   }
 
-  fclose(fp);
+  close_input(&in);
+  free(fname);
+
+/*----------- Hashed index of all species names -------------*/
+
+  Chem->SpHash = NULL;
+  HashSpecies(Chem);
 
 /*----------- Output All Species -------------*/
 
@@ -478,18 +514,50 @@ void init_species(Chemistry *Chem)
  */
 int FindSpecies(Chemistry *Chem, char name[NL_SPE])
 {
-  int i, k;
+  int i;
 
-  for (i=0; i<Chem->Ntot; i++)
-  {
-    k = strcmp(name,Chem->Species[i].name);
-    if (k == 0)
-      return i;
-  }
+  i = LookupHash(Chem->SpHash, Chem->SpHash_size, Chem->Species[0].name,
+                 sizeof(SpeciesInfo), name);
+
+  if (i >= 0)
+    return i;
 
   return -10;   /* not found! */
 }
 
+/*---------------------------------------------------------------------------*/
+/* (Re)build the hashed index of species names. Must be called whenever the
+ * species list is changed. Once the model lives in its arena, the table is
+ * rebuilt in place, so the species list may only shrink.
+ */
+void HashSpecies(Chemistry *Chem)
+{
+  int i, size, *table;
+
+  if (Chem->Arena == NULL)
+  {
+    if (Chem->SpHash != NULL) free(Chem->SpHash);
+
+    Chem->SpHash_size = 0;
+    Chem->SpHash = BuildHash(Chem->Species[0].name, sizeof(SpeciesInfo),
+                             Chem->Ntot, &(Chem->SpHash_size));
+    return;
+  }
+
+  size = Chem->SpHash_size;
+  table = BuildHash(Chem->Species[0].name, sizeof(SpeciesInfo),
+                    Chem->Ntot, &size);
+
+  if (size != Chem->SpHash_size)
+    ath_error("[HashSpecies]: The species hash table can not grow!\n");
+
+  for (i=0; i<size; i++)
+    Chem->SpHash[i] = table[i];
+
+  free(table);
+
+  return;
+}
 
 /*============================================================================*/
 /*------------------------------ PRIVATE FUNCTIONS ---------------------------*/
@@ -604,31 +672,95 @@ void Analyze(Chemistry *Chem, int i)
  */
 int FindElem(Chemistry *Chem, char name[NL_SPE], int p, int *l)
 {
-  int i = 0;
+  int i;
+  char elem[3];
+
+  elem[0] = name[p];
 
   /* If the second letter is not capital, then this element has 2 letters */
   if ((name[p+1]>='a') && (name[p+1]<='z'))
   {
     *l = 2;
-    while ((i<Chem->N_Ele) && !((Chem->Elements[i].name[0] == name[p])
-                           && (Chem->Elements[i].name[1] == name[p+1]))) 
-      i++;
+    elem[1] = name[p+1];
+    elem[2] = '\0';
   }
   else    /* this element has 1 letter */
   {
     *l = 1;
-    while ((i<Chem->N_Ele) && ((Chem->Elements[i].name[0] != name[p])
-                           || (Chem->Elements[i].name[1] != '\0')))
-      i++;
-
+    elem[1] = '\0';
   }
 
-  if (i == Chem->N_Ele)
+  i = LookupHash(Chem->ElHash, Chem->ElHash_size, Chem->Elements[0].name,
+                 sizeof(ElementInfo), elem);
+
+  if (i < 0) {
+    i = Chem->N_Ele;
     ath_perr(-1, "[find_element]: Element not found in %s in %d for l=%d!\n", name,p,*l);
+  }
 
   return i;
 }
 
+/*---------------------------------------------------------------------------*/
+/* Build an open addressing (linear probing) table of n names. The k-th name
+ * is at names + k*stride. The table size is a power of 2, at least twice the
+ * number of names and at least the input value of *size (a power of 2, or 0).
+ * If a name appears more than once, the first one wins.
+ */
+int *BuildHash(char *names, size_t stride, int n, int *size)
+{
+  int i, k, *table;
+  uint32_t h;
+
+  if (*size < 16) *size = 16;
+  while (*size < 2*n) *size *= 2;
+
+  table = (int*)calloc(*size, sizeof(int));
+  if (table == NULL)
+    ath_error("[BuildHash]: Failed to allocate the hash table!\n");
+
+  for (i=0; i<*size; i++)
+    table[i] = -1;
+
+  for (k=0; k<n; k++)
+  {
+    h = fnv1a(FNV1A_BASIS, names + k*stride, strlen(names + k*stride))
+        & (*size-1);
+
+    while (table[h] >= 0)
+    {
+      if (strcmp(names + table[h]*stride, names + k*stride) == 0) break;
+      h = (h+1) & (*size-1);
+    }
+
+    if (table[h] < 0) table[h] = k;
+  }
+
+  return table;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Find a name in the table; return its label or -1 if not found
+ */
+int LookupHash(int *table, int size, char *names, size_t stride,
+               const char *name)
+{
+  uint32_t h;
+
+  if (table == NULL) return -1;
+
+  h = fnv1a(FNV1A_BASIS, name, strlen(name)) & (size-1);
+
+  while (table[h] >= 0)
+  {
+    if (strcmp(names + table[h]*stride, name) == 0)
+      return table[h];
+    h = (h+1) & (size-1);
+  }
+
+  return -1;
+}
+
 /*---------------------------------------------------------------------------*/
 /* Output species info
  */
@@ -640,7 +772,11 @@ void OutputSpecies(Chemistry *Chem)
   ath_pout(0,"\n");
   ath_pout(0,"Total Number of Elements:          %d\n",Chem->N_Ele);
   ath_pout(0,"Total Number of Grain Types:       %d\n",Chem->NGrain);
-  ath_pout(0,"Max Number of Grain Charge:        %d\n\n",Chem->GrCharge);
+  if (Chem->GrLump)
+    ath_pout(0,"Max Number of Grain Charge:        %d (lumped)\n\n",
+                Chem->GrZmax);
+  else
+    ath_pout(0,"Max Number of Grain Charge:        %d\n\n",Chem->GrCharge);
 
   ath_pout(0,"List of elements and their single-element species:\n");
   for (i=0; i<Chem->N_Ele; i++)
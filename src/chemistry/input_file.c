@@ -0,0 +1,333 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: input_file.c
+ *
+ * PURPOSE: Contains a small reader for the species, reaction and initial
+ *   abundance input files. The whole file is read into memory at once and
+ *   tokenized in a single pass. Numbers are converted by hand (falling back
+ *   to strtod only when the fast conversion could be inexact), and every
+ *   error is reported with the file name, line and column of the offending
+ *   token.
+ *
+ *   The input files are organized as comment lines, which are skipped as a
+ *   whole (input_skipline), and whitespace separated tokens (input_word,
+ *   input_int, input_real, input_species).
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   open_input()    - read a file into memory
+ *   close_input()   - free the file buffer
+ *   input_skipline()- skip the rest of the current line
+ *   input_skipws()  - skip whitespace (including newlines)
+ *   input_word()    - read a whitespace separated word
+ *   input_int()     - read an integer
+ *   input_real()    - read a real number
+ *   input_species() - read a species name and return its label
+ *   input_error()   - report an error at the current token and stop
+==============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+
+#ifdef CHEMISTRY
+
+#define IS_SPACE(c) ((c)==' ' || (c)=='\t' || (c)=='\n' || (c)=='\r' \
+                     || (c)=='\v' || (c)=='\f')
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   input_tokend()  - end of the token starting at the current position
+ *============================================================================*/
+
+size_t input_tokend(InputFile *in);
+
+/* exact powers of ten */
+static const double pow10tab[23] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Read the file fname into memory. Return 0 on success.
+ */
+int open_input(InputFile *in, char *fname)
+{
+  FILE *fp;
+  long len;
+
+  in->buf = NULL;
+
+  if ((fp = fopen(fname,"rb")) == NULL)
+    return 1;
+
+  fseek(fp, 0, SEEK_END);
+  len = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+
+  if (len < 0) {
+    fclose(fp);
+    return 1;
+  }
+
+  in->buf = (char*)calloc_1d_array(len+1, sizeof(char));
+  in->len = fread(in->buf, sizeof(char), len, fp);
+  in->buf[in->len] = '\0';
+  fclose(fp);
+
+  strncpy(in->fname, fname, MAXLEN-1);
+  in->fname[MAXLEN-1] = '\0';
+  in->pos  = 0;
+  in->bol  = 0;
+  in->line = 1;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Free the file buffer
+ */
+void close_input(InputFile *in)
+{
+  if (in->buf != NULL) free_1d_array(in->buf);
+  in->buf = NULL;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Skip everything up to and including the next newline
+ */
+void input_skipline(InputFile *in)
+{
+  while ((in->pos < in->len) && (in->buf[in->pos] != '\n'))
+    in->pos++;
+
+  if (in->pos < in->len) {
+    in->pos++;
+    in->line++;
+    in->bol = in->pos;
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Skip whitespace, keeping track of line numbers. This is the equivalent of
+ * a trailing "\n" in an fscanf format.
+ */
+void input_skipws(InputFile *in)
+{
+  while ((in->pos < in->len) && IS_SPACE(in->buf[in->pos]))
+  {
+    if (in->buf[in->pos] == '\n') {
+      in->line++;
+      in->bol = in->pos+1;
+    }
+    in->pos++;
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Read a word of at most maxlen-1 characters; what describes the expected
+ * item in error messages.
+ */
+void input_word(InputFile *in, char *word, int maxlen, char *what)
+{
+  size_t end;
+
+  input_skipws(in);
+  end = input_tokend(in);
+
+  if (end == in->pos)
+    input_error(in, "expected %s, found end of file", what);
+
+  if (end-in->pos > (size_t)(maxlen-1))
+    input_error(in, "%s is longer than %d characters", what, maxlen-1);
+
+  memcpy(word, in->buf+in->pos, end-in->pos);
+  word[end-in->pos] = '\0';
+
+  in->pos = end;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Read an integer
+ */
+int input_int(InputFile *in, char *what)
+{
+  size_t p, end;
+  long val = 0;
+  int sgn = 1;
+
+  input_skipws(in);
+  end = input_tokend(in);
+  p = in->pos;
+
+  if (end == p)
+    input_error(in, "expected %s, found end of file", what);
+
+  if ((in->buf[p] == '+') || (in->buf[p] == '-'))
+    sgn = (in->buf[p++] == '-') ? -1 : 1;
+
+  if (p == end)
+    input_error(in, "expected %s (an integer)", what);
+
+  for (; p<end; p++)
+  {
+    if ((in->buf[p] < '0') || (in->buf[p] > '9') || (val > 100000000L))
+      input_error(in, "expected %s (an integer)", what);
+    val = 10*val + (in->buf[p]-'0');
+  }
+
+  in->pos = end;
+
+  return sgn*(int)val;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Read a real number: [+-]digits[.digits][(e|E)[+-]digits]
+ * The value is exact when the mantissa has at most 15 significant digits and
+ * the decimal exponent is at most 22 in magnitude (a single correctly rounded
+ * multiplication or division); otherwise strtod is used.
+ */
+Real input_real(InputFile *in, char *what)
+{
+  size_t p, end;
+  int sgn = 1, nd = 0, nsig = 0, exact = 1, e = 0, ex = 0, esgn = 1;
+  double m = 0.0, val;
+
+  input_skipws(in);
+  end = input_tokend(in);
+  p = in->pos;
+
+  if (end == p)
+    input_error(in, "expected %s, found end of file", what);
+
+  if ((in->buf[p] == '+') || (in->buf[p] == '-'))
+    sgn = (in->buf[p++] == '-') ? -1 : 1;
+
+  /* integer part */
+  for (; (p<end) && (in->buf[p]>='0') && (in->buf[p]<='9'); p++, nd++)
+  {
+    if ((nsig > 0) || (in->buf[p] != '0')) nsig++;
+    if (nsig <= 15) m = 10.0*m + (in->buf[p]-'0');
+    else { exact = 0; e++; }
+  }
+
+  /* fraction */
+  if ((p<end) && (in->buf[p] == '.'))
+  {
+    for (p++; (p<end) && (in->buf[p]>='0') && (in->buf[p]<='9'); p++, nd++)
+    {
+      if ((nsig > 0) || (in->buf[p] != '0')) nsig++;
+      if (nsig <= 15) { m = 10.0*m + (in->buf[p]-'0'); e--; }
+      else exact = 0;
+    }
+  }
+
+  if (nd == 0)
+    input_error(in, "expected %s (a number)", what);
+
+  /* exponent */
+  if ((p<end) && ((in->buf[p] == 'e') || (in->buf[p] == 'E')))
+  {
+    p++;
+    if ((p<end) && ((in->buf[p] == '+') || (in->buf[p] == '-')))
+      esgn = (in->buf[p++] == '-') ? -1 : 1;
+
+    if ((p == end) || (in->buf[p] < '0') || (in->buf[p] > '9'))
+      input_error(in, "expected %s (a number)", what);
+
+    for (; (p<end) && (in->buf[p]>='0') && (in->buf[p]<='9'); p++)
+      if (ex < 10000) ex = 10*ex + (in->buf[p]-'0');
+
+    e += esgn*ex;
+  }
+
+  if (p != end)
+    input_error(in, "expected %s (a number)", what);
+
+  if (exact && (e >= -22) && (e <= 22))
+    val = sgn*((e >= 0) ? m*pow10tab[e] : m/pow10tab[-e]);
+  else
+    val = strtod(in->buf+in->pos, NULL);
+
+  in->pos = end;
+
+  return val;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Read a species name and return its label. "0" means no species and gives
+ * -10; any other unknown name is an error.
+ */
+int input_species(InputFile *in, Chemistry *Chem, char *name)
+{
+  int k;
+  size_t start;
+
+  input_skipws(in);
+  start = in->pos;
+
+  input_word(in, name, NL_SPE, "a species name");
+
+  k = FindSpecies(Chem, name);
+
+  if ((k < 0) && (strcmp(name,"0") != 0)) {
+    in->pos = start;
+    input_error(in, "unknown species \"%s\"", name);
+  }
+
+  return k;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Report an error at the current position and stop
+ */
+void input_error(InputFile *in, char *fmt, ...)
+{
+  va_list ap;
+  char msg[MAXLEN];
+
+  va_start(ap, fmt);
+  vsnprintf(msg, MAXLEN, fmt, ap);
+  va_end(ap);
+
+  ath_error("[%s:%d:%d]: %s!\n", in->fname, in->line,
+            (int)(in->pos-in->bol)+1, msg);
+
+  return;
+}
+
+/*============================================================================*/
+/*----------------------------- Private Functions ----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* End of the token at the current position
+ */
+size_t input_tokend(InputFile *in)
+{
+  size_t p = in->pos;
+
+  while ((p < in->len) && !IS_SPACE(in->buf[p]) && (in->buf[p] != '\0'))
+    p++;
+
+  return p;
+}
+
+#undef IS_SPACE
+
+#endif /* CHEMISTRY */
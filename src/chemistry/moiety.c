@@ -0,0 +1,231 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: moiety.c
+ *
+ * PURPOSE: Contains functions to eliminate the conserved moieties from the
+ *   reaction equations. The number density of every element (and of every
+ *   grain type) and the charge density are conserved exactly by the
+ *   reactions:
+ *
+ *     sum_k M[r][k] n[k] = T[r],   r = 0..N_Ele+NGrain   (last row: charge)
+ *
+ *   where M[r][k] is the composition of species k (its charge for the last
+ *   row) and T[r] is set by the initial densities. Each independent row fixes
+ *   one species, so only the others need to be integrated. M is reduced to
+ *   row echelon form by Gauss-Jordan elimination, choosing as the dependent
+ *   species of each row the most abundant one among those it contains: then
+ *
+ *     n[dep[r]] = T'[r] - sum_{k independent} R[r][k] n[k]
+ *
+ *   with R, T' the reduced matrix and totals. Rows that are combinations of
+ *   the others (e.g. an element absent from the network) are dropped.
+ *   Taking the most abundant species keeps the subtraction well conditioned,
+ *   so the choice is revised as the abundances evolve (moiety_pivot()).
+ *
+ *   Enabled by problem/moiety=1 (see evolve.c), which replaces the make-up
+ *   of the densities in EleMakeup().
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   init_moiety()   - conservation matrix and totals of a chemistry model
+ *   final_moiety()  - free the conservation data
+ *   moiety_pivot()  - choose the dependent species for the given densities
+ *   moiety_expand() - densities of all species from the independent ones
+ *
+ * REFERENCES:
+ *   Sauro, H. M. & Ingalls, B., 2004, Biophys. Chem., 109, 1
+==============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+
+#ifdef CHEMISTRY
+
+/* entries of the reduced matrix below this are zero */
+#define MO_TOL 1.0e-10
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Set up the conservation matrix of all elements, grain types and the charge,
+ * with the totals from the number densities n, and choose the dependent
+ * species
+ */
+void init_moiety(Chemistry *Chem, Real *n, ChemMoiety *Mo)
+{
+  int r, k;
+
+  Mo->N  = Chem->Ntot;
+  Mo->NR = Chem->N_Ele_tot + 1;
+
+  Mo->M  = (Real**)calloc_2d_array(Mo->NR, Mo->N, sizeof(Real));
+  Mo->R  = (Real**)calloc_2d_array(Mo->NR, Mo->N, sizeof(Real));
+  Mo->T  = (Real*)calloc_1d_array(Mo->NR, sizeof(Real));
+  Mo->T0 = (Real*)calloc_1d_array(Mo->NR, sizeof(Real));
+  Mo->dep = (int*)calloc_1d_array(Mo->NR, sizeof(int));
+  Mo->ind = (int*)calloc_1d_array(Mo->N, sizeof(int));
+  Mo->pos = (int*)calloc_1d_array(Mo->N, sizeof(int));
+  Mo->n   = (Real*)calloc_1d_array(Mo->N, sizeof(Real));
+
+  for (k=0; k<Mo->N; k++)
+  {
+    for (r=0; r<Chem->N_Ele_tot; r++)
+      Mo->M[r][k] = MAX(Chem->Species[k].composition[r], 0);
+    Mo->M[Chem->N_Ele_tot][k] = Chem->Species[k].charge;
+  }
+
+  for (r=0; r<Mo->NR; r++)
+  {
+    Mo->T0[r] = 0.0;
+    for (k=0; k<Mo->N; k++)
+      Mo->T0[r] += Mo->M[r][k] * n[k];
+  }
+
+  /* no species is dependent yet */
+  Mo->NC = 0;
+  for (k=0; k<Mo->N; k++)
+    Mo->pos[k] = k;
+
+  moiety_pivot(Mo, n);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Free the conservation data
+ */
+void final_moiety(ChemMoiety *Mo)
+{
+  free_2d_array(Mo->M);
+  free_2d_array(Mo->R);
+  free_1d_array(Mo->T);
+  free_1d_array(Mo->T0);
+  free_1d_array(Mo->dep);
+  free_1d_array(Mo->ind);
+  free_1d_array(Mo->pos);
+  free_1d_array(Mo->n);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Reduce the conservation matrix, taking the most abundant species at the
+ * densities n as the dependent one of each row. Sets dep[], ind[] and pos[]
+ * (position of a species in the reduced vector, -1 if dependent), and returns
+ * 1 if the dependent species have changed, 0 otherwise.
+ */
+int moiety_pivot(ChemMoiety *Mo, Real *n)
+{
+  int r, s, k, c, rp, cp, NC, changed;
+  int *used;
+  Real f;
+
+  for (r=0; r<Mo->NR; r++)
+  {
+    for (k=0; k<Mo->N; k++)
+      Mo->R[r][k] = Mo->M[r][k];
+    Mo->T[r] = Mo->T0[r];
+  }
+
+  /* Gauss-Jordan elimination; used[k] marks the dependent species */
+  used = (int*)calloc_1d_array(Mo->N, sizeof(int));
+
+  for (NC=0; NC<Mo->NR; NC++)
+  {
+    rp = -1;
+    cp = -1;
+    for (r=NC; r<Mo->NR; r++)
+      for (k=0; k<Mo->N; k++)
+        if (!used[k] && (fabs(Mo->R[r][k]) > MO_TOL) &&
+            ((cp < 0) || (n[k] > n[cp]))) {
+          rp = r;
+          cp = k;
+        }
+
+    if (cp < 0) break;                  /* remaining rows are dependent */
+
+    /* row rp to position NC */
+    for (k=0; k<Mo->N; k++) {
+      f = Mo->R[rp][k];  Mo->R[rp][k] = Mo->R[NC][k];  Mo->R[NC][k] = f;
+    }
+    f = Mo->T[rp];  Mo->T[rp] = Mo->T[NC];  Mo->T[NC] = f;
+
+    f = 1.0/Mo->R[NC][cp];
+    for (k=0; k<Mo->N; k++)
+      Mo->R[NC][k] *= f;
+    Mo->T[NC] *= f;
+    Mo->R[NC][cp] = 1.0;
+
+    for (s=0; s<Mo->NR; s++)
+    {
+      if ((s == NC) || (Mo->R[s][cp] == 0.0)) continue;
+      f = Mo->R[s][cp];
+      for (k=0; k<Mo->N; k++)
+        Mo->R[s][k] -= f*Mo->R[NC][k];
+      Mo->T[s] -= f*Mo->T[NC];
+      Mo->R[s][cp] = 0.0;
+    }
+
+    used[cp] = 1;
+    Mo->dep[NC] = cp;
+  }
+
+  /* compare with the previous choice, then number the independent species */
+  changed = (NC != Mo->NC);
+  for (r=0; (r<NC) && !changed; r++)
+    changed = (Mo->pos[Mo->dep[r]] >= 0);
+
+  Mo->NC = NC;
+  Mo->NI = 0;
+  for (k=0; k<Mo->N; k++)
+  {
+    if (used[k])
+      Mo->pos[k] = -1;
+    else {
+      Mo->pos[k] = Mo->NI;
+      Mo->ind[Mo->NI++] = k;
+    }
+  }
+
+  free_1d_array(used);
+
+  /* drop round-off in the reduced rows */
+  for (r=0; r<NC; r++)
+    for (c=0; c<Mo->NI; c++)
+      if (fabs(Mo->R[r][Mo->ind[c]]) < MO_TOL) Mo->R[r][Mo->ind[c]] = 0.0;
+
+  return changed;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Densities n of all species from those of the independent ones, x (at their
+ * positions pos[] in the reduced vector)
+ */
+void moiety_expand(ChemMoiety *Mo, Real *x, Real *n)
+{
+  int r, c;
+  Real sum;
+
+  for (c=0; c<Mo->NI; c++)
+    n[Mo->ind[c]] = x[c];
+
+  for (r=0; r<Mo->NC; r++)
+  {
+    sum = Mo->T[r];
+    for (c=0; c<Mo->NI; c++)
+      sum -= Mo->R[r][Mo->ind[c]] * x[c];
+    n[Mo->dep[r]] = sum;
+  }
+
+  return;
+}
+
+#undef MO_TOL
+
+#endif /* CHEMISTRY */
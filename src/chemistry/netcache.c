@@ -0,0 +1,300 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: netcache.c
+ *
+ * PURPOSE: Contains functions to save the fully constructed chemistry model
+ *   (elements, species, reactions with all temperature ranges, evolution
+ *   equations and the name hash tables) into one flat binary file, and to
+ *   load it back by memory mapping instead of parsing the input files and
+ *   rebuilding grain species, grain reactions and equations.
+ *
+ *   File layout (all sections aligned to NC_ALIGN bytes):
+ *     NetCacheHeader  - magic, version, structure sizes, content hashes of
+ *                       the species and reaction input files, image size and
+ *                       checksum of everything after the header
+ *     Chemistry       - copy of the model structure
+ *     arena           - all arrays of the model, as laid out by arena_pack()
+ *   Pointers inside the image are stored as byte offsets from the start of
+ *   the arena. The loader maps the file privately (copy-on-write) and turns
+ *   the offsets back into pointers in place, so nothing is copied.
+ *
+ *   The cache is rebuilt whenever the version, the structure sizes, the
+ *   checksum, the content of job/read_species or job/read_reaction, or the
+ *   grain charge representation (problem/grlump) do not match.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   read_netcache()  - map a network cache file into a Chemistry structure
+ *   write_netcache() - write a Chemistry structure to a network cache file
+ *   final_netcache() - unmap the network cache
+==============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+
+#ifdef CHEMISTRY
+
+#define NETCACHE_VERSION 4
+#define NC_ALIGN 64
+#define NC_PAD(x) ((((size_t)(x))+NC_ALIGN-1) & ~((size_t)NC_ALIGN-1))
+
+/* Header of the cache file */
+typedef struct NetCacheHeader_s {
+
+  char magic[8];              /* "NETCACHE" */
+  int version;                /* NETCACHE_VERSION */
+  int sizes[8];               /* sizes of Real and of the structures */
+  uint32_t srchash[2];        /* content hash of species/reaction files */
+  size_t size;                /* total size of the file */
+  uint32_t checksum;          /* checksum of the image after the header */
+
+}NetCacheHeader;
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   NC_filehash()  - content hash of a file
+ *   NC_sizes()     - fill the structure sizes of the header
+ *   NC_srchash()   - content hashes of the input files of the network
+ *============================================================================*/
+
+int  NC_filehash(char *fname, uint32_t *h);
+void NC_sizes(int *sizes);
+int  NC_srchash(uint32_t *h);
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Map the network cache fname into Chem. Return 0 on success, nonzero if the
+ * file does not exist or is out of date (Chem is then left untouched).
+ */
+int read_netcache(Chemistry *Chem, char *fname)
+{
+  int fd, sizes[8];
+  struct stat st;
+  char *base, *arena;
+  NetCacheHeader *H;
+  Chemistry *C;
+  uint32_t src[2];
+  size_t len;
+
+  if ((fd = open(fname, O_RDONLY)) < 0)
+    return 1;
+
+  if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < NC_PAD(sizeof(NetCacheHeader))
+                                                    + sizeof(Chemistry))) {
+    close(fd);
+    return 1;
+  }
+
+  len  = (size_t)st.st_size;
+  base = (char*)mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (base == MAP_FAILED)
+    return 1;
+
+  H = (NetCacheHeader*)base;
+  NC_sizes(sizes);
+
+  if ((strncmp(H->magic, "NETCACHE", 8) != 0)
+   || (H->version != NETCACHE_VERSION)
+   || (memcmp(H->sizes, sizes, sizeof(sizes)) != 0)
+   || (H->size != len)
+   || (NC_srchash(src) != 0)
+   || (H->srchash[0] != src[0]) || (H->srchash[1] != src[1])
+   || (fnv1a(FNV1A_BASIS, base+NC_PAD(sizeof(NetCacheHeader)),
+             len-NC_PAD(sizeof(NetCacheHeader))) != H->checksum))
+  {
+    munmap(base, len);
+    ath_pout(0,"Network cache %s is out of date; rebuilding.\n", fname);
+    return 1;
+  }
+
+  /* relocate: offsets -> pointers */
+  C = (Chemistry*)(base + NC_PAD(sizeof(NetCacheHeader)));
+  arena = base + NC_PAD(sizeof(NetCacheHeader)) + NC_PAD(sizeof(Chemistry));
+
+  if (C->Arena_size != len - (size_t)(arena-base)) {
+    munmap(base, len);
+    return 1;
+  }
+
+  arena_relocate(C, arena, 0, (size_t)arena);
+
+  *Chem = *C;
+
+  Chem->RTab = NULL;
+  Chem->Order = NULL;
+  Chem->NetMap = base;
+  Chem->NetMap_size = len;
+
+  ath_pout(0,"Network read from cache %s: %d species, %d reactions.\n",
+              fname, Chem->Ntot, Chem->NReaction);
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Write the chemistry model to the network cache fname. The file is written
+ * under a temporary name and renamed, so that concurrent runs never see a
+ * partial file.
+ */
+void write_netcache(Chemistry *Chem, char *fname)
+{
+  size_t off, size, n;
+  char *buf, tmpname[MAXLEN];
+  NetCacheHeader *H;
+  Chemistry *C;
+  FILE *fp;
+
+/* Size of the image */
+
+  off  = NC_PAD(sizeof(NetCacheHeader)) + NC_PAD(sizeof(Chemistry));
+  size = off + arena_size(Chem);
+
+/* Copy the model and replace the pointers by offsets */
+
+  buf = (char*)calloc_1d_array(size, sizeof(char));
+
+  H = (NetCacheHeader*)buf;
+
+  C = (Chemistry*)(buf + NC_PAD(sizeof(NetCacheHeader)));
+  *C = *Chem;
+  C->RTab = NULL;
+  C->Order = NULL;
+  C->NetMap = NULL;
+  C->NetMap_size = 0;
+
+  arena_pack(Chem, buf+off, C);
+  arena_relocate(C, buf+off, (size_t)(buf+off), 0);
+
+/* Header */
+
+  memcpy(H->magic, "NETCACHE", 8);
+  H->version = NETCACHE_VERSION;
+  NC_sizes(H->sizes);
+  if (NC_srchash(H->srchash) != 0)
+    ath_error("[write_netcache]: Unable to read the network input files!\n");
+  H->size = size;
+  H->checksum = fnv1a(FNV1A_BASIS, buf+NC_PAD(sizeof(NetCacheHeader)),
+                      size-NC_PAD(sizeof(NetCacheHeader)));
+
+/* Write and rename */
+
+  sprintf(tmpname, "%s.%d", fname, (int)getpid());
+
+  if ((fp = fopen(tmpname,"wb")) == NULL) {
+    ath_perr(-1,"[write_netcache]: Unable to open %s!\n", tmpname);
+    free_1d_array(buf);
+    return;
+  }
+
+  n = fwrite(buf, sizeof(char), size, fp);
+  fclose(fp);
+
+  if ((n != size) || (rename(tmpname, fname) != 0)) {
+    ath_perr(-1,"[write_netcache]: Failed to write %s!\n", fname);
+    remove(tmpname);
+  }
+  else
+    ath_pout(0,"Network cache written to %s (%lu bytes).\n",
+                fname, (unsigned long)size);
+
+  free_1d_array(buf);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Unmap the network cache of a chemistry model
+ */
+void final_netcache(Chemistry *Chem)
+{
+  if (Chem->NetMap == NULL) return;
+
+  munmap(Chem->NetMap, Chem->NetMap_size);
+
+  Chem->NetMap = NULL;
+  Chem->NetMap_size = 0;
+
+  return;
+}
+
+/*============================================================================*/
+/*----------------------------- Private Functions ----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Content hash of a file; return nonzero if it cannot be read
+ */
+int NC_filehash(char *fname, uint32_t *h)
+{
+  FILE *fp;
+  char chunk[4096];
+  size_t n;
+
+  if ((fp = fopen(fname,"rb")) == NULL)
+    return 1;
+
+  *h = FNV1A_BASIS;
+  while ((n = fread(chunk, sizeof(char), sizeof(chunk), fp)) > 0)
+    *h = fnv1a(*h, chunk, n);
+
+  fclose(fp);
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Sizes of Real and of all structures stored in the cache
+ */
+void NC_sizes(int *sizes)
+{
+  sizes[0] = sizeof(Real);
+  sizes[1] = sizeof(Chemistry);
+  sizes[2] = sizeof(ElementInfo);
+  sizes[3] = sizeof(SpeciesInfo);
+  sizes[4] = sizeof(ReactionInfo);
+  sizes[5] = sizeof(Coefficient);
+  sizes[6] = sizeof(EquationInfo);
+  sizes[7] = sizeof(EquationTerm);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Content hashes of the species and reaction input files; that of the
+ * species also covers problem/grlump, which changes the species built
+ */
+int NC_srchash(uint32_t *h)
+{
+  int err, lump;
+  char *fname;
+
+  fname = par_gets("job","read_species");
+  err = NC_filehash(fname, &(h[0]));
+  free(fname);
+  lump = par_geti_def("problem","grlump",0);
+  h[0] = fnv1a(h[0], &lump, sizeof(int));
+
+  fname = par_gets("job","read_reaction");
+  err = err || NC_filehash(fname, &(h[1]));
+  free(fname);
+
+  return err;
+}
+
+#undef NETCACHE_VERSION
+#undef NC_ALIGN
+#undef NC_PAD
+
+#endif /* CHEMISTRY */
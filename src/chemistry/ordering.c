@@ -0,0 +1,343 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: ordering.c
+ *
+ * PURPOSE: Contains functions to order the species in the solver state vector
+ *   so that the Jacobian of the reaction equations has a small bandwidth. In
+ *   the natural species order (e-, neutrals, ions, mantles, grain charge
+ *   ladders) the couplings are scattered all over the matrix, and the band
+ *   preconditioner has to treat the Jacobian as dense.
+ *
+ *   The ordering is the reverse Cuthill-McKee ordering of the (symmetrized)
+ *   coupling graph of the species: species k and p are coupled if p appears
+ *   in a reaction term of the equation of k. Only the state vector of the
+ *   solver is permuted; all other arrays keep the species labels.
+ *
+ *   Enabled by problem/reorder=1. The half-bandwidths mu and ml of the
+ *   permuted Jacobian are then passed to the band preconditioner. If the
+ *   natural order happens to have a smaller bandwidth, it is kept.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   init_ordering()  - compute the solver ordering of the species
+ *   final_ordering() - free the solver ordering
+ *   Bandwidth()      - half-bandwidths of the Jacobian for a given order
+ *
+ * REFERENCES:
+ *   Cuthill, E. & McKee, J., 1969, Proc. 24th Nat. Conf. ACM, 157
+ *   George, A. & Liu, J. W., 1981, Computer Solution of Large Sparse Positive
+ *     Definite Systems (Prentice-Hall)
+==============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+
+#ifdef CHEMISTRY
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   CouplingGraph() - adjacency (CSR) of the symmetrized coupling graph
+ *   LevelBFS()      - breadth first search over the unnumbered species
+ *   Peripheral()    - find a pseudo-peripheral species
+ *============================================================================*/
+
+void CouplingGraph(Chemistry *Chem, int **xadj, int **adj);
+int  LevelBFS(int *xadj, int *adj, int root, int *done, int *level,
+              int *queue);
+int  Peripheral(int *xadj, int *adj, int root, int *done, int *level,
+                int *queue);
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Compute the reverse Cuthill-McKee order of the species for the solver
+ */
+void init_ordering(Chemistry *Chem)
+{
+  int i, j, k, m, n, head, tail, v, w, N = Chem->Ntot;
+  int *xadj, *adj, *done, *level, *queue, *order;
+  ChemOrder *Ord;
+
+  CouplingGraph(Chem, &xadj, &adj);
+
+  done  = (int*)calloc_1d_array(N, sizeof(int));
+  level = (int*)calloc_1d_array(N, sizeof(int));
+  queue = (int*)calloc_1d_array(N, sizeof(int));
+  order = (int*)calloc_1d_array(N, sizeof(int));
+
+  for (i=0; i<N; i++)
+    level[i] = -1;
+
+  n = 0;
+  while (n < N)
+  {
+    /* start from a pseudo-peripheral species of the next component */
+    v = -1;
+    for (i=0; i<N; i++)
+      if (!done[i] && ((v < 0) || (xadj[i+1]-xadj[i] < xadj[v+1]-xadj[v])))
+        v = i;
+
+    v = Peripheral(xadj, adj, v, done, level, queue);
+
+    /* Cuthill-McKee: neighbours in order of increasing degree */
+    order[n] = v;
+    done[v] = 1;
+    head = n;
+    tail = n+1;
+    while (head < tail)
+    {
+      v = order[head++];
+      m = tail;
+      for (k=xadj[v]; k<xadj[v+1]; k++)
+      {
+        w = adj[k];
+        if (done[w]) continue;
+        done[w] = 1;
+
+        for (j=tail; (j>m) && (xadj[order[j-1]+1]-xadj[order[j-1]]
+                                > xadj[w+1]-xadj[w]); j--)
+          order[j] = order[j-1];
+        order[j] = w;
+        tail++;
+      }
+    }
+    n = tail;
+  }
+
+  Ord = (ChemOrder*)calloc_1d_array(1, sizeof(ChemOrder));
+  Ord->N = N;
+  Ord->perm  = (int*)calloc_1d_array(MAX(N,1), sizeof(int));
+  Ord->iperm = (int*)calloc_1d_array(MAX(N,1), sizeof(int));
+
+  /* reverse */
+  for (i=0; i<N; i++)
+  {
+    Ord->perm[i] = order[N-1-i];
+    Ord->iperm[Ord->perm[i]] = i;
+  }
+
+  Bandwidth(Chem, NULL, &(Ord->mu0), &(Ord->ml0));
+  Bandwidth(Chem, Ord->iperm, &(Ord->mu), &(Ord->ml));
+
+  if (Ord->mu+Ord->ml > Ord->mu0+Ord->ml0)
+  {/* keep the natural order */
+    for (i=0; i<N; i++) {
+      Ord->perm[i] = i;
+      Ord->iperm[i] = i;
+    }
+    Ord->mu = Ord->mu0;
+    Ord->ml = Ord->ml0;
+  }
+
+  ath_pout(0,"Species ordering: bandwidth (mu,ml) = (%d,%d), "
+             "natural order (%d,%d), %d species.\n",
+              Ord->mu, Ord->ml, Ord->mu0, Ord->ml0, N);
+
+  Chem->Order = Ord;
+
+  free_1d_array(xadj);
+  free_1d_array(adj);
+  free_1d_array(done);
+  free_1d_array(level);
+  free_1d_array(queue);
+  free_1d_array(order);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Free the solver ordering
+ */
+void final_ordering(Chemistry *Chem)
+{
+  if (Chem->Order == NULL) return;
+
+  free_1d_array(Chem->Order->perm);
+  free_1d_array(Chem->Order->iperm);
+  free_1d_array(Chem->Order);
+
+  Chem->Order = NULL;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Upper (mu) and lower (ml) half-bandwidths of the Jacobian when species k is
+ * at position iperm[k] of the state vector (natural order if iperm is NULL)
+ */
+void Bandwidth(Chemistry *Chem, int *iperm, int *mu, int *ml)
+{
+  int i, j, k, p, d;
+  EquationInfo *Eq;
+
+  *mu = 0;
+  *ml = 0;
+
+  for (k=0; k<Chem->Ntot; k++)
+  {
+    Eq = &(Chem->Equations[k]);
+    for (i=0; i<Eq->NTerm; i++)
+      for (j=0; j<Eq->EqTerm[i].N; j++)
+      {
+        p = Eq->EqTerm[i].lab[j];
+        d = (iperm != NULL) ? iperm[p]-iperm[k] : p-k;
+        if (d > *mu)  *mu = d;
+        if (-d > *ml) *ml = -d;
+      }
+  }
+
+  return;
+}
+
+/*============================================================================*/
+/*----------------------------- Private Functions ----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Adjacency of the coupling graph in compressed row storage: the neighbours
+ * of species k are adj[xadj[k]..xadj[k+1]-1]. Both xadj and adj are allocated
+ * here.
+ */
+void CouplingGraph(Chemistry *Chem, int **xadj, int **adj)
+{
+  int i, j, k, l, m, p, N = Chem->Ntot;
+  int *mark, *deg, *xa = NULL, *a = NULL;
+  EquationInfo *Eq;
+
+  mark = (int*)calloc_1d_array(MAX(N,1), sizeof(int));
+  deg  = (int*)calloc_1d_array(N+1, sizeof(int));
+
+  /* the equation of k couples k to p and p to k; two passes, the first one
+   * counts the edges (with repetitions), the second one stores them */
+  for (l=0; l<2; l++)
+  {
+    if (l == 1)
+    {
+      xa = (int*)calloc_1d_array(N+1, sizeof(int));
+      for (k=0; k<N; k++)
+        xa[k+1] = xa[k] + deg[k];
+      a = (int*)calloc_1d_array(MAX(xa[N],1), sizeof(int));
+      for (k=0; k<N; k++)
+        deg[k] = 0;
+    }
+
+    for (k=0; k<N; k++)
+    {
+      Eq = &(Chem->Equations[k]);
+      for (i=0; i<Eq->NTerm; i++)
+        for (j=0; j<Eq->EqTerm[i].N; j++)
+        {
+          p = Eq->EqTerm[i].lab[j];
+          if (p == k) continue;
+          if (l == 1) {
+            a[xa[k]+deg[k]] = p;
+            a[xa[p]+deg[p]] = k;
+          }
+          deg[k]++;
+          deg[p]++;
+        }
+    }
+  }
+
+  /* remove the repetitions, compacting the rows in place */
+  for (k=0; k<N; k++)
+    mark[k] = -1;
+
+  m = 0;
+  for (k=0; k<N; k++)
+  {
+    i = xa[k];
+    xa[k] = m;
+    for (; i<xa[k+1]; i++)
+      if (mark[a[i]] != k) {
+        mark[a[i]] = k;
+        a[m++] = a[i];
+      }
+  }
+  xa[N] = m;
+
+  free_1d_array(mark);
+  free_1d_array(deg);
+
+  *xadj = xa;
+  *adj = a;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Breadth first search from root over the species not yet numbered (done=0).
+ * Sets level[] of the visited species and returns their number; the species
+ * are in queue[] by level. level[] is reset to -1 by the caller.
+ */
+int LevelBFS(int *xadj, int *adj, int root, int *done, int *level,
+             int *queue)
+{
+  int k, v, w, head = 0, tail = 1;
+
+  queue[0] = root;
+  level[root] = 0;
+
+  while (head < tail)
+  {
+    v = queue[head++];
+    for (k=xadj[v]; k<xadj[v+1]; k++)
+    {
+      w = adj[k];
+      if (done[w] || (level[w] >= 0)) continue;
+      level[w] = level[v]+1;
+      queue[tail++] = w;
+    }
+  }
+
+  return tail;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Find a pseudo-peripheral species of the component of root (George & Liu):
+ * repeatedly move to a species of minimum degree in the last level, as long
+ * as the eccentricity grows
+ */
+int Peripheral(int *xadj, int *adj, int root, int *done, int *level,
+               int *queue)
+{
+  int i, n, v, ecc, it;
+
+  n = LevelBFS(xadj, adj, root, done, level, queue);
+  ecc = level[queue[n-1]];
+
+  for (it=0; it<8; it++)
+  {
+    /* species of minimum degree in the last level */
+    v = queue[n-1];
+    for (i=n-1; (i>=0) && (level[queue[i]] == ecc); i--)
+      if (xadj[queue[i]+1]-xadj[queue[i]] < xadj[v+1]-xadj[v])
+        v = queue[i];
+
+    for (i=0; i<n; i++)
+      level[queue[i]] = -1;
+
+    n = LevelBFS(xadj, adj, v, done, level, queue);
+
+    if (level[queue[n-1]] <= ecc) {
+      for (i=0; i<n; i++)
+        level[queue[i]] = -1;
+      return v;
+    }
+
+    root = v;
+    ecc = level[queue[n-1]];
+  }
+
+  for (i=0; i<n; i++)
+    level[queue[i]] = -1;
+
+  return root;
+}
+
+#endif /* CHEMISTRY */
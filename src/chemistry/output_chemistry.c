@@ -540,10 +540,22 @@ void ChemSet_allgas(Chemistry *Chem, ChemOutput *ChemOut)
 void ChemSet_selected(Chemistry *Chem, ChemOutput *ChemOut)
 {
   int i, n=0;
+  char *name;
+  void *pos = NULL;
+  int *sel = (int*)calloc_1d_array(Chem->Ntot, sizeof(int));
 
+  /* look up every name in the <out_species> block */
+  while ((name = par_next("out_species",&pos)) != NULL)
+  {
+    if ((i = FindSpecies(Chem, name)) >= 0)
+      sel[i] = 1;
+  }
+
+  /* keep the species order */
+  n = 0;
   for (i=0; i<Chem->Ntot; i++)
   {
-    if (par_exist("out_species",Chem->Species[i].name))
+    if (sel[i])
     {
       ChemOut->ind[n] = i;
       n++;
@@ -552,6 +564,8 @@ void ChemSet_selected(Chemistry *Chem, ChemOutput *ChemOut)
 
   ChemOut->nsp = n;
 
+  free_1d_array(sel);
+
   return;
 }
 
@@ -0,0 +1,274 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: precond.c
+ *
+ * PURPOSE: Contains a preconditioner for the Krylov solver of CVODE that
+ *   exploits the gas/grain partition of the species. With the species in
+ *   their natural order, the iteration matrix P = I - gamma*J splits into
+ *
+ *         | A  B |   A: gas species (0..GrInd-1), dense
+ *     P = |      |   D: grain charge ladders, one per grain type
+ *         | C  D |   B, C: gas/grain coupling
+ *
+ *   A grain charge state couples to the other charge states of the same
+ *   grain type (D is block diagonal, one small block per ladder) and to the
+ *   electrons and ions (C has nonzero columns only for those gas species).
+ *   The system is solved by block elimination:
+ *
+ *     W  = D^{-1} C                  (one ladder solve per column of C)
+ *     S  = A - B W                   (low-rank correction of the gas block)
+ *     xG = S^{-1} (rG - B D^{-1} rL) (dense LU)
+ *     xL = D^{-1} rL - W xG
+ *
+ *   Without grain-grain reactions a ladder is tridiagonal (a charge state only
+ *   couples to its neighbours); charge exchange between grains fills it in,
+ *   so each ladder is factored as a dense (2*GrCharge+1)^2 block. The cost
+ *   of the setup is that of the LU of the gas block plus a term linear in
+ *   the number of grain types, instead of a dense LU of the full system.
+ *   Couplings between different grain types (grain-grain reactions between
+ *   them) are dropped, so the preconditioner is exact only for one grain
+ *   type. J is evaluated analytically from the reaction equations.
+ *
+ *   Enabled by problem/precond=1 (see evolve.c).
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   init_precond()  - allocate the preconditioner of a chemistry model
+ *   final_precond() - free the preconditioner
+ *   precond_setup() - evaluate and factor P for the given densities
+ *   precond_solve() - solve P z = r
+==============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+#include <sundials/sundials_dense.h>
+
+#ifdef CHEMISTRY
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   LadderSolve() - solve the factored systems of all ladders
+ *============================================================================*/
+
+void LadderSolve(ChemPrecond *P, Real *x);
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Allocate the preconditioner and find the coupling structure
+ */
+void init_precond(Chemistry *Chem, ChemPrecond *P)
+{
+  int i, j, k, p, NG, NL;
+  int *mark;
+  EquationInfo *Eq;
+
+  NG = (Chem->NGrain > 0) ? Chem->GrInd : Chem->Ntot;
+  NL = Chem->Ntot - NG;
+
+  P->NG = NG;
+  P->NL = NL;
+  P->LS = (Chem->NGrain > 0) ? 2*Chem->GrCharge+1 : 1;
+
+  P->A    = newDenseMat(NG, NG);
+  P->piv  = newLintArray(NG);
+  P->B    = (Real*)calloc_1d_array(MAX(NG*NL,1), sizeof(Real));
+  P->C    = (Real*)calloc_1d_array(MAX(NL*NG,1), sizeof(Real));
+  P->D    = newDenseMat(P->LS, MAX(NL,1));
+  P->pivL = newLintArray(MAX(NL,1));
+  P->y    = (Real*)calloc_1d_array(MAX(NL,1), sizeof(Real));
+
+  /* gas species entering the equations of the grain species */
+  mark = (int*)calloc_1d_array(MAX(NG,1), sizeof(int));
+
+  P->nc = 0;
+  for (k=NG; k<Chem->Ntot; k++)
+  {
+    Eq = &(Chem->Equations[k]);
+    for (i=0; i<Eq->NTerm; i++)
+      for (j=0; j<Eq->EqTerm[i].N; j++)
+      {
+        p = Eq->EqTerm[i].lab[j];
+        if ((p < NG) && (mark[p] == 0)) {
+          mark[p] = 1;
+          P->nc++;
+        }
+      }
+  }
+
+  P->col = (int*)calloc_1d_array(MAX(P->nc,1), sizeof(int));
+  P->W   = (Real*)calloc_1d_array(MAX(P->nc*NL,1), sizeof(Real));
+
+  j = 0;
+  for (p=0; p<NG; p++)
+    if (mark[p]) P->col[j++] = p;
+
+  free_1d_array(mark);
+
+  P->nsetup = 0;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Free the preconditioner
+ */
+void final_precond(ChemPrecond *P)
+{
+  destroyMat(P->A);
+  destroyArray(P->piv);
+  free_1d_array(P->B);
+  free_1d_array(P->C);
+  destroyMat(P->D);
+  destroyArray(P->pivL);
+  free_1d_array(P->y);
+  free_1d_array(P->col);
+  free_1d_array(P->W);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Evaluate P = I - gamma*J at the number densities n (in species order) with
+ * the rate coefficients K, and factor it. Return 0 on success and 1 if P is
+ * singular (a recoverable failure for CVODE).
+ */
+int precond_setup(ChemPrecond *P, Chemistry *Chem, Real *K, Real *n,
+                  Real gamma)
+{
+  int i, j, k, l, m, p, c, NG = P->NG, NL = P->NL, LS = P->LS;
+  Real val, sum;
+  EquationTerm *Tm;
+
+  for (p=0; p<NG; p++)
+    for (k=0; k<NG; k++)
+      P->A[p][k] = 0.0;
+  for (i=0; i<NG*NL; i++) {
+    P->B[i] = 0.0;
+    P->C[i] = 0.0;
+  }
+  for (l=0; l<NL; l++)
+    for (m=0; m<LS; m++)
+      P->D[l][m] = 0.0;
+
+/* Assemble -gamma*J, term by term */
+
+  for (k=0; k<Chem->Ntot; k++)
+    for (i=0; i<Chem->Equations[k].NTerm; i++)
+    {
+      Tm = &(Chem->Equations[k].EqTerm[i]);
+
+      for (j=0; j<Tm->N; j++)
+      {
+        /* derivative with respect to the j-th factor */
+        val = -gamma * K[Tm->ind] * Tm->dir;
+        for (m=0; m<Tm->N; m++)
+          if (m != j) val *= n[Tm->lab[m]];
+
+        p = Tm->lab[j];
+
+        if (k < NG)
+        {
+          if (p < NG)  P->A[p][k] += val;        /* column major */
+          else         P->B[k*NL+p-NG] += val;
+        }
+        else if (p < NG)
+          P->C[(k-NG)*NG+p] += val;
+        else if ((k-NG)/LS == (p-NG)/LS)          /* same ladder */
+          P->D[p-NG][(k-NG)%LS] += val;
+      }
+    }
+
+  for (k=0; k<NG; k++)
+    P->A[k][k] += 1.0;
+  for (l=0; l<NL; l++)
+    P->D[l][l%LS] += 1.0;
+
+/* Factor the ladders: columns l0..l0+LS-1 of D hold the block of a ladder */
+
+  for (l=0; l<NL; l+=LS)
+    if (denseGETRF(&(P->D[l]), LS, LS, &(P->pivL[l])) != 0) return 1;
+
+/* Schur complement of the gas block */
+
+  for (c=0; c<P->nc; c++)
+  {
+    p = P->col[c];
+
+    for (l=0; l<NL; l++)
+      P->W[c*NL+l] = P->C[l*NG+p];
+
+    LadderSolve(P, &(P->W[c*NL]));
+
+    for (k=0; k<NG; k++)
+    {
+      sum = 0.0;
+      for (l=0; l<NL; l++)
+        sum += P->B[k*NL+l]*P->W[c*NL+l];
+      P->A[p][k] -= sum;
+    }
+  }
+
+  if (denseGETRF(P->A, NG, NG, P->piv) != 0) return 1;
+
+  P->nsetup++;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Solve P z = r (both in species order); r and z may be the same array
+ */
+void precond_solve(ChemPrecond *P, Real *r, Real *z)
+{
+  int k, l, c, NG = P->NG, NL = P->NL;
+  Real sum;
+
+  /* y = D^{-1} rL */
+  for (l=0; l<NL; l++)
+    P->y[l] = r[NG+l];
+  LadderSolve(P, P->y);
+
+  /* xG = S^{-1} (rG - B y) */
+  for (k=0; k<NG; k++)
+  {
+    sum = r[k];
+    for (l=0; l<NL; l++)
+      sum -= P->B[k*NL+l]*P->y[l];
+    z[k] = sum;
+  }
+  denseGETRS(P->A, NG, P->piv, z);
+
+  /* xL = y - W xG */
+  for (l=0; l<NL; l++)
+    z[NG+l] = P->y[l];
+  for (c=0; c<P->nc; c++)
+    for (l=0; l<NL; l++)
+      z[NG+l] -= P->W[c*NL+l]*z[P->col[c]];
+
+  return;
+}
+
+/*============================================================================*/
+/*----------------------------- Private Functions ----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Solve D x = x with the factored ladders
+ */
+void LadderSolve(ChemPrecond *P, Real *x)
+{
+  int l;
+
+  for (l=0; l<P->NL; l+=P->LS)
+    denseGETRS(&(P->D[l]), P->LS, &(P->pivL[l]), &(x[l]));
+
+  return;
+}
+
+#endif /* CHEMISTRY */
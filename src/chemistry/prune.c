@@ -0,0 +1,223 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: prune.c
+ *
+ * PURPOSE: Contains a function to remove the species that can never form and
+ *   the reactions that can never proceed, given the initial condition. Such
+ *   species and reactions are common when a shared species and reaction list
+ *   is used for a smaller problem.
+ *
+ *   Starting from the species present initially (see initial_species()) and
+ *   all grain charge states, a reaction in use becomes usable once all its
+ *   reactants are reachable, and then all its products become reachable. The
+ *   network is then compacted in place: the remaining species and reactions
+ *   keep their order, and all labels are renumbered.
+ *
+ *   Enabled by problem/prune=1. Only the block start indices (NeuInd,
+ *   SNeuInd, SIonInd, GrInd) are renumbered; the counts N_Neu_f, N_Neu,
+ *   N_Neu_s and N_Ion_s still describe the network before pruning.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   prune_chemistry() - remove unreachable species and reactions
+==============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+
+#ifdef CHEMISTRY
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   There is no private function.
+ *============================================================================*/
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Remove all unreachable species and reactions from the chemistry model
+ */
+void prune_chemistry(Chemistry *Chem)
+{
+  int i, j, k, l, n, r, s, head, tail, ns, nr;
+  int *reach, *need, *queue, *smap, *rmap, *cnt;
+  ReactionInfo *R;
+  EquationInfo *Eq;
+  EquationTerm *Tm;
+  ElementInfo *El;
+
+  reach = (int*)calloc_1d_array(Chem->Ntot, sizeof(int));
+  queue = (int*)calloc_1d_array(Chem->Ntot, sizeof(int));
+  smap  = (int*)calloc_1d_array(Chem->Ntot, sizeof(int));
+  cnt   = (int*)calloc_1d_array(Chem->Ntot+1, sizeof(int));
+  need  = (int*)calloc_1d_array(MAX(Chem->NReaction,1), sizeof(int));
+  rmap  = (int*)calloc_1d_array(MAX(Chem->NReaction,1), sizeof(int));
+
+/* Reachability */
+
+  initial_species(Chem, reach);
+  for (i=Chem->GrInd; i<Chem->Ntot; i++)
+    reach[i] = 1;   /* the grain charge ladders are always kept */
+
+  /* number of reactants still to be reached */
+  for (r=0; r<Chem->NReaction; r++)
+  {
+    R = &(Chem->Reactions[r]);
+    need[r] = 0;
+    for (j=0; j<2; j++)
+      if (R->reactant[j] >= 0) need[r]++;
+  }
+
+  tail = 0;
+  for (i=0; i<Chem->Ntot; i++)
+    if (reach[i]) queue[tail++] = i;
+
+  /* the reactant terms of each species list the reactions in use that it
+   * enters (twice if it is both reactants) */
+  for (head=0; head<tail; head++)
+  {
+    Eq = &(Chem->Equations[queue[head]]);
+
+    for (k=0; k<Eq->NTerm; k++)
+    {
+      if (Eq->EqTerm[k].dir > 0) continue;
+
+      r = Eq->EqTerm[k].ind;
+      if (--need[r] > 0) continue;
+
+      for (j=0; j<4; j++)
+      {
+        s = Chem->Reactions[r].product[j];
+        if ((s >= 0) && (reach[s] == 0)) {
+          reach[s] = 1;
+          queue[tail++] = s;
+        }
+      }
+    }
+  }
+
+/* New labels */
+
+  ns = 0;
+  for (i=0; i<Chem->Ntot; i++)
+  {
+    cnt[i] = ns;
+    smap[i] = reach[i] ? ns++ : -1;
+  }
+  cnt[Chem->Ntot] = ns;
+
+  nr = 0;
+  for (r=0; r<Chem->NReaction; r++)
+  {
+    R = &(Chem->Reactions[r]);
+    rmap[r] = nr;
+    for (j=0; j<2; j++)
+      if ((R->reactant[j] >= 0) && (reach[R->reactant[j]] == 0)) rmap[r] = -1;
+    for (j=0; j<4; j++)
+      if ((R->product[j] >= 0) && (reach[R->product[j]] == 0)) rmap[r] = -1;
+    if (rmap[r] >= 0) nr++;
+  }
+
+  ath_pout(0,"\n");
+  ath_pout(0,"Pruning: %d of %d species and %d of %d reactions are unreachable.\n",
+              Chem->Ntot-ns, Chem->Ntot, Chem->NReaction-nr, Chem->NReaction);
+
+  if (ns < Chem->Ntot)
+  {
+    ath_pout(0,"Removed species:");
+    for (i=0; i<Chem->Ntot; i++)
+      if (smap[i] < 0) ath_pout(0," %s", Chem->Species[i].name);
+    ath_pout(0,"\n");
+  }
+
+  if (nr < Chem->NReaction)
+  {
+    ath_pout(0,"Removed reactions:\n");
+    for (r=0; r<Chem->NReaction; r++)
+      if (rmap[r] < 0) PrintReaction(Chem, r, 0.0);
+  }
+  ath_pout(0,"\n");
+
+/* Compact the reactions, equations and species in place */
+
+#define SMAP(p) (((p) >= 0) ? smap[p] : (p))
+
+  for (r=0; r<Chem->NReaction; r++)
+    if ((n = rmap[r]) >= 0)
+    {
+      Chem->Reactions[n] = Chem->Reactions[r];
+      R = &(Chem->Reactions[n]);
+
+      for (j=0; j<2; j++)
+        R->reactant[j] = SMAP(R->reactant[j]);
+      for (j=0; j<4; j++)
+        R->product[j] = SMAP(R->product[j]);
+
+      if (R->inverse >= 0)
+        R->inverse = rmap[R->inverse];
+    }
+
+  for (i=0; i<Chem->Ntot; i++)
+    if ((n = smap[i]) >= 0)
+    {
+      Eq = &(Chem->Equations[i]);
+
+      l = 0;
+      for (k=0; k<Eq->NTerm; k++)
+      {
+        Tm = &(Eq->EqTerm[k]);
+        if (rmap[Tm->ind] < 0) continue;
+
+        Eq->EqTerm[l] = *Tm;
+        Eq->EqTerm[l].ind = rmap[Tm->ind];
+        for (j=0; j<Tm->N; j++)
+          Eq->EqTerm[l].lab[j] = SMAP(Tm->lab[j]);
+        l++;
+      }
+      Eq->NTerm = l;
+
+      Chem->Equations[n] = *Eq;
+      Chem->Species[n] = Chem->Species[i];
+    }
+
+  for (k=0; k<Chem->N_Ele_tot; k++)
+  {
+    El = &(Chem->Elements[k]);
+
+    l = 0;
+    for (j=0; j<El->numsig; j++)
+      if (smap[El->single[j]] >= 0)
+        El->single[l++] = smap[El->single[j]];
+    El->numsig = l;
+  }
+
+#undef SMAP
+
+  Chem->NeuInd  = cnt[MIN(Chem->NeuInd, Chem->Ntot)];
+  Chem->SNeuInd = cnt[MIN(Chem->SNeuInd,Chem->Ntot)];
+  Chem->SIonInd = cnt[MIN(Chem->SIonInd,Chem->Ntot)];
+  Chem->GrInd   = cnt[MIN(Chem->GrInd,  Chem->Ntot)];
+
+  Chem->Ntot = ns;
+  Chem->NReaction = nr;
+  Chem->Reaction_size = nr;
+
+  HashSpecies(Chem);
+
+  free_1d_array(reach);
+  free_1d_array(queue);
+  free_1d_array(smap);
+  free_1d_array(cnt);
+  free_1d_array(need);
+  free_1d_array(rmap);
+
+  return;
+}
+
+#endif /* CHEMISTRY */
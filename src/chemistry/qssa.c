@@ -0,0 +1,298 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: qssa.c
+ *
+ * PURPOSE: Contains functions to take the fast species out of the ODE system
+ *   by the quasi-steady-state approximation. A species destroyed at the rate
+ *   L_i = nu_i n_i, with the destruction frequency
+ *
+ *     nu_i = sum_{destruction terms} K prod_{other reactants} n
+ *
+ *   relaxes to the balance of its formation rate P_i on the timescale
+ *   1/nu_i. When that is much shorter than the evolution of the other
+ *   species, its density follows algebraically from them. With the
+ *   destruction split into the terms linear in n_i and those with i as both
+ *   reactants (H + H), nu_i = a_i + b_i n_i, the balance is
+ *
+ *     P_i = a_i n_i + b_i n_i^2,   n_i = 2 P_i / (a_i + sqrt(a_i^2 + 4 b_i P_i))
+ *
+ *   The fast species may form and destroy each other, so these equations are
+ *   solved together by Gauss-Seidel iteration, starting from the previous
+ *   solution, to the relative accuracy QS_TOL.
+ *
+ *   The fast species are those listed in problem/qsslist (names separated by
+ *   spaces or commas) or, without a list, chosen from the state reached by
+ *   the full network at t = problem/qssstart (years, default 1; see
+ *   evolve.c): the gas species with 1/nu_i shorter than problem/qsstau
+ *   (years, default 1) and holding less than a fraction problem/qssfrac
+ *   (default 1e-6) of every conserved total they contribute to,
+ *
+ *     n_i |M_ri| < qssfrac * sum_k |M_rk| n_k
+ *
+ *   for all elements, grain types and the charge (M_rk as in moiety.c). The
+ *   balance of a fast species does not conserve what it carries, so this
+ *   bounds the error of the conservation laws; it also leaves out the
+ *   reservoirs that only look fast because they exchange rapidly with
+ *   another species. A fast species must also relax faster than the slow
+ *   species it is formed from: one formed from a slow species with which it
+ *   shares an element and that is destroyed more rapidly (a neutral fed by
+ *   the desorption of its mantle species) is evolved, as is then the slower
+ *   partner of such a pair. A set of fast species that only exchange among
+ *   themselves has a singular balance: the electrons, the grains and the
+ *   mantle species are therefore always evolved.
+ *
+ *   Enabled by problem/qssa=1 (see evolve.c): the solver then evolves the
+ *   slow species only, and the fast ones are recomputed from them at every
+ *   evaluation of the reaction rates. The reactions of the fast species with
+ *   each other are kept, but the conservation laws then hold only to the
+ *   accuracy of the approximation.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   init_qssa()  - choose the fast species
+ *   final_qssa() - free the fast species data
+ *   qssa_solve() - densities of the fast species from the slow ones
+ *
+ * REFERENCES:
+ *   Lu, T. & Law, C. K., 2009, Prog. Energy Combust. Sci., 35, 192
+==============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+
+#ifdef CHEMISTRY
+
+/* relative accuracy of the fast densities */
+#define QS_TOL 1.0e-12
+/* maximum number of Gauss-Seidel sweeps */
+#define QS_MAXIT 100
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   ProdDest() - formation rate and destruction frequency of one species
+ *============================================================================*/
+
+void ProdDest(Chemistry *Chem, Real *K, Real *n, int i, Real *P, Real *a,
+              Real *b);
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Choose the fast species, from problem/qsslist or from their destruction
+ * timescale and share of the conserved totals, for the rate coefficients K
+ * and the densities n (in the units of the solver, as the timescale tau in s)
+ */
+void init_qssa(Chemistry *Chem, Real *K, Real *n, Real tau, Real frac,
+               ChemQSSA *Q)
+{
+  int i, j, k, l, c, s, NR = Chem->N_Ele_tot;
+  Real P, a, b, *tot, *nu;
+  EquationTerm *EqTerm;
+  char *list, *name;
+
+  Q->N = Chem->Ntot;
+  Q->pos  = (int*)calloc_1d_array(Q->N, sizeof(int));
+  Q->fast = (int*)calloc_1d_array(Q->N, sizeof(int));
+  Q->slow = (int*)calloc_1d_array(Q->N, sizeof(int));
+  Q->n    = (Real*)calloc_1d_array(Q->N, sizeof(Real));
+
+  for (i=0; i<Q->N; i++)
+    Q->pos[i] = 0;
+
+  if (par_exist("problem","qsslist"))
+  {
+    list = par_gets("problem","qsslist");
+    for (name=strtok(list," ,"); name!=NULL; name=strtok(NULL," ,"))
+    {
+      i = FindSpecies(Chem, name);
+      if (i < 0)
+        ath_error("[init_qssa]: species %s of problem/qsslist is not in the "
+                  "network!\n", name);
+      if ((Chem->Species[i].type == 0) || (Chem->Species[i].type == 3))
+        ath_error("[init_qssa]: %s cannot be in quasi-steady state!\n", name);
+      Q->pos[i] = -1;
+    }
+    free(list);
+  }
+  else
+  {
+    /* conserved totals of the elements, grain types (0..NR-1) and charge */
+    tot = (Real*)calloc_1d_array(NR+1, sizeof(Real));
+    nu  = (Real*)calloc_1d_array(Q->N, sizeof(Real));
+    for (i=0; i<Q->N; i++) {
+      for (j=0; j<NR; j++)
+        tot[j] += MAX(Chem->Species[i].composition[j],0) * fabs(n[i]);
+      tot[NR] += abs(Chem->Species[i].charge) * fabs(n[i]);
+    }
+
+    for (i=0; i<Q->N; i++)
+    {
+      ProdDest(Chem, K, n, i, &P, &a, &b);
+      nu[i] = a + b*n[i];
+
+      if ((Chem->Species[i].type != 1) && (Chem->Species[i].type != 2))
+        continue;
+
+      c = 1;
+      for (j=0; j<NR; j++)
+        if (MAX(Chem->Species[i].composition[j],0)*fabs(n[i]) >= frac*tot[j])
+          c = 0;
+      if (abs(Chem->Species[i].charge)*fabs(n[i]) >= frac*tot[NR])
+        c = 0;
+
+      if (c && (nu[i]*tau > 1.0)) Q->pos[i] = -1;
+    }
+
+    /* no fast species formed from a faster slow one of the same elements */
+    do {
+      c = 0;
+      for (i=0; i<Q->N; i++)
+      {
+        if (Q->pos[i] == 0) continue;
+        for (k=0; k<Chem->Equations[i].NTerm; k++)
+        {
+          EqTerm = &(Chem->Equations[i].EqTerm[k]);
+          if (EqTerm->dir < 0) continue;
+          for (l=0; l<EqTerm->N; l++)
+          {
+            s = EqTerm->lab[l];
+            if ((Q->pos[s] < 0) || (nu[s] <= nu[i])) continue;
+            for (j=0; j<Chem->N_Ele; j++)
+              if ((Chem->Species[i].composition[j] > 0) &&
+                  (Chem->Species[s].composition[j] > 0))
+                break;
+            if (j < Chem->N_Ele) {
+              Q->pos[i] = 0;
+              c = 1;
+            }
+          }
+        }
+      }
+    } while (c);
+
+    free_1d_array(tot);
+    free_1d_array(nu);
+  }
+
+  Q->NF = Q->NS = 0;
+  for (i=0; i<Q->N; i++)
+  {
+    if (Q->pos[i] < 0)
+      Q->fast[Q->NF++] = i;
+    else {
+      Q->pos[i] = Q->NS;
+      Q->slow[Q->NS++] = i;
+    }
+  }
+
+  for (i=0; i<Q->N; i++)
+    Q->n[i] = n[i];
+  Q->nsolve = Q->nfail = 0;
+
+  ath_pout(0,"%d of %d species in quasi-steady state:", Q->NF, Q->N);
+  for (c=0; c<Q->NF; c++)
+    ath_pout(0," %s", Chem->Species[Q->fast[c]].name);
+  ath_pout(0,"\n");
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Free the fast species data
+ */
+void final_qssa(ChemQSSA *Q)
+{
+  free_1d_array(Q->pos);
+  free_1d_array(Q->fast);
+  free_1d_array(Q->slow);
+  free_1d_array(Q->n);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Set the densities of the fast species in n from those of the slow ones and
+ * the rate coefficients K; n holds the previous solution on entry. Returns
+ * the number of sweeps, or -1 if the accuracy was not reached.
+ */
+int qssa_solve(ChemQSSA *Q, Chemistry *Chem, Real *K, Real *n)
+{
+  int c, i, it;
+  Real P, a, b, x, err;
+
+  Q->nsolve++;
+
+  for (it=1; it<=QS_MAXIT; it++)
+  {
+    err = 0.0;
+    for (c=0; c<Q->NF; c++)
+    {
+      i = Q->fast[c];
+      ProdDest(Chem, K, n, i, &P, &a, &b);
+      if (a + b*MAX(P,0.0) <= 0.0) continue;   /* not destroyed: keep */
+
+      x = 2.0*P/(a + sqrt(a*a + 4.0*b*MAX(P,0.0)));
+      err = MAX(err, fabs(x-n[i])/MAX(x,TINY_NUMBER));
+      n[i] = x;
+    }
+    if (err < QS_TOL) return it;
+  }
+
+  Q->nfail++;
+  return -1;
+}
+
+/*============================================================================*/
+/*----------------------------- Private Functions ----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Formation rate P and destruction coefficients a, b of species i, such that
+ * dn_i/dt = P - a*n_i - b*n_i^2
+ */
+void ProdDest(Chemistry *Chem, Real *K, Real *n, int i, Real *P, Real *a,
+              Real *b)
+{
+  int k, l, self;
+  Real rate;
+  EquationTerm *EqTerm;
+
+  *P = *a = *b = 0.0;
+  for (k=0; k<Chem->Equations[i].NTerm; k++)
+  {
+    EqTerm = &(Chem->Equations[i].EqTerm[k]);
+    rate = K[EqTerm->ind];
+
+    if (EqTerm->dir > 0)
+    {
+      for (l=0; l<EqTerm->N; l++)
+        rate *= n[EqTerm->lab[l]];
+      *P += rate;
+    }
+    else
+    {/* the other reactants; i twice goes into b */
+      self = 0;
+      for (l=0; l<EqTerm->N; l++)
+        if (EqTerm->lab[l] == i)
+          self++;
+        else
+          rate *= n[EqTerm->lab[l]];
+      if (self > 1)
+        *b += rate;
+      else
+        *a += rate;
+    }
+  }
+
+  return;
+}
+
+#undef QS_TOL
+#undef QS_MAXIT
+
+#endif /* CHEMISTRY */
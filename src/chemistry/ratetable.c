@@ -0,0 +1,447 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: ratetable.c
+ *
+ * PURPOSE: Contains functions to tabulate the rate coefficients of the
+ *   temperature dependent reactions on a uniform grid in ln(T), so that
+ *   CalCoeff() can obtain them by interpolation instead of evaluating the
+ *   exact expressions in every cell.
+ *
+ *   Reactions of type 1 (gas-phase), 2 (charge+grain), 4 (desorption) and
+ *   5 (grain+grain) only depend on T and are tabulated. Types 3 and 6 also
+ *   depend on density and are always calculated exactly.
+ *
+ *   ln(K) is interpolated by 4-point Lagrange (cubic) interpolation. When the
+ *   table is built, the interpolated K of each reaction is compared with the
+ *   exact value at the middle of every grid interval. Reactions whose maximum
+ *   relative error exceeds the tolerance, or whose K is not positive on the
+ *   grid, fall back to the exact calculation.
+ *
+ *   The table can be saved to and read from a binary file (job/ratetab_file).
+ *   The file stores the grid parameters, a checksum of the reaction network
+ *   and a checksum of the table, and is rebuilt if either does not match.
+ *
+ *   Parameters (block <problem>):
+ *     ratetab      - 1 to use the rate table (default 0)
+ *     ratetab_nT   - number of grid points (default 256)
+ *     ratetab_Tmin - lowest temperature of the grid (default 10 K)
+ *     ratetab_Tmax - highest temperature of the grid (default 3000 K)
+ *     ratetab_tol  - maximum relative interpolation error (default 1e-4)
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   init_ratetable()  - build (or read) the rate table
+ *   final_ratetable() - finalize the rate table
+ *   RateTab_weights() - interpolation stencil and weights at temperature T
+ *   RateTab_value()   - interpolated K of one reaction
+==============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+
+#ifdef CHEMISTRY
+
+#define RATETAB_VERSION 2
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   RateTab_exact()  - exact rate coefficient of a tabulated reaction type
+ *   RateTab_build()  - calculate the table and the interpolation errors
+ *   RateTab_netsum() - checksum of everything the rates depend on
+ *   RateTab_read()   - read the table from file, return 0 on success
+ *   RateTab_write()  - write the table to file
+ *============================================================================*/
+
+Real RateTab_exact(Chemistry *Chem, int i, Real T);
+void RateTab_build(Chemistry *Chem, RateTable *Tab);
+uint32_t RateTab_netsum(Chemistry *Chem);
+int  RateTab_read(Chemistry *Chem, RateTable *Tab, char *fname);
+void RateTab_write(Chemistry *Chem, RateTable *Tab, char *fname);
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Build the rate table of a chemistry model (Chem->RTab), or read it from
+ * job/ratetab_file if the file exists and matches the current network.
+ */
+void init_ratetable(Chemistry *Chem)
+{
+  int i, nerr;
+  Real Tmin, Tmax, errmax;
+  char *fname = NULL;
+  RateTable *Tab;
+
+  Tab = (RateTable*)calloc_1d_array(1, sizeof(RateTable));
+
+  Tab->nT  = par_geti_def("problem","ratetab_nT",256);
+  Tmin     = par_getd_def("problem","ratetab_Tmin",10.0);
+  Tmax     = par_getd_def("problem","ratetab_Tmax",3000.0);
+  Tab->tol = par_getd_def("problem","ratetab_tol",1.0e-4);
+
+  if (Tab->nT < 4)
+    ath_error("[init_ratetable]: ratetab_nT must be at least 4!\n");
+  if ((Tmin <= 0.0) || (Tmax <= Tmin))
+    ath_error("[init_ratetable]: require 0 < ratetab_Tmin < ratetab_Tmax!\n");
+
+  Tab->lnTmin = log(Tmin);
+  Tab->lnTmax = log(Tmax);
+  Tab->dlnT   = (Tab->lnTmax-Tab->lnTmin)/(Real)(Tab->nT-1);
+
+  Tab->ind = (int*)calloc_1d_array(MAX(Chem->NReaction,1), sizeof(int));
+  Tab->err = (Real*)calloc_1d_array(MAX(Chem->NReaction,1), sizeof(Real));
+
+  if (par_exist("job","ratetab_file"))
+    fname = par_gets("job","ratetab_file");
+
+  if ((fname == NULL) || (RateTab_read(Chem, Tab, fname) != 0))
+  {
+    RateTab_build(Chem, Tab);
+
+    if (fname != NULL)
+      RateTab_write(Chem, Tab, fname);
+  }
+
+  /* report */
+  nerr = 0;  errmax = 0.0;
+  for (i=0; i<Chem->NReaction; i++)
+  {
+    if (Tab->ind[i] >= 0)
+      errmax = MAX(errmax, Tab->err[i]);
+    else if (Tab->err[i] != 0.0)
+    {
+      nerr++;
+      ath_pout(1,"Rate table: reaction %d uses exact rates (error %e).\n",
+                  i, Tab->err[i]);
+    }
+  }
+
+  ath_pout(0,"Rate table: %d reactions tabulated for %g<T<%g K, ",
+              Tab->NTab, Tmin, Tmax);
+  ath_pout(0,"max error %e; %d reactions exceed tolerance.\n", errmax, nerr);
+
+  Chem->RTab = Tab;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Finalize the rate table
+ */
+void final_ratetable(Chemistry *Chem)
+{
+  RateTable *Tab = Chem->RTab;
+
+  if (Tab == NULL) return;
+
+  free_1d_array(Tab->ind);
+  free_1d_array(Tab->err);
+  if (Tab->lnK != NULL) free_1d_array(Tab->lnK);
+  free_1d_array(Tab);
+
+  Chem->RTab = NULL;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Interpolation stencil (first grid point j) and weights w[0..3] at
+ * temperature T. Return 0 if T is outside the table.
+ */
+int RateTab_weights(RateTable *Tab, Real T, int *j, Real *w)
+{
+  Real x, t;
+
+  x = (log(T)-Tab->lnTmin)/Tab->dlnT;
+
+  if ((x < 0.0) || (x > (Real)(Tab->nT-1)))
+    return 0;
+
+  /* stencil j..j+3 with the interval in the middle where possible */
+  *j = MIN(MAX((int)(x)-1, 0), Tab->nT-4);
+  t  = x - (Real)(*j);     /* in [0,3] */
+
+  w[0] = -(t-1.0)*(t-2.0)*(t-3.0)/6.0;
+  w[1] =        t*(t-2.0)*(t-3.0)/2.0;
+  w[2] =       -t*(t-1.0)*(t-3.0)/2.0;
+  w[3] =        t*(t-1.0)*(t-2.0)/6.0;
+
+  return 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Interpolated rate coefficient of table column n
+ */
+Real RateTab_value(RateTable *Tab, int n, int j, Real *w)
+{
+  Real *lnK = &(Tab->lnK[j*Tab->NTab+n]);
+  int  s = Tab->NTab;
+
+  return exp(w[0]*lnK[0] + w[1]*lnK[s] + w[2]*lnK[2*s] + w[3]*lnK[3*s]);
+}
+
+/*============================================================================*/
+/*----------------------------- Private Functions ----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Exact rate coefficient of a reaction; return 0 for non-tabulated types.
+ */
+Real RateTab_exact(Chemistry *Chem, int i, Real T)
+{
+  switch (Chem->Reactions[i].rtype)
+  {
+    case 1: return ChemCoeff(Chem->Reactions[i].coeff, T,
+                             Chem->Reactions[i].NumTRange);
+    case 2: return IonGrCoeff(Chem, i, T);
+    case 4: return DesorpCoeff(Chem->Reactions[i].coeff, T);
+    case 5: return GrGrCoeff(Chem, i, T);
+    default: return 0.0;
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Calculate ln(K) on the grid and check the interpolation error
+ */
+void RateTab_build(Chemistry *Chem, RateTable *Tab)
+{
+  int i, k, n, m, j, nT = Tab->nT, ncand;
+  Real T, K, Ki, err, w[4];
+  Real *lnK;
+  int *cand;
+
+  /* candidate reactions */
+  cand = (int*)calloc_1d_array(MAX(Chem->NReaction,1), sizeof(int));
+
+  ncand = 0;
+  for (i=0; i<Chem->NReaction; i++)
+  {
+    Tab->ind[i] = -1;
+    Tab->err[i] = 0.0;
+    k = Chem->Reactions[i].rtype;
+    if ((k == 1) || (k == 2) || (k == 4) || (k == 5))
+      cand[ncand++] = i;
+  }
+
+  lnK = (Real*)calloc_1d_array(MAX(nT*ncand,1), sizeof(Real));
+
+  /* tabulate; use Tab->ind as a temporary flag of validity */
+  for (n=0; n<ncand; n++)
+  {
+    i = cand[n];
+    Tab->ind[i] = n;
+
+    for (k=0; k<nT; k++)
+    {
+      T = exp(Tab->lnTmin + k*Tab->dlnT);
+      K = RateTab_exact(Chem, i, T);
+
+      if ((K > 0.0) && (K < HUGE_NUMBER))
+        lnK[k*ncand+n] = log(K);
+      else {
+        Tab->ind[i] = -1;
+        Tab->err[i] = HUGE_NUMBER;
+        break;
+      }
+    }
+  }
+
+  /* maximum relative error at the middle of each grid interval */
+  Tab->NTab = ncand;
+  Tab->lnK  = lnK;
+
+  for (k=0; k<nT-1; k++)
+  {
+    T = exp(Tab->lnTmin + (k+0.5)*Tab->dlnT);
+    RateTab_weights(Tab, T, &j, w);
+
+    for (n=0; n<ncand; n++)
+    {
+      i = cand[n];
+      if (Tab->ind[i] < 0) continue;
+
+      K  = RateTab_exact(Chem, i, T);
+      Ki = RateTab_value(Tab, n, j, w);
+      err = fabs(Ki/K-1.0);
+
+      Tab->err[i] = MAX(Tab->err[i], err);
+    }
+  }
+
+  /* compact the table to the reactions within tolerance (in place: the
+   * new position of every entry is never behind its old position) */
+  m = 0;
+  for (n=0; n<ncand; n++)
+  {
+    i = cand[n];
+    if ((Tab->ind[i] >= 0) && (Tab->err[i] <= Tab->tol))
+      Tab->ind[i] = m++;
+    else
+      Tab->ind[i] = -1;
+  }
+
+  for (k=0; k<nT; k++)
+    for (n=0; n<ncand; n++)
+      if ((j = Tab->ind[cand[n]]) >= 0)
+        lnK[k*m+j] = lnK[k*ncand+n];
+
+  Tab->NTab = m;
+
+  free_1d_array(cand);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Checksum of the reaction network as far as the tabulated rates go
+ */
+uint32_t RateTab_netsum(Chemistry *Chem)
+{
+  int i;
+  uint32_t h = FNV1A_BASIS;
+  ReactionInfo *R;
+  SpeciesInfo *S;
+
+  h = fnv1a(h, &(Chem->NReaction), sizeof(int));
+  h = fnv1a(h, &(Chem->Ntot), sizeof(int));
+
+  for (i=0; i<Chem->NReaction; i++)
+  {
+    R = &(Chem->Reactions[i]);
+    h = fnv1a(h, &(R->rtype), sizeof(int));
+    h = fnv1a(h, R->reactant, 2*sizeof(int));
+    h = fnv1a(h, &(R->NumTRange), sizeof(int));
+    h = fnv1a(h, R->coeff, R->NumTRange*sizeof(Coefficient));
+  }
+
+  for (i=0; i<Chem->Ntot; i++)
+  {
+    S = &(Chem->Species[i]);
+    h = fnv1a(h, &(S->mass), sizeof(Real));
+    h = fnv1a(h, &(S->charge), sizeof(int));
+    h = fnv1a(h, &(S->gsize), sizeof(Real));
+  }
+
+  return h;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Read the table. Return 0 on success, nonzero if the file does not exist or
+ * does not match the network and the grid parameters.
+ */
+int RateTab_read(Chemistry *Chem, RateTable *Tab, char *fname)
+{
+  FILE *fp;
+  char magic[8];
+  int version, nreac, nT, ntab, ok = 1;
+  Real head[4];
+  uint32_t netsum, datsum, sum;
+
+  if ((fp = fopen(fname,"rb")) == NULL)
+    return 1;
+
+  ok = ok && (fread(magic, sizeof(char), 8, fp) == 8);
+  ok = ok && (strncmp(magic, "RATETAB", 8) == 0);
+  ok = ok && (fread(&version, sizeof(int), 1, fp) == 1);
+  ok = ok && (version == RATETAB_VERSION);
+  ok = ok && (fread(&nreac, sizeof(int), 1, fp) == 1);
+  ok = ok && (fread(&nT,    sizeof(int), 1, fp) == 1);
+  ok = ok && (fread(&ntab,  sizeof(int), 1, fp) == 1);
+  ok = ok && (fread(head, sizeof(Real), 4, fp) == 4);
+  ok = ok && (fread(&netsum, sizeof(uint32_t), 1, fp) == 1);
+
+  ok = ok && (nreac == Chem->NReaction) && (nT == Tab->nT);
+  ok = ok && (head[0] == Tab->lnTmin) && (head[1] == Tab->lnTmax);
+  ok = ok && (head[2] == Tab->dlnT) && (head[3] == Tab->tol);
+  ok = ok && (netsum == RateTab_netsum(Chem));
+  ok = ok && (ntab >= 0) && (ntab <= nreac);
+
+  if (ok)
+  {
+    Tab->NTab = ntab;
+    Tab->lnK  = (Real*)calloc_1d_array(MAX(nT*ntab,1), sizeof(Real));
+
+    ok = ok && (fread(Tab->ind, sizeof(int),  nreac, fp) == (size_t)nreac);
+    ok = ok && (fread(Tab->err, sizeof(Real), nreac, fp) == (size_t)nreac);
+    ok = ok && (fread(Tab->lnK, sizeof(Real), nT*ntab, fp) == (size_t)(nT*ntab));
+    ok = ok && (fread(&datsum, sizeof(uint32_t), 1, fp) == 1);
+    ok = ok && (fgetc(fp) == EOF);
+
+    if (ok)
+    {
+      sum = fnv1a(FNV1A_BASIS, Tab->ind, nreac*sizeof(int));
+      sum = fnv1a(sum, Tab->err, nreac*sizeof(Real));
+      sum = fnv1a(sum, Tab->lnK, nT*ntab*sizeof(Real));
+      ok = (sum == datsum);
+    }
+
+    if (!ok)
+    {
+      free_1d_array(Tab->lnK);
+      Tab->lnK  = NULL;
+      Tab->NTab = 0;
+    }
+  }
+
+  fclose(fp);
+
+  if (ok)
+    ath_pout(0,"Rate table read from %s.\n", fname);
+  else
+    ath_pout(0,"Rate table in %s is out of date; rebuilding.\n", fname);
+
+  return !ok;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Write the table
+ */
+void RateTab_write(Chemistry *Chem, RateTable *Tab, char *fname)
+{
+  FILE *fp;
+  char magic[8] = "RATETAB";
+  int version = RATETAB_VERSION, nreac = Chem->NReaction;
+  int nT = Tab->nT, ntab = Tab->NTab;
+  Real head[4];
+  uint32_t netsum, datsum;
+
+  if ((fp = fopen(fname,"wb")) == NULL) {
+    ath_perr(-1,"[RateTab_write]: Unable to open %s!\n", fname);
+    return;
+  }
+
+  head[0] = Tab->lnTmin;  head[1] = Tab->lnTmax;
+  head[2] = Tab->dlnT;    head[3] = Tab->tol;
+
+  netsum = RateTab_netsum(Chem);
+
+  datsum = fnv1a(FNV1A_BASIS, Tab->ind, nreac*sizeof(int));
+  datsum = fnv1a(datsum, Tab->err, nreac*sizeof(Real));
+  datsum = fnv1a(datsum, Tab->lnK, nT*ntab*sizeof(Real));
+
+  fwrite(magic,    sizeof(char), 8, fp);
+  fwrite(&version, sizeof(int),  1, fp);
+  fwrite(&nreac,   sizeof(int),  1, fp);
+  fwrite(&nT,      sizeof(int),  1, fp);
+  fwrite(&ntab,    sizeof(int),  1, fp);
+  fwrite(head,     sizeof(Real), 4, fp);
+  fwrite(&netsum,  sizeof(uint32_t), 1, fp);
+  fwrite(Tab->ind, sizeof(int),  nreac,   fp);
+  fwrite(Tab->err, sizeof(Real), nreac,   fp);
+  fwrite(Tab->lnK, sizeof(Real), nT*ntab, fp);
+  fwrite(&datsum,  sizeof(uint32_t), 1, fp);
+
+  fclose(fp);
+
+  ath_pout(0,"Rate table written to %s.\n", fname);
+
+  return;
+}
+
+#undef RATETAB_VERSION
+
+#endif /* CHEMISTRY */
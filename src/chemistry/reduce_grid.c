@@ -0,0 +1,641 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: reduce_grid.c
+ *
+ * PURPOSE: Contains a driver for the reduction of the chemical network over
+ *   all the cells of a column, so that the reduced network holds for all of
+ *   them and not only at one (rho, T, zeta) point. Each cell is evolved as in
+ *   main.c, then the species are selected with species_sens() and the
+ *   reactions are weighted with reaction_ratio(). The cells are combined with
+ *
+ *     species:   union of the species selected in any cell, sensitivity max
+ *     reactions: max of the ratios over the cells; a reaction is kept if the
+ *                max exceeds problem/limit and all its species are kept
+ *
+ *   The cells are independent and are distributed over problem/nproc worker
+ *   processes (fork), each sending its results back through a pipe; the
+ *   chemistry model and Evln are global, so processes rather than threads.
+ *   The parent drains all pipes as data arrives (run_cells()), so that no
+ *   worker waits on a full pipe while another one is being read.
+ *
+ *   Enabled by problem/gridred=1 (see main.c). Writes the species to
+ *   job/savep (max sensitivity, name, number of cells selecting it), the
+ *   reactions to job/saver (same format as select_reaction) and, for each
+ *   kept species, which cells selected it to job/savecov. The reduced network
+ *   is also written as species and reaction files that can be read back
+ *   (job/redspecies, job/redreaction; see reduced_network.c).
+ *
+ *   Unless problem/validate=0, the reduced network is then loaded in place of
+ *   the full one and all cells are solved again. The CPU time of the solver
+ *   and the relative error of x_e and of eta_O, eta_H, eta_A (at the field
+ *   problem/B, in G) against the full network are written to job/saveval for
+ *   each cell, and summarized. Chem and Evln hold the reduced network after.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   reduce_grid()    - reduce the network over all cells of a column
+ *   select_network() - combine the cells into the reduced network
+ *   solve_cell()     - evolve one cell of the column as in main.c
+ *   load_network()   - replace the chemistry model by another network
+ *   compare_cells()  - relative errors of a network against the full one
+ *   run_cells()      - evaluate the cells of a column in worker processes
+ *   write_pipe()     - write a buffer to a pipe
+ *   read_pipe()      - read a buffer from a pipe
+ *
+ * REFERENCES:
+ *   D. Wiebe, et al. 2003, A&A, 399, 197-210
+==============================================================================*/
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+
+#ifdef CHEMISTRY
+
+/* Arrays of reduce_grid() filled by the cells */
+typedef struct ReduceWork_s {
+
+  Nebula *Disk;
+  ChemColumn *Col;
+  int **cover;               /* species selected in each cell */
+  Real *sens, *ratio;        /* sensitivities and ratios of the last cell */
+  Real *smax, *rmax;         /* their maxima over the cells */
+  Real **full;               /* results of solve_cell() in each cell */
+
+}ReduceWork;
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   ReduceCell()    - evolve one cell and evaluate its species and reactions
+ *   ReduceIO()      - send or receive the results of one cell
+ *   Validate()      - solve all cells with the reduced network and compare
+ *   WriteReaction() - one line of the reaction file
+ *============================================================================*/
+
+void ReduceCell(int c, void *arg);
+int  ReduceIO(int fd, int c, int out, void *arg);
+void Validate(Nebula *Disk, ChemColumn *Col, Real **full);
+void WriteReaction(FILE *fp, Chemistry *Chem, int r);
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Reduce the network over the cells of the column Col (see main.c)
+ */
+void reduce_grid(Nebula *Disk, ChemColumn *Col)
+{
+  int i, nc, nproc, nrec;
+  int **cover;
+  Real *sens, *ratio, *smax, *rmax, *abn, **full;
+  ReduceWork W;
+  Chemistry *Chem = Evln.Chem;
+  int Ntot = Chem->Ntot, NR = Chem->NReaction;
+
+  /* the reduced network is written with the labels of the full one */
+  if (par_geti_def("problem","prune",0) == 1)
+    ath_error("[reduce_grid]: Writing the reduced network requires "
+              "problem/prune=0!\n");
+
+  nc = Col->nz;
+  nproc = MIN(MAX(par_geti_def("problem","nproc",1),1), MAX(nc,1));
+
+  cover = (int**)calloc_2d_array(MAX(nc,1), Ntot, sizeof(int));
+  sens  = (Real*)calloc_1d_array(Ntot, sizeof(Real));
+  smax  = (Real*)calloc_1d_array(Ntot, sizeof(Real));
+  ratio = (Real*)calloc_1d_array(MAX(NR,1), sizeof(Real));
+  rmax  = (Real*)calloc_1d_array(MAX(NR,1), sizeof(Real));
+  full  = (Real**)calloc_2d_array(MAX(nc,1), NSTAT, sizeof(Real));
+
+  /* element abundances of the species file, before init_numberden() */
+  abn = (Real*)calloc_1d_array(Chem->N_Ele, sizeof(Real));
+  for (i=0; i<Chem->N_Ele; i++)
+    abn[i] = Chem->Elements[i].abundance;
+
+  ath_pout(0,"\nNetwork reduction over %d cells with %d process(es).\n",
+              nc, nproc);
+
+/* Evaluate the cells, in this process or in nproc workers */
+
+  W.Disk = Disk;   W.Col = Col;
+  W.cover = cover; W.full = full;
+  W.sens = sens;   W.ratio = ratio;
+  W.smax = smax;   W.rmax = rmax;
+
+  nrec = run_cells(nc, nproc, ReduceCell, ReduceIO, &W);
+
+  if (nrec != nc)
+    ath_error("[reduce_grid]: only %d of %d cells were evaluated!\n",nrec,nc);
+
+  select_network(Col, cover, smax, rmax, abn);
+
+  free_2d_array(cover);
+  free_1d_array(sens);
+  free_1d_array(smax);
+  free_1d_array(ratio);
+  free_1d_array(rmax);
+  free_1d_array(abn);
+
+  if (par_geti_def("problem","validate",1) == 1)
+    Validate(Disk, Col, full);
+
+  free_2d_array(full);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Select the reduced network from the species cover[c] selected in each cell
+ * c of the column Col, with their maximum sensitivities smax over the cells,
+ * and the maximum ratios rmax of the reactions; write it (see the top of the
+ * file) with the element abundances abn of the species file
+ */
+void select_network(ChemColumn *Col, int **cover, Real *smax, Real *rmax,
+                    Real *abn)
+{
+  int c, i, j, k, r, p, nc, nsp, nre, ndrop, nnet, *keep, *net, *rsel;
+  Real limit;
+  char *fname;
+  FILE *fp;
+  Chemistry *Chem = Evln.Chem;
+  int Ntot = Chem->Ntot, NR = Chem->NReaction;
+
+  nc = Col->nz;
+  limit = par_getd("problem","limit");
+
+  keep = (int*)calloc_1d_array(Ntot, sizeof(int));
+  net  = (int*)calloc_1d_array(Ntot, sizeof(int));
+  rsel = (int*)calloc_1d_array(MAX(NR,1), sizeof(int));
+
+/* Union of the species, completed into a loadable network, and the
+ * reactions among them */
+
+  nsp = 0;
+  for (i=0; i<Ntot; i++)
+  {
+    for (c=0; c<nc; c++)
+      keep[i] += cover[c][i];
+    if (keep[i] > 0) nsp++;
+    net[i] = (keep[i] > 0);
+  }
+  nnet = reduced_species(Chem, net);
+
+  fname = par_gets("job","savep");
+  if ((fp = fopen(fname,"w")) == NULL)
+    ath_error("[select_network]: Error open file %s\n",fname);
+  free(fname);
+  for (i=0; i<Ntot; i++)
+    if (keep[i] > 0)
+      fprintf(fp,"%e %7s %d\n",smax[i],Chem->Species[i].name,keep[i]);
+  fclose(fp);
+
+  nre = ndrop = 0;
+  fname = par_gets("job","saver");
+  if ((fp = fopen(fname,"w")) == NULL)
+    ath_error("[select_network]: Error open file %s\n",fname);
+  free(fname);
+  for (r=0; r<NR; r++)
+  {
+    if ((Chem->Reactions[r].use != 1) || !(rmax[r] > limit)) continue;
+
+    k = 1;
+    for (j=0; j<2; j++) {
+      p = Chem->Reactions[r].reactant[j];
+      if ((p >= 0) && (net[p] == 0)) k = 0;
+    }
+    for (j=0; j<4; j++) {
+      p = Chem->Reactions[r].product[j];
+      if ((p >= 0) && (net[p] == 0)) k = 0;
+    }
+
+    if (k) {
+      WriteReaction(fp, Chem, r);
+      rsel[r] = 1;
+      nre++;
+    }
+    else
+      ndrop++;
+  }
+  fclose(fp);
+
+/* Coverage: which cells selected each kept species */
+
+  fname = par_gets_def("job","savecov","coverage.txt");
+  if ((fp = fopen(fname,"w")) == NULL)
+    ath_error("[select_network]: Error open file %s\n",fname);
+  free(fname);
+  fprintf(fp,"# species selected in each cell (1) or not (0)\n");
+  fprintf(fp,"# %7s %5s","z:","");
+  for (c=0; c<nc; c++)
+    fprintf(fp," %g",Col->z[c]);
+  fprintf(fp,"\n");
+  for (i=0; i<Ntot; i++)
+  {
+    if (keep[i] == 0) continue;
+    fprintf(fp,"%9s %5d",Chem->Species[i].name,keep[i]);
+    for (c=0; c<nc; c++)
+      fprintf(fp," %d",cover[c][i]);
+    fprintf(fp,"\n");
+  }
+  fclose(fp);
+
+  ath_pout(0,"Reduced network over %d cells: %d of %d species selected (%d "
+             "in the network), %d of %d reactions (%d more above the limit "
+             "involve dropped species).\n", nc, nsp, Ntot, nnet, nre, NR, ndrop);
+
+  write_reduced(Chem, net, rsel, abn);
+
+  free_1d_array(keep);
+  free_1d_array(net);
+  free_1d_array(rsel);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Evolve cell c of the column as in main.c; stat[NSTAT] gets the CPU time of
+ * the solver, x_e and the magnetic diffusivities at the end
+ */
+void solve_cell(Nebula *Disk, ChemColumn *Col, int c, Real *stat)
+{
+  int k, photocol;
+  Real r, rho, Tg, tend, dttry, atol;
+  clock_t c0;
+
+  r        = par_getd("problem","r");
+  tend     = par_getd("problem","te")*OneYear;
+  dttry    = par_getd("problem","dt0") * OneYear;
+  atol     = par_getd("problem","atol");
+  photocol = par_geti_def("problem","photocol",0);
+  k        = (int)par_getd("problem","zstart") + c;
+
+  ath_pout(0,"\nCell=%d (z=%g)\n",c+1,Col->z[c]);
+  Tg = Temp_disk(Disk,r);
+  rho = Rho_disk(Disk,r,Col->z[c]);
+  init_numberden(&Evln, rho, k);
+  if (photocol)
+    IonizationCoeff_column(&Evln, Col, c, Col->zeta[c], k);
+  else
+    IonizationCoeff(&Evln, Col->zeta[c], 0.0, k);
+  CalCoeff(&Evln, Tg, k);
+  Evln.t = 0.0;
+  c0 = clock();
+  evolve(tend, dttry, atol);
+  stat[0] = (Real)(clock()-c0)/CLOCKS_PER_SEC;
+
+  Evln.B = par_getd_def("problem","B",1.0);
+  Cal_NIMHD(&Evln);
+
+  stat[1] = Evln.NumDen[0]*Evln.Abn_Den;
+  stat[2] = Evln.eta_O;
+  stat[3] = Evln.eta_H;
+  stat[4] = Evln.eta_A;
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Replace the chemistry model (Chem, Evln) by the network of the species file
+ * sp and the reaction file re, with the network cache file cache (unchanged
+ * if NULL); the photo-reactions of the column Col are labelled again
+ */
+void load_network(Nebula *Disk, ChemColumn *Col, char *sp, char *re,
+                  char *cache)
+{
+  int c, nc = Col->nz;
+  Real r, G0, *z;
+
+  r  = par_getd("problem","r");
+  G0 = Col->G0;
+  z  = (Real*)calloc_1d_array(MAX(nc,1), sizeof(Real));
+  for (c=0; c<nc; c++)
+    z[c] = Col->z[c];
+
+  final_chemevln(&Evln);
+  final_chemistry(&Chem);
+
+  par_sets("job","read_species",sp,"network in use");
+  par_sets("job","read_reaction",re,"network in use");
+  if (cache != NULL)
+    par_sets("job","netcache",cache,"network in use");
+
+  init_chemistry(&Chem);
+  init_chemevln(&Chem, &Evln);
+
+  final_column(Col);
+  init_column(&Chem, Col, Disk, r, nc, z, G0);
+
+  free_1d_array(z);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Compare the results red[c][NSTAT] of solve_cell() in the cells of the
+ * column Col with those of the full network full[c][NSTAT]: returns the
+ * total CPU times of the solver tsum[0] (full) and tsum[1] (red), and the
+ * max relative errors emax[1..NSTAT-1] over the cells. With fp != NULL, each
+ * cell is written as z, the two CPU times, the speedup, extra[c][0..nx-1]
+ * and the relative errors.
+ */
+void compare_cells(FILE *fp, ChemColumn *Col, Real **full, Real **red,
+                   Real **extra, int nx, Real *tsum, Real *emax)
+{
+  int c, m;
+  Real err;
+
+  tsum[0] = tsum[1] = 0.0;
+  for (m=1; m<NSTAT; m++) emax[m] = 0.0;
+
+  for (c=0; c<Col->nz; c++)
+  {
+    tsum[0] += full[c][0];
+    tsum[1] += red[c][0];
+    if (fp != NULL) {
+      fprintf(fp,"%12e %12e %12e %12e", Col->z[c], full[c][0], red[c][0],
+                 full[c][0]/MAX(red[c][0],TINY_NUMBER));
+      for (m=0; m<nx; m++)
+        fprintf(fp," %12g", extra[c][m]);
+    }
+    for (m=1; m<NSTAT; m++)
+    {
+      err = fabs(red[c][m]-full[c][m])/MAX(fabs(full[c][m]),TINY_NUMBER);
+      emax[m] = MAX(emax[m], err);
+      if (fp != NULL) fprintf(fp," %12e", err);
+    }
+    if (fp != NULL) fprintf(fp,"\n");
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Write n bytes to fd
+ */
+void write_pipe(int fd, void *buf, size_t n)
+{
+  ssize_t m;
+  char *p = (char*)buf;
+
+  while (n > 0)
+  {
+    m = write(fd, p, n);
+    if (m <= 0)
+      ath_error("[reduce_grid]: write to the pipe failed!\n");
+    p += m;
+    n -= m;
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Read n bytes from fd; return 0 at the end of the data
+ */
+int read_pipe(int fd, void *buf, size_t n)
+{
+  ssize_t m;
+  char *p = (char*)buf;
+
+  while (n > 0)
+  {
+    m = read(fd, p, n);
+    if (m <= 0) return 0;
+    p += m;
+    n -= m;
+  }
+
+  return 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Evaluate the cells 0..nc-1 with eval(c, arg), in this process if nproc is 1
+ * or else in nproc worker processes taking the cells w, w+nproc, ... Each
+ * worker sends c and then io(fd, c, 1, arg) after each cell; the parent reads
+ * every pipe as soon as it has data with io(fd, c, 0, arg), which returns 0
+ * if the data ended. Return the number of cells evaluated.
+ */
+int run_cells(int nc, int nproc, void (*eval)(int c, void *arg),
+              int (*io)(int fd, int c, int out, void *arg), void *arg)
+{
+  int c, j, w, nrec, nopen, fds[2];
+  pid_t *pid;
+  struct pollfd *pfd;
+
+  if (nproc <= 1)
+  {
+    for (c=0; c<nc; c++)
+      eval(c, arg);
+    return nc;
+  }
+
+  pfd = (struct pollfd*)calloc_1d_array(nproc, sizeof(struct pollfd));
+  pid = (pid_t*)calloc_1d_array(nproc, sizeof(pid_t));
+
+  fflush(stdout);
+  for (w=0; w<nproc; w++)
+  {
+    if (pipe(fds) != 0)
+      ath_error("[run_cells]: pipe() failed!\n");
+
+    pid[w] = fork();
+    if (pid[w] < 0)
+      ath_error("[run_cells]: fork() failed!\n");
+
+    if (pid[w] == 0)
+    {/* worker: cells w, w+nproc, ... */
+      close(fds[0]);
+      for (j=0; j<w; j++) close(pfd[j].fd);
+      for (c=w; c<nc; c+=nproc)
+      {
+        eval(c, arg);
+        write_pipe(fds[1], &c, sizeof(int));
+        io(fds[1], c, 1, arg);
+      }
+      close(fds[1]);
+      fflush(stdout);
+      _exit(0);
+    }
+
+    close(fds[1]);
+    pfd[w].fd = fds[0];
+    pfd[w].events = POLLIN;
+  }
+
+  /* read each pipe when it has data; a worker whose data ended is closed */
+  nrec = 0;
+  nopen = nproc;
+  while (nopen > 0)
+  {
+    if (poll(pfd, nproc, -1) < 0) {
+      if (errno == EINTR) continue;
+      ath_error("[run_cells]: poll() failed!\n");
+    }
+
+    for (w=0; w<nproc; w++)
+    {
+      if ((pfd[w].fd < 0) || (pfd[w].revents == 0)) continue;
+
+      if (read_pipe(pfd[w].fd, &c, sizeof(int)) && (c >= 0) && (c < nc)
+                                                 && io(pfd[w].fd, c, 0, arg))
+        nrec++;
+      else {
+        close(pfd[w].fd);
+        pfd[w].fd = -1;
+        waitpid(pid[w], NULL, 0);
+        nopen--;
+      }
+    }
+  }
+
+  free_1d_array(pfd);
+  free_1d_array(pid);
+
+  return nrec;
+}
+
+/*============================================================================*/
+/*----------------------------- Private Functions ----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Evolve cell c of the column, then select its species (cover[c], sens) and
+ * weigh its reactions (ratio); arg is the ReduceWork of reduce_grid()
+ */
+void ReduceCell(int c, void *arg)
+{
+  int i;
+  ReduceWork *W = (ReduceWork*)arg;
+
+  solve_cell(W->Disk, W->Col, c, W->full[c]);
+
+  species_sens(&Evln, W->cover[c], W->sens);
+  reaction_ratio(&Evln, W->ratio);
+
+  for (i=0; i<Evln.Chem->Ntot; i++)
+    W->smax[i] = MAX(W->smax[i], W->sens[i]);
+  for (i=0; i<Evln.Chem->NReaction; i++)
+    W->rmax[i] = MAX(W->rmax[i], W->ratio[i]);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Write (out=1) or read (out=0) the results of cell c to/from the pipe fd;
+ * return 0 if the data ended
+ */
+int ReduceIO(int fd, int c, int out, void *arg)
+{
+  int i, Ntot = Evln.Chem->Ntot, NR = Evln.Chem->NReaction;
+  ReduceWork *W = (ReduceWork*)arg;
+
+  if (out) {
+    write_pipe(fd, W->cover[c], Ntot*sizeof(int));
+    write_pipe(fd, W->sens,     Ntot*sizeof(Real));
+    write_pipe(fd, W->ratio,    NR*sizeof(Real));
+    write_pipe(fd, W->full[c],  NSTAT*sizeof(Real));
+    return 1;
+  }
+
+  if (!read_pipe(fd, W->cover[c], Ntot*sizeof(int)) ||
+      !read_pipe(fd, W->sens,     Ntot*sizeof(Real)) ||
+      !read_pipe(fd, W->ratio,    NR*sizeof(Real))   ||
+      !read_pipe(fd, W->full[c],  NSTAT*sizeof(Real)))
+    return 0;
+
+  for (i=0; i<Ntot; i++) W->smax[i] = MAX(W->smax[i], W->sens[i]);
+  for (i=0; i<NR; i++)   W->rmax[i] = MAX(W->rmax[i], W->ratio[i]);
+
+  return 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Load the reduced network written by reduce_grid() in place of the full one,
+ * solve all cells again and compare with the results full[c][NSTAT] of the
+ * full network
+ */
+void Validate(Nebula *Disk, ChemColumn *Col, Real **full)
+{
+  int c, nc = Col->nz, Nfull = Chem.Ntot, NRfull = Chem.NReaction;
+  Real tsum[2], emax[NSTAT], **red;
+  char *fname, *sp, *re, *cache, name[256];
+  FILE *fp;
+
+  /* the reduced network replaces the full one, keeping the cache of the
+   * full network */
+  sp = par_gets_def("job","redspecies","sp_red.txt");
+  re = par_gets_def("job","redreaction","re_red.txt");
+  cache = NULL;
+  if (par_exist("job","netcache")) {
+    fname = par_gets("job","netcache");
+    snprintf(name, sizeof(name), "%s.red", fname);
+    cache = name;
+    free(fname);
+  }
+
+  ath_pout(0,"\nValidation of the reduced network:\n");
+  load_network(Disk, Col, sp, re, cache);
+  free(sp);
+  free(re);
+
+  red = (Real**)calloc_2d_array(nc, NSTAT, sizeof(Real));
+  for (c=0; c<nc; c++)
+    solve_cell(Disk, Col, c, red[c]);
+
+/* Speedup and relative errors */
+
+  fname = par_gets_def("job","saveval","validation.txt");
+  if ((fp = fopen(fname,"w")) == NULL)
+    ath_error("[reduce_grid]: Error open file %s\n",fname);
+  free(fname);
+
+  fprintf(fp,"# %d of %d species, %d of %d reactions; B = %g G\n",
+             Chem.Ntot, Nfull, Chem.NReaction, NRfull, Evln.B);
+  fprintf(fp,"# %10s %12s %12s %12s %12s %12s %12s %12s\n", "z", "t_full(s)",
+             "t_red(s)", "speedup", "err(x_e)", "err(eta_O)", "err(eta_H)",
+             "err(eta_A)");
+  compare_cells(fp, Col, full, red, NULL, 0, tsum, emax);
+  fclose(fp);
+
+  ath_pout(0,"Reduced network (%d of %d species, %d of %d reactions) over "
+             "%d cells: solver time %.3f s vs %.3f s (speedup %.2f), max "
+             "relative error x_e %.3e, eta_O %.3e, eta_H %.3e, eta_A %.3e.\n",
+              Chem.Ntot, Nfull, Chem.NReaction, NRfull, nc, tsum[1], tsum[0],
+              tsum[0]/MAX(tsum[1],TINY_NUMBER),
+              emax[1], emax[2], emax[3], emax[4]);
+
+  free_2d_array(red);
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Reactants and products of reaction r, "0" for an empty slot
+ */
+void WriteReaction(FILE *fp, Chemistry *Chem, int r)
+{
+  int j, p;
+
+  for (j=0; j<2; j++) {
+    p = Chem->Reactions[r].reactant[j];
+    fprintf(fp,"%7s ", (p >= 0) ? Chem->Species[p].name : "0");
+  }
+  for (j=0; j<4; j++) {
+    p = Chem->Reactions[r].product[j];
+    fprintf(fp,"%7s ", (p >= 0) ? Chem->Species[p].name : "0");
+  }
+  fprintf(fp,"\n");
+
+  return;
+}
+
+#endif /* CHEMISTRY */
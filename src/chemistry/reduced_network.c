@@ -0,0 +1,345 @@
+#include "../header/copyright.h"
+/*=============================================================================
+ * FILE: reduced_network.c
+ *
+ * PURPOSE: Contains functions to write a reduced chemical network as species
+ *   and reaction files in the format read by init_species() and
+ *   init_reactions(), so that it can be loaded in place of the full network
+ *   (job/read_species, job/read_reaction).
+ *
+ *   The species file only lists the neutrals and the special ions, from which
+ *   init_species() constructs the ionized counterparts, the mantle species
+ *   and the grain charge ladders. A set of species selected by the reduction
+ *   is therefore completed first (reduced_species()):
+ *
+ *     - the species of the initial condition (see initial_species()) and the
+ *       neutral of every mantle species kept are added, and every neutral
+ *       kept brings all its mantle species;
+ *     - the grain charges are kept up to the largest |Z| selected (at least
+ *       1), in all grain types.
+ *
+ *   Each neutral is then listed with the ionized counterparts that are kept:
+ *   with +/- counterparts, with a + counterpart, or without counterpart. An
+ *   ion whose neutral is dropped is listed as a special ion. The elements and
+ *   grain properties are those of the full network.
+ *
+ *   The reaction file holds the ionization and gas-phase reactions selected,
+ *   and the grain-surface reactions of which any of the (2 per grain type)
+ *   reactions constructed is selected; the other grain reactions are
+ *   constructed again by init_reactions() from the species. The sub-type of
+ *   the gas-phase reactions is not kept by the model, so the reactions are
+ *   written as GP, except the photo-reactions (PH). Numbers are written with
+ *   the fewest digits that give back the same value, so the reduced network
+ *   has exactly the rate coefficients of the full one.
+ *
+ * CONTAINS PUBLIC FUNCTIONS:
+ *   reduced_species() - complete a set of species into a loadable network
+ *   write_reduced()   - write the species and reaction files of the network
+ *
+ * REFERENCES:
+ *   Bai, X.-N. & Goodman, J., 2009, ApJ, 701, 737
+==============================================================================*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../header/defs.h"
+#include "../header/chemistry.h"
+#include "../header/chemproto.h"
+#include "../header/prototypes.h"
+
+#ifdef CHEMISTRY
+
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   Category() - how a species is listed in the reduced species file
+ *   RealStr()  - shortest representation of a real number
+ *   SpName()   - name of a reactant or product, "0" for an empty slot
+ *============================================================================*/
+
+int  Category(Chemistry *Chem, int *net, int i);
+char *RealStr(Real x, char *buf);
+char *SpName(Chemistry *Chem, int p);
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Complete the species selected (net[i]=1) into a network that init_species()
+ * can construct: net is updated in place, and the number of species of the
+ * reduced network is returned
+ */
+int reduced_species(Chemistry *Chem, int *net)
+{
+  int i, k, n, G, *pop;
+  int Nf = Chem->N_Neu_f, Nn = Chem->N_Neu, Ns = Chem->N_Neu_s;
+  int NG = Chem->NGrain;
+
+  /* the species labels follow the layout of init_species() */
+  if (par_geti_def("problem","prune",0) == 1)
+    ath_error("[reduced_species]: Writing the reduced network requires "
+              "problem/prune=0!\n");
+
+  pop = (int*)calloc_1d_array(Chem->Ntot, sizeof(int));
+  initial_species(Chem, pop);
+  for (i=0; i<Chem->Ntot; i++)
+    net[i] = (net[i] || pop[i]) ? 1 : 0;
+  free_1d_array(pop);
+
+  /* a mantle species needs its neutral, which brings all its mantles */
+  for (i=1; i<=Nf; i++) {
+    for (k=0; k<NG; k++)
+      if (net[i+(k+3)*Nf]) net[i] = 1;
+    for (k=0; k<NG; k++)
+      net[i+(k+3)*Nf] = net[i];
+  }
+  for (i=Chem->NeuInd; i<Chem->NeuInd+Nn; i++) {
+    for (k=0; k<NG; k++)
+      if (net[i+(k+2)*Nn]) net[i] = 1;
+    for (k=0; k<NG; k++)
+      net[i+(k+2)*Nn] = net[i];
+  }
+  for (i=Chem->SNeuInd; i<Chem->SNeuInd+Ns; i++) {
+    for (k=0; k<NG; k++)
+      if (net[i+(k+1)*Ns]) net[i] = 1;
+    for (k=0; k<NG; k++)
+      net[i+(k+1)*Ns] = net[i];
+  }
+
+  /* grain charge ladders up to the largest charge selected */
+  G = 1;
+  for (i=Chem->GrInd; i<Chem->Ntot; i++)
+    if (net[i]) G = MAX(G, abs(Chem->Species[i].charge));
+  for (i=Chem->GrInd; i<Chem->Ntot; i++)
+    net[i] = (abs(Chem->Species[i].charge) <= G) ? 1 : 0;
+
+  net[0] = 1;
+
+  n = 0;
+  for (i=0; i<Chem->Ntot; i++)
+    n += net[i];
+
+  return n;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Write the network of the species net[] (completed by reduced_species())
+ * and of the reactions rsel[] to job/redspecies and job/redreaction. abn are
+ * the element abundances of the full species file (init_numberden() may
+ * have changed those of Chem).
+ */
+void write_reduced(Chemistry *Chem, int *net, int *rsel, Real *abn)
+{
+  int i, j, c, r, s, t, G, nc[4], nion, ngas, nsurf, ns6, sel;
+  char *fname, b1[32], b2[32], b3[32], b4[32], b5[32];
+  FILE *fp;
+  ReactionInfo *R;
+  static char *title[4] = {"Neutral Species (with +/- counterpart)",
+                           "Neutral Species (with ion counterpart)",
+                           "Neutral Species (without ion counterpart)",
+                           "Ion Species (without neutral counterpart)"};
+
+/* Species */
+
+  G = Chem->GrLump ? Chem->GrZmax : 1;
+  for (i=Chem->GrInd; i<Chem->Ntot; i++)
+    if (net[i]) G = MAX(G, abs(Chem->Species[i].charge));
+
+  for (c=0; c<4; c++) nc[c] = 0;
+  for (i=1; i<Chem->GrInd; i++)
+    if ((c = Category(Chem, net, i)) >= 0) nc[c]++;
+
+  fname = par_gets_def("job","redspecies","sp_red.txt");
+  if ((fp = fopen(fname,"w")) == NULL)
+    ath_error("[write_reduced]: Error open file %s\n",fname);
+
+  fprintf(fp,"# Number of Elements\n    %d\n", Chem->N_Ele);
+  fprintf(fp,"# Number of Grain Types\n    %d\n", Chem->NGrain);
+  fprintf(fp,"# Maximum Grain Charge\n    %d\n", G);
+  fprintf(fp,"# Element       Mass (m_p)      Abundance (H=1)\n");
+  for (i=0; i<Chem->N_Ele; i++)
+    fprintf(fp,"    %-11s %-15s %s\n", Chem->Elements[i].name,
+               RealStr(Chem->Elements[i].mass,b1), RealStr(abn[i],b2));
+  fprintf(fp,"# Grain mass density (g/cm^3)\n    %s\n", RealStr(Chem->GrDen,b1));
+  fprintf(fp,"# Gr-Size       MassRatio\n");
+  for (i=0; i<Chem->NGrain; i++)
+    fprintf(fp,"    %-11s %s\n", RealStr(Chem->GrSize[i],b1),
+                                 RealStr(Chem->GrFrac[i],b2));
+  for (c=0; c<4; c++)
+    fprintf(fp,"# Number of %s\n    %d\n", title[c], nc[c]);
+
+  fprintf(fp,"# Species       E_B (K)\n");
+  for (c=0; c<4; c++)
+    for (i=1; i<Chem->GrInd; i++)
+    {
+      if (Category(Chem, net, i) != c) continue;
+      if (c < 3)
+        fprintf(fp,"    %-11s %s\n", Chem->Species[i].name,
+                                     RealStr(Chem->Species[i].Eb,b1));
+      else
+        fprintf(fp,"    %s\n", Chem->Species[i].name);
+    }
+  fclose(fp);
+  free(fname);
+
+/* Ionization and gas-phase reactions; the grain reactions are constructed
+ * from the species */
+
+  nion = ngas = nsurf = 0;
+  for (r=0; r<Chem->NReaction; r++)
+  {
+    if (!rsel[r]) continue;
+    if (Chem->Reactions[r].rtype == 0) nion++;
+    if ((Chem->Reactions[r].rtype == 1) || (Chem->Reactions[r].rtype == 10))
+      ngas += Chem->Reactions[r].NumTRange;
+  }
+
+  /* each grain-surface reaction of the file gives ns6 consecutive ones */
+  ns6 = 2*Chem->NGrain;
+  for (r=0; r<Chem->NReaction; r++)
+    if (Chem->Reactions[r].rtype == 6)
+    {
+      sel = 0;
+      for (s=r; s<r+ns6; s++) sel = sel || rsel[s];
+      nsurf += sel;
+      r += ns6-1;
+    }
+
+  fname = par_gets_def("job","redreaction","re_red.txt");
+  if ((fp = fopen(fname,"w")) == NULL)
+    ath_error("[write_reduced]: Error open file %s\n",fname);
+
+  fprintf(fp,"# Reduced network\n");
+  fprintf(fp,"# Number of Ionization Reactions\n  %d\n", nion);
+  fprintf(fp,"# List of Ionization Reactions\n");
+  fprintf(fp,"# R1      R2      P1      P2      P3      P4      ratio\n");
+  for (r=0; r<Chem->NReaction; r++)
+  {
+    R = &(Chem->Reactions[r]);
+    if (!rsel[r] || (R->rtype != 0)) continue;
+    fprintf(fp,"  ");
+    for (j=0; j<2; j++) fprintf(fp,"%-7s ", SpName(Chem, R->reactant[j]));
+    for (j=0; j<4; j++) fprintf(fp,"%-7s ", SpName(Chem, R->product[j]));
+    fprintf(fp,"%s\n", RealStr(R->coeff[0].gamma,b1));
+  }
+
+  fprintf(fp,"# Number of Gas-phase Reactions\n  %d\n", ngas);
+  fprintf(fp,"# List of Gas-phase Reactions\n");
+  fprintf(fp,"# Type R1      R2      P1      P2      P3      P4      "
+             "alpha beta gamma Tmin Tmax\n");
+  for (r=0; r<Chem->NReaction; r++)
+  {
+    R = &(Chem->Reactions[r]);
+    if (!rsel[r] || ((R->rtype != 1) && (R->rtype != 10))) continue;
+
+    /* one line per temperature range, merged again when read */
+    for (t=0; t<R->NumTRange; t++)
+    {
+      fprintf(fp,"  %-4s ", (R->rtype == 10) ? "PH" : "GP");
+      for (j=0; j<2; j++) fprintf(fp,"%-7s ", SpName(Chem, R->reactant[j]));
+      for (j=0; j<4; j++) fprintf(fp,"%-7s ", SpName(Chem, R->product[j]));
+      fprintf(fp,"%s %s %s %s %s\n", RealStr(R->coeff[t].alpha,b1),
+                 RealStr(R->coeff[t].beta,b2), RealStr(R->coeff[t].gamma,b3),
+                 RealStr(R->coeff[t].Tmin,b4), RealStr(R->coeff[t].Tmax,b5));
+    }
+  }
+
+  if (Chem->NGrain > 0)
+  {
+    fprintf(fp,"# Number of grain-surface reactions\n  %d\n", nsurf);
+    fprintf(fp,"# List of grain-surface reactions\n");
+    fprintf(fp,"# R1      R2      P1      P2      Ea\n");
+    for (r=0; r<Chem->NReaction; r++)
+    {
+      if (Chem->Reactions[r].rtype != 6) continue;
+
+      sel = 0;
+      for (s=r; s<r+ns6; s++) sel = sel || rsel[s];
+
+      /* the second one has the mantle reactants and the gas-phase products */
+      R = &(Chem->Reactions[r+1]);
+      if (sel)
+      {
+        fprintf(fp,"  ");
+        for (j=0; j<2; j++)
+          fprintf(fp,"%-7.*s ", (int)strcspn(SpName(Chem, R->reactant[j]),"["),
+                                SpName(Chem, R->reactant[j]));
+        for (j=0; j<2; j++) fprintf(fp,"%-7s ", SpName(Chem, R->product[j]));
+        fprintf(fp,"%s\n", RealStr(R->coeff[0].alpha,b1));
+      }
+      r += ns6-1;
+    }
+  }
+  fclose(fp);
+
+  ath_pout(0,"Reduced network written: %d+%d+%d+%d species (grain charge "
+             "%d), %d ionization, %d gas-phase and %d grain-surface reaction "
+             "lines.\n", nc[0], nc[1], nc[2], nc[3], G, nion, ngas, nsurf);
+  free(fname);
+
+  return;
+}
+
+/*============================================================================*/
+/*----------------------------- Private Functions ----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Category of species i (0<i<GrInd) in the reduced species file: 0..3 for the
+ * four lists of init_species(), -1 if it is not listed (dropped, mantle, or
+ * constructed from its neutral)
+ */
+int Category(Chemistry *Chem, int *net, int i)
+{
+  int Nf = Chem->N_Neu_f, Nn = Chem->N_Neu, Ns = Chem->N_Neu_s;
+
+  if (!net[i]) return -1;
+
+  if (i <= Nf)                                    /* neutral with +/- */
+    return net[i+Nf] ? (net[i+2*Nf] ? 0 : 1) : 2;
+  if (i <= 2*Nf)                                  /* its + ion */
+    return net[i-Nf] ? -1 : 3;
+  if (i <= 3*Nf)                                  /* its - ion */
+    return (net[i-2*Nf] && net[i-Nf]) ? -1 : 3;
+  if (i < Chem->NeuInd)                           /* mantles */
+    return -1;
+
+  if (i < Chem->NeuInd+Nn)                        /* neutral with + */
+    return net[i+Nn] ? 1 : 2;
+  if (i < Chem->NeuInd+2*Nn)                      /* its + ion */
+    return net[i-Nn] ? -1 : 3;
+  if (i < Chem->SNeuInd)
+    return -1;
+
+  if (i < Chem->SNeuInd+Ns)                       /* neutral without ion */
+    return 2;
+  if (i < Chem->SIonInd)
+    return -1;
+
+  return 3;                                       /* special ion */
+}
+
+/*----------------------------------------------------------------------------*/
+/* Write x to buf with the fewest significant digits that read back as x
+ */
+char *RealStr(Real x, char *buf)
+{
+  int p;
+
+  for (p=6; p<=17; p++) {
+    sprintf(buf,"%.*g",p,x);
+    if (strtod(buf,NULL) == x) break;
+  }
+
+  return buf;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Name of species p, "0" if p<0
+ */
+char *SpName(Chemistry *Chem, int p)
+{
+  return (p >= 0) ? Chem->Species[p].name : "0";
+}
+
+#endif /* CHEMISTRY */
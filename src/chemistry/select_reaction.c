@@ -4,6 +4,8 @@
  * PURPOSE: Contains functions to reduce the full chemical network
  * CONTAINS PUBLIC FUNCTIONS:
  *  select_reaction.c - reduct chemical network
+ *  reaction_ratio()  - importance of each reaction in one cell (see also
+ *                      reduce_grid.c)
  * REFERENCES:
  *   D. Wiebe, et al. 2003, A&A, 399, 197-210
  * History:
@@ -31,158 +33,114 @@
 
 void select_reaction(ChemEvln *Evln)
 {
-  int i,j,k,l,m,p,num,ind;
-  Real rate,*des,*form;
+  int i,j,k,p,ind;
+  Real rate,*des,*form,*flux;
   EquationTerm *EqTerm;
   Chemistry *Chem = Evln->Chem;
   int Ntot = Chem->Ntot;
   FILE *fp;
-  char fname[20];
+  char *fname;
 
   Real limit = par_getd("problem","limit");
   printf("limit: %e\n ",limit);
   des   = (Real*)calloc_1d_array((Ntot),sizeof(Real));
   form  = (Real*)calloc_1d_array((Ntot),sizeof(Real));
-  for(i=0;i<Ntot;i++){
-    des[i] = form[i] = 0.;
-  }
+  flux  = (Real*)calloc_1d_array(MAX(Chem->NReaction,1),sizeof(Real));
 
-  /* calculate the G[i] and L[i]  for all species in the network */
+  /* rates of all reactions in one pass (flux_analysis.c), then G[i] and L[i]
+   * for all species in the network */
+  reaction_flux(Evln, flux);
   for(i=0;i<Ntot;i++){
+    des[i] = form[i] = 0.;
     for (k=0;k<Chem->Equations[i].NTerm;k++)
     {
       EqTerm = &(Chem->Equations[i].EqTerm[k]);
-      /* destruction channel */
-      if(EqTerm->dir<0){
-        rate = Evln->K[EqTerm->ind];
-        for (l=0;l<EqTerm->N;l++)
-        {
-          p = EqTerm->lab[l];
-          rate *= Evln->NumDen[p];
-        }
-        des [i] += rate;
-      }
-      /* formation channel */
-      if(EqTerm->dir>0){
-        rate = Evln->K[EqTerm->ind];
-        for (l=0;l<EqTerm->N;l++)
-        {
-          p = EqTerm->lab[l];
-          rate *= Evln->NumDen[p];
-        }
-        form[i] += rate;
-      }
+      if(EqTerm->dir>0) form[i] += flux[EqTerm->ind];
+      else              des[i]  += flux[EqTerm->ind];
     }/* end iter over reactions for same species*/
   }/* iteration over species */
 
-  sprintf(fname,"%s",par_gets("job","saver"));
-  fp = fopen(fname,"w");
+  fname = par_gets("job","saver");
+  if ((fp = fopen(fname,"w")) == NULL)
+    ath_error("[select_reaction]: Error open file %s\n",fname);
+  free(fname);
   for (i=0;i<Ntot;i++)
-  {	
-    //printf("%d th species: %7s\n ",i,Chem->Species[i].name);
+  {
     for (k=0;k<Chem->Equations[i].NTerm;k++)
     {
       EqTerm = &(Chem->Equations[i].EqTerm[k]);
-      /* absolute value for all the reactions */
-      rate = Evln->K[EqTerm->ind];
-      for (l=0;l<EqTerm->N;l++)
-      {
-        p = EqTerm->lab[l];
-        rate *= Evln->NumDen[p];
-      }
-      /* ith species is a product
-       * formation reaction */
-      if(EqTerm->dir>0)
-      {
-        /* print reactions if the reaction 
-         * rate is larger than threshold*/
-        printf("rate: %e form: %e limit:%e\n ",rate,form[i],limit);
-        if(rate/form[i]>limit){
-          printf("ratio:%e limit:%e\n",rate/form[i],limit);
-          ind   = EqTerm->ind;
-          /* first reactant */
-          p = Chem->Reactions[ind].reactant[0];
-          fprintf(fp,"%7s ",Chem->Species[p].name);
-          /* second reactant */
-          p = Chem->Reactions[ind].reactant[1];
-          if(p>=0)
-            fprintf(fp,"%7s ",Chem->Species[p].name);
-          else
-            fprintf(fp,"%7s ", "0");
-          /* first product */
-          p = Chem->Reactions[ind].product[0];
-          fprintf(fp,"%7s ",Chem->Species[p].name);
-          /* second product */
-          p = Chem->Reactions[ind].product[1];
-          if(p>=0)
-            fprintf(fp,"%7s ", Chem->Species[p].name);
-          else
-            fprintf(fp,"%7s ","0");
-          /* third product */
-          p = Chem->Reactions[ind].product[2];
-          if(p>=0)
-            fprintf(fp,"%7s ", Chem->Species[p].name);
-          else
-            fprintf(fp,"%7s ","0");
-          /* fourth product */
-          p = Chem->Reactions[ind].product[3];
-          if(p>=0)
-            fprintf(fp,"%7s ",Chem->Species[p].name);
-          else
-            fprintf(fp,"%7s","0");
-          fprintf(fp,"\n");
-        } /* end print reactions */
-      }else{ 
-      /* ith species is a reactant/destruction reaction
-       * print reactions if the reaction 
-       * rate is larger than threshold */
-      printf("rate: %e des: %e limit:%e\n ",rate,des[i],limit);
-      if(rate/des[i]>limit){
-        printf("ratio:%e limit:%e\n",rate/des[i],limit);
-        ind   = EqTerm->ind;
-        /* first reactant */
-        p = Chem->Reactions[ind].reactant[0];
-        fprintf(fp,"%7s ",Chem->Species[p].name);
-        /* second reactant */
-        p = Chem->Reactions[ind].reactant[1];
-        if(p>=0)
-          fprintf(fp,"%7s ",Chem->Species[p].name);
-        else
-          fprintf(fp,"%7s ", "0");
-        /* first product */
-        p = Chem->Reactions[ind].product[0];
-        fprintf(fp,"%7s ",Chem->Species[p].name);
-        /* second product */
-        p = Chem->Reactions[ind].product[1];
-        if(p>=0)
-          fprintf(fp,"%7s ", Chem->Species[p].name);
-        else
-          fprintf(fp,"%7s ","0");
-        /* third product */
-        p = Chem->Reactions[ind].product[2];
-        if(p>=0)
-          fprintf(fp,"%7s ", Chem->Species[p].name);
-        else
-          fprintf(fp,"%7s ","0");
-        /* fourth product */
-        p = Chem->Reactions[ind].product[3];
-        if(p>=0)
-          fprintf(fp,"%7s ",Chem->Species[p].name);
-        else
-          fprintf(fp,"%7s","0");
+      ind  = EqTerm->ind;
+      rate = flux[ind];
+      /* print formation/destruction reactions if the reaction rate is
+       * larger than threshold */
+      if(rate/((EqTerm->dir>0) ? form[i] : des[i]) > limit){
+        for (j=0;j<2;j++) {
+          p = Chem->Reactions[ind].reactant[j];
+          fprintf(fp,"%7s ",(p>=0) ? Chem->Species[p].name : "0");
+        }
+        for (j=0;j<4;j++) {
+          p = Chem->Reactions[ind].product[j];
+          fprintf(fp,"%7s ",(p>=0) ? Chem->Species[p].name : "0");
+        }
         fprintf(fp,"\n");
-       } /*end if limit*/
-     } /* end if reactant/product */
+      } /* end print reactions */
     }/* end k */
   }/* end i */
+  fclose(fp);
   printf(" Output file completed!\n");
+
+  free_1d_array(des);
+  free_1d_array(form);
+  free_1d_array(flux);
   return ;
 }
 
+/*============================================================================
+ * public function:
+   reaction_ratio(ChemEvln *Evln, Real *ratio)
+   largest contribution of each reaction to the formation or destruction
+   rate of one of its species, ratio[0..NReaction-1]; select_reaction keeps
+   the reactions with ratio > problem/limit
+ =========================================================================*/
 
+void reaction_ratio(ChemEvln *Evln, Real *ratio)
+{
+  int i,k;
+  Real rate,*des,*form,*flux;
+  EquationTerm *EqTerm;
+  Chemistry *Chem = Evln->Chem;
+  int Ntot = Chem->Ntot;
 
+  des   = (Real*)calloc_1d_array((Ntot),sizeof(Real));
+  form  = (Real*)calloc_1d_array((Ntot),sizeof(Real));
+  flux  = (Real*)calloc_1d_array(MAX(Chem->NReaction,1),sizeof(Real));
+  for(i=0;i<Chem->NReaction;i++)
+    ratio[i] = 0.;
 
+  /* G[i] and L[i] for all species, then the share of each reaction */
+  reaction_flux(Evln, flux);
+  for(i=0;i<Ntot;i++){
+    des[i] = form[i] = 0.;
+    for (k=0;k<Chem->Equations[i].NTerm;k++)
+    {
+      EqTerm = &(Chem->Equations[i].EqTerm[k]);
+      if(EqTerm->dir>0) form[i] += flux[EqTerm->ind];
+      else              des[i]  += flux[EqTerm->ind];
+    }
 
+    for (k=0;k<Chem->Equations[i].NTerm;k++)
+    {
+      EqTerm = &(Chem->Equations[i].EqTerm[k]);
+      rate = flux[EqTerm->ind];
+      if((EqTerm->dir>0) && (form[i]>0.))
+        ratio[EqTerm->ind] = MAX(ratio[EqTerm->ind], rate/form[i]);
+      if((EqTerm->dir<0) && (des[i]>0.))
+        ratio[EqTerm->ind] = MAX(ratio[EqTerm->ind], rate/des[i]);
+    }
+  }
 
-
-
+  free_1d_array(des);
+  free_1d_array(form);
+  free_1d_array(flux);
+  return ;
+}
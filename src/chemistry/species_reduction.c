@@ -5,8 +5,29 @@
  * PURPOSE: Contains functions to reduce the full chemical network
  *          using species based reduction method.
  *
+ *   The sensitivity of species i sums the contributions of the terms of the
+ *   equations of all species j already in the reduced network. Those depend
+ *   on j only, so they are added once, when j enters the network, by going
+ *   through the terms of its own equation (AddSens); the cost of the whole
+ *   reduction is then linear in the size of the network instead of growing
+ *   with maxiter*Ntot.
+ *
+ *   With problem/redobj=1 the objective is instead the error in the magnetic
+ *   diffusivities (EtaSens). The charged species are seeded with
+ *   t_i = max |d ln eta/d ln n_i| over eta_O, eta_H and eta_A (Cal_etasens),
+ *   and the importance is carried down the reaction graph as in DRGEP:
+ *
+ *     R_i = max over paths j -> ... of t_j * prod r_ab,
+ *     r_ij = min(1, sum_k |n_i df_jk/dn_i| / maxrat_j)
+ *
+ *   the species with R_i > problem/etatol are kept. Only the species that
+ *   matter to the charge carriers enter, so the network shrinks much more
+ *   than with the abundances of all species as the objective.
+ *
  * CONTAINS PUBLIC FUNCTIONS:
  *   species_reduction.c - reduct chemical network
+ *   species_sens()      - select the species and their sensitivities in one
+ *                         cell (see also reduce_grid.c)
  *
  * REFERENCES:
  *   D. Wiebe, et al. 2003, A&A, 399, 197-210
@@ -26,101 +47,112 @@
 #include "../header/prototypes.h"
 #include "../header/chemproto.h"
 
+/*==============================================================================
+ * PRIVATE FUNCTION PROTOTYPES:
+ *   AddSens() - add the contributions of the equation of one species to sens
+ *   MaxRate() - larger of the formation and destruction rates of each species
+ *   EtaSens() - select the species by their importance for the diffusivities
+ *============================================================================*/
+
+void AddSens(ChemEvln *Evln, int j, Real *maxrat, Real *sens);
+void MaxRate(ChemEvln *Evln, Real *maxrat);
+void EtaSens(ChemEvln *Evln, int *add, Real *sens);
+
+/*============================================================================*/
+/*----------------------------- Public Functions -----------------------------*/
+
 void species_reduction(ChemEvln *Evln)
 {
-
-  int i,j,k,l,m,iter,label,p,q,*add;
-  Real rate,MaxB,*sens,*df,*des,*form,*maxrat;
-  EquationTerm *EqTerm;
+  int i,j,k,*add;
+  Real MaxB,*sens;
   Chemistry *Chem = Evln->Chem;
   int Ntot= Chem->Ntot;
   FILE *fp; char fname[50];
 
+  sens = (Real*)calloc_1d_array(Ntot,sizeof(Real));
+  add = (int*)calloc_1d_array(Ntot,sizeof(int));
+
+  species_sens(Evln, add, sens);
+
+  /* output the all the species added in the network */
+  sprintf(fname,"%s",par_gets("job","savep"));
+  if((fp = fopen(fname,"w")) == NULL)
+    ath_error("Error open file %s \n",fname);
+  int out = par_getd("problem","outform");
+  switch(out){
+    case 0:
+    for(i=0;i<Ntot;i++){
+      if(add[i]>0)
+      fprintf(fp,"%e %7s %d\n",sens[i],Chem->Species[i].name,add[i]);
+    }
+    break;
+    default: 
+    for(i=0;i<Ntot;i++){
+      MaxB=0.0;
+      for(j=1;j<Ntot;j++){
+       if(sens[j]>MaxB){
+         MaxB = sens[j];k=j;}
+      }
+      fprintf(fp,"%e  %7s %d \n",sens[k],Chem->Species[k].name,add[k]);
+      sens[k]=0 ;
+     }
+    break;
+  }
+  fclose(fp);
+
+  free_1d_array(sens);
+  free_1d_array(add);
+} // end 
+
+/*----------------------------------------------------------------------------*/
+/* Select the important species at the current state of Evln: add[i]=1 for
+ * the selected species, with their sensitivities sens[i] (arrays of Ntot)
+ */
+void species_sens(ChemEvln *Evln, int *add, Real *sens)
+{
+
+  int i,k,iter,label,*added,nadded;
+  Real MaxB,*maxrat;
+  Chemistry *Chem = Evln->Chem;
+  int Ntot= Chem->Ntot;
+
+  /* diffusivities as the objective */
+  if (par_geti_def("problem","redobj",0) == 1) {
+    EtaSens(Evln, add, sens);
+    return;
+  }
+
   Real minsens = par_getd("problem","minsens");
   int maxiter  = par_getd("problem","maxiter");
   Real minratio= par_getd("problem","minratio");
   int red      = par_getd("problem","red");
 
   /* initialization */
-  sens = (Real*)calloc_1d_array(Ntot,sizeof(Real));
-  add = (int*)calloc_1d_array(Ntot,sizeof(int));
-  df = (Real*)calloc_1d_array(Ntot,sizeof(Real));
-  des = (Real*)calloc_1d_array(Ntot,sizeof(Real));
-  form = (Real*)calloc_1d_array(Ntot,sizeof(Real));
   maxrat = (Real*)calloc_1d_array(Ntot,sizeof(Real));
+  added = (int*)calloc_1d_array(Ntot,sizeof(int));
   for(i=0;i<Ntot;i++){
-    sens[i]=add[i]=df[i]=des[i]=form[i]=maxrat[i]= 0;
+    sens[i]=add[i]= 0;
   }
 
   /* first choose important species */
   add[0] = 1;        //e-
 
   /* calculate the maxrat(j) for all species in the network */
-  /* ignore desorption since its reaction rate are far more
-   * larger than other reactions */
-  for(i=0;i<Ntot;i++){
-    for (k=0;k<Chem->Equations[i].NTerm;k++)
-    {
-      EqTerm = &(Chem->Equations[i].EqTerm[k]);
-      if(Chem->Reactions[EqTerm->ind].rtype !=4){//exclude desorption
-        /* destruction channel */
-        if(EqTerm->dir<0){
-          rate = Evln->K[EqTerm->ind];
-          for (l=0;l<EqTerm->N;l++){
-            p = EqTerm->lab[l];
-            rate *= Evln->NumDen[p];
-          }
-          des[i] += rate;
-        }
-        /* formation channel */
-        if(EqTerm->dir>0){
-          rate = Evln->K[EqTerm->ind];
-          for (l=0;l<EqTerm->N;l++){
-            p = EqTerm->lab[l];
-            rate *= Evln->NumDen[p];
-          }
-          form[i] += rate;
-        }
-      }// end rtype
-    } // end Nterm
-    maxrat[i] = MAX(des[i],form[i]);
-  }//end of calculate maxrat[i]
+  MaxRate(Evln, maxrat);
+
+  /* species added to the network since the last update of sens (e-) */
+  added[0] = 0;
+  nadded = 1;
 
   /* Add one species each iteration */
   iter = 0;
   while(iter<maxiter){
     ath_pout(0,"iteration=%d\n",iter);
-    /* For each species, sum over the 
-     * influence of all other species */
-    for(i=0;i<Ntot;i++)/*loop over all species*/
-    {
-      sens[i] = 0.0;
-      for(j=0;j<Ntot;j++){
-      if(add[j]== 1){
-        for (k=0;k<Chem->Equations[j].NTerm;k++){
-          EqTerm = &(Chem->Equations[j].EqTerm[k]);
-          if(Chem->Reactions[EqTerm->ind].rtype !=4){//exclude desorption
-            /* compute the value of df/dn */
-            /* One reactant */
-            if(EqTerm->N==1){
-              if(EqTerm->lab[0] == i){
-                df[j] = Evln->K[EqTerm->ind]*EqTerm->dir;
-                sens[i] +=pow(Evln->NumDen[i]*df[j]/maxrat[j],2);
-            }}
-            else if(EqTerm->N ==2){ /*Two reactant*/
-              if(EqTerm->lab[0] ==i){
-                q = EqTerm->lab[1];
-                df[j] = Evln->K[EqTerm->ind]*Evln->NumDen[q]*EqTerm->dir;
-                sens[i] += pow(Evln->NumDen[i]*df[j]/maxrat[j],2);
-              }
-              if(EqTerm->lab[1] ==i){
-                q = EqTerm->lab[0];
-                df[j] = Evln->K[EqTerm->ind]*Evln->NumDen[q]*EqTerm->dir;
-                sens[i] += pow(Evln->NumDen[i]*df[j]/maxrat[j],2);
-              }}
-          }
-       }}
-    }} //loop for k && j && i;
+
+    /* add the influence of the new species on all other species */
+    for(k=0;k<nadded;k++)
+      AddSens(Evln, added[k], maxrat, sens);
+    nadded = 0;
 
     /* estimate sensi and determine 
      * which species need to be added */
@@ -146,6 +178,7 @@ void species_reduction(ChemEvln *Evln)
       }
       add[label] = 1.0;
       ath_pout(0,"Add species: %7s sens: %e\n",Chem->Species[label].name,sens[label]);
+      added[nadded++] = label;
       iter += 1.;
     }
     else{
@@ -154,6 +187,7 @@ void species_reduction(ChemEvln *Evln)
       for(k=0;k<Ntot;k++){
         if(sens[k]>minsens && add[k]<1.0){
           add[k] = 1.;
+          added[nadded++] = k;
           addnum += 1;
           ath_pout(0,"Add species: %7s sens: %e\n",Chem->Species[k].name,sens[k]);
         }
@@ -165,33 +199,163 @@ void species_reduction(ChemEvln *Evln)
 
   }//while loop.
 
+  free_1d_array(added);
+  free_1d_array(maxrat);
 
-  /* output the all the species added in the network */
-  sprintf(fname,"%s",par_gets("job","savep"));
-  if((fp = fopen(fname,"w")) == NULL)
-    ath_error("Error open file %s \n",fname);
-  int out = par_getd("problem","outform");
-  switch(out){
-    case 0:
-    for(i=0;i<Ntot;i++){
-      if(add[i]>0)
-      fprintf(fp,"%e %7s %d\n",sens[i],Chem->Species[i].name,add[i]);
+  return;
+}
+
+/*============================================================================*/
+/*----------------------------- Private Functions ----------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/* Add to sens[i] the contributions (n_i df_j/dn_i / maxrat_j)^2 of the terms
+ * of the equation of species j (desorption excluded) in which i appears
+ */
+void AddSens(ChemEvln *Evln, int j, Real *maxrat, Real *sens)
+{
+  int k, i, q;
+  Real df;
+  EquationTerm *EqTerm;
+  Chemistry *Chem = Evln->Chem;
+
+  for (k=0;k<Chem->Equations[j].NTerm;k++){
+    EqTerm = &(Chem->Equations[j].EqTerm[k]);
+    if(Chem->Reactions[EqTerm->ind].rtype ==4) continue; //exclude desorption
+
+    /* One reactant */
+    if(EqTerm->N==1){
+      i = EqTerm->lab[0];
+      df = Evln->K[EqTerm->ind]*EqTerm->dir;
+      sens[i] += SQR(Evln->NumDen[i]*df/maxrat[j]);
     }
-    break;
-    default: 
-    for(i=0;i<Ntot;i++){
-      MaxB=0.0;
-      for(j=1;j<Ntot;j++){
-       if(sens[j]>MaxB){
-         MaxB = sens[j];k=j;}
+    else if(EqTerm->N ==2){ /*Two reactant*/
+      i = EqTerm->lab[0];
+      q = EqTerm->lab[1];
+      df = Evln->K[EqTerm->ind]*Evln->NumDen[q]*EqTerm->dir;
+      sens[i] += SQR(Evln->NumDen[i]*df/maxrat[j]);
+
+      i = EqTerm->lab[1];
+      q = EqTerm->lab[0];
+      df = Evln->K[EqTerm->ind]*Evln->NumDen[q]*EqTerm->dir;
+      sens[i] += SQR(Evln->NumDen[i]*df/maxrat[j]);
+    }
+  }
+
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* maxrat[i] = MAX(formation, destruction) rate of species i; desorption is
+ * ignored since its rates are far larger than those of other reactions
+ */
+void MaxRate(ChemEvln *Evln, Real *maxrat)
+{
+  int i,k,l,p;
+  Real rate,des,form;
+  EquationTerm *EqTerm;
+  Chemistry *Chem = Evln->Chem;
+
+  for(i=0;i<Chem->Ntot;i++){
+    des = form = 0.;
+    for (k=0;k<Chem->Equations[i].NTerm;k++)
+    {
+      EqTerm = &(Chem->Equations[i].EqTerm[k]);
+      if(Chem->Reactions[EqTerm->ind].rtype ==4) continue; //exclude desorption
+
+      rate = Evln->K[EqTerm->ind];
+      for (l=0;l<EqTerm->N;l++){
+        p = EqTerm->lab[l];
+        rate *= Evln->NumDen[p];
       }
-      fprintf(fp,"%e  %7s %d \n",sens[k],Chem->Species[k].name,add[k]);
-      sens[k]=0 ;
-     }
-    break;
+      if(EqTerm->dir<0) des  += rate;   /* destruction channel */
+      if(EqTerm->dir>0) form += rate;   /* formation channel */
+    }
+    maxrat[i] = MAX(des,form);
   }
-  fclose(fp);
-} // end 
 
+  return;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Select the species by their importance R_i for eta_O, eta_H and eta_A (see
+ * the top of the file): add[i]=1 for R_i > problem/etatol, sens[i] = R_i
+ */
+void EtaSens(ChemEvln *Evln, int *add, Real *sens)
+{
+  int i,j,k,l,*done;
+  Real rate,r,*maxrat,*coup,*dO,*dH,*dA;
+  EquationTerm *EqTerm;
+  Chemistry *Chem = Evln->Chem;
+  int Ntot= Chem->Ntot;
+
+  Real etatol = par_getd_def("problem","etatol",0.1);
+
+  maxrat = (Real*)calloc_1d_array(Ntot,sizeof(Real));
+  coup   = (Real*)calloc_1d_array(Ntot,sizeof(Real));
+  dO     = (Real*)calloc_1d_array(Ntot,sizeof(Real));
+  dH     = (Real*)calloc_1d_array(Ntot,sizeof(Real));
+  dA     = (Real*)calloc_1d_array(Ntot,sizeof(Real));
+  done   = (int*)calloc_1d_array(Ntot,sizeof(int));
+
+  MaxRate(Evln, maxrat);
+
+  /* the charge carriers, by their share of the conductivities */
+  Evln->B = par_getd_def("problem","B",1.0);
+  Cal_etasens(Evln, dO, dH, dA);
+  for(i=0;i<Ntot;i++){
+    sens[i] = MAX(fabs(dO[i]),MAX(fabs(dH[i]),fabs(dA[i])));
+    add[i] = done[i] = 0;
+    coup[i] = 0.;
+  }
+  ath_pout(0,"eta_O=%e, eta_H=%e, eta_A=%e (B=%g)\n",
+              Evln->eta_O,Evln->eta_H,Evln->eta_A,Evln->B);
+
+  /* the most important species not yet added passes its importance on to
+   * the species of its equation */
+  while(1){
+    j = -1;
+    for(i=0;i<Ntot;i++)
+      if(!done[i] && (sens[i] > etatol) && ((j < 0) || (sens[i] > sens[j])))
+        j = i;
+    if(j < 0) break;
+
+    done[j] = 1;
+    add[j] = 1;
+    ath_pout(0,"Add species: %7s importance: %e\n",Chem->Species[j].name,sens[j]);
+
+    if(maxrat[j] <= 0.) continue;
+
+    /* |n_i df_j/dn_i| of each term is its rate, for all its reactants */
+    for (k=0;k<Chem->Equations[j].NTerm;k++){
+      EqTerm = &(Chem->Equations[j].EqTerm[k]);
+      if(Chem->Reactions[EqTerm->ind].rtype ==4) continue; //exclude desorption
+      rate = Evln->K[EqTerm->ind];
+      for (l=0;l<EqTerm->N;l++)
+        rate *= Evln->NumDen[EqTerm->lab[l]];
+      for (l=0;l<EqTerm->N;l++)
+        coup[EqTerm->lab[l]] += rate;
+    }
+    for (k=0;k<Chem->Equations[j].NTerm;k++){
+      EqTerm = &(Chem->Equations[j].EqTerm[k]);
+      for (l=0;l<EqTerm->N;l++){
+        i = EqTerm->lab[l];
+        if(coup[i] <= 0.) continue;
+        r = MIN(coup[i]/maxrat[j],1.0);
+        sens[i] = MAX(sens[i],sens[j]*r);
+        coup[i] = 0.;
+      }
+    }
+  }
+
+  add[0] = 1;        //e-
 
+  free_1d_array(maxrat);
+  free_1d_array(coup);
+  free_1d_array(dO);
+  free_1d_array(dH);
+  free_1d_array(dA);
+  free_1d_array(done);
 
+  return;
+}
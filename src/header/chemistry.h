@@ -21,6 +21,7 @@
 #define OneYear 3.15576e7   /* one year in unit of second */
 #define ChemErr 0.001  /* maximum allowable error in the chemical evolution */
 #define MUN 2.34   /* mean molecular weight */
+#define NSTAT 5    /* results of solve_cell(): CPU time, x_e, eta_O, eta_H, eta_A */
 
 /*----------------------------------------------------------------------------*/
 /***************************** Structure Definition ***************************/
@@ -116,7 +117,240 @@ typedef struct EquationInfo_s {
   EquationTerm *EqTerm;
 
 }EquationInfo;
+/*-----------------------------------------------------------------------------
+ * Table of ln(K) on a uniform ln(T) grid for temperature dependent reactions
+ */
+typedef struct RateTable_s {
+
+  int nT;              /* number of temperature grid points (>=4) */
+  Real lnTmin;         /* ln(T) of the first grid point */
+  Real lnTmax;         /* ln(T) of the last grid point */
+  Real dlnT;           /* grid spacing in ln(T) */
+  Real tol;            /* maximum allowed relative interpolation error */
 
+  int NTab;            /* number of tabulated reactions */
+  int *ind;            /* table column of each reaction (-1: exact) */
+  Real *err;           /* max. relative interpolation error of each reaction */
+  Real *lnK;           /* ln(K) on the grid: 0..nT*NTab-1 */
+
+}RateTable;
+
+/*-----------------------------------------------------------------------------
+ * Ordering of the species in the solver state vector (see ordering.c)
+ */
+typedef struct ChemOrder_s {
+
+  int N;               /* number of species */
+  int *perm;           /* species at each position of the state vector */
+  int *iperm;          /* position of each species in the state vector */
+  int mu, ml;          /* upper/lower half-bandwidth of the Jacobian */
+  int mu0, ml0;        /* the same in the natural species order */
+
+}ChemOrder;
+
+/*-----------------------------------------------------------------------------
+ * Gas/grain block preconditioner of the solver (see precond.c)
+ */
+typedef struct ChemPrecond_s {
+
+  int NG;              /* number of gas species (before the grains) */
+  int NL;              /* number of grain species */
+  int LS;              /* length of one grain charge ladder */
+
+  Real **A;            /* gas block, then LU of its Schur complement */
+  long int *piv;       /* pivots of the LU */
+  Real *B;             /* gas rows, grain columns: 0..NG*NL-1 */
+  Real *C;             /* grain rows, gas columns: 0..NL*NG-1 */
+  Real **D;            /* LU of each ladder: columns of ladder k from k*LS */
+  long int *pivL;      /* pivots of the ladders */
+
+  int nc;              /* number of gas species coupled to the grains */
+  int *col;            /* label of these gas species */
+  Real *W;             /* D^{-1} C for these columns: 0..nc*NL-1 */
+
+  Real *y;             /* work array: 0..NL-1 */
+  long int nsetup;     /* number of factorizations */
+
+}ChemPrecond;
+
+/*-----------------------------------------------------------------------------
+ * Quasi-steady grain charge distribution (see grain_charge.c)
+ */
+typedef struct GrCharging_s {
+
+  int NG;              /* number of gas species (before the grains) */
+  int NL;              /* number of grain species */
+  int LS;              /* length of one grain charge ladder */
+  int NBin;            /* number of grain bins (types) */
+
+  /* charging reactions of grain species l: up[l]..up[l+1]-1 (Z -> Z+1) and
+   * dn[l]..dn[l+1]-1 (Z -> Z-1), with the reaction and its gas reactant */
+  int *up, *ureac, *ugas;
+  int *dn, *dreac, *dgas;
+
+  Real *ntot;          /* number density of each bin: 0..NBin-1 */
+  int *charge;         /* charge of the gas species: 0..NG-1 */
+  Real ne;             /* last electron density found */
+
+  /* rates of the grain species l for Z -> Z+1 (u) and Z -> Z-1 (d): per unit
+   * electron density (e) and from the other gas species (i), 0..NL-1 */
+  Real *ue, *ui, *de, *di;
+  Real *lf;            /* work array: 0..LS-1 */
+  Real *n;             /* number densities of all species: 0..Ntot-1 */
+
+}GrCharging;
+
+/*-----------------------------------------------------------------------------
+ * Charge distribution of the lumped grain species (see grain_lump.c)
+ */
+typedef struct GrLumping_s {
+
+  int NG;              /* number of gas species (before the grains) */
+  int NBin;            /* number of grain types */
+  int ZM;              /* the charge runs over -ZM..ZM */
+  int LS;              /* number of charge states: 2*ZM+1 */
+  int closure;         /* 0: detailed balance, 1: Gaussian */
+
+  /* capture reactions c=0..NC-1: the reaction, its gas reactant, the grain
+   * type, the change of the grain charge (+1/-1) and the grain charges it
+   * occurs at (zlo..zhi) */
+  int NC;
+  int *reac, *gas, *bin, *dz, *zlo, *zhi;
+  Real **Kz;           /* rate coefficient at charge Z (cgs): [c][Z+ZM] */
+  Real *keff;          /* mean over the distribution (cgs): 0..NC-1 */
+  Real fac;            /* two-body rate coefficients in solver units: K*fac */
+
+  Real *ntot;          /* number density of each grain type: 0..NBin-1 */
+  int *charge;         /* charge of the gas species: 0..NG-1 */
+  Real ne;             /* last electron density found */
+
+  /* rates of charge Z -> Z+1 (ui, by ions) and Z -> Z-1 of type b, per unit
+   * electron density (de) and from the anions (di): b*LS+Z+ZM */
+  Real *ui, *de, *di;
+  Real *p;             /* charge distribution: b*LS+Z+ZM */
+  Real *lf;            /* work array: 0..LS-1 */
+  Real *n;             /* number densities of all species: 0..Ntot-1 */
+
+}GrLumping;
+
+/*-----------------------------------------------------------------------------
+ * Conserved moieties of the reaction equations (see moiety.c)
+ */
+typedef struct ChemMoiety_s {
+
+  int N;               /* number of species */
+  int NR;              /* number of conservation laws: N_Ele_tot+1 (charge) */
+  int NC;              /* number of independent ones (dependent species) */
+  int NI;              /* number of independent species: N-NC */
+
+  Real **M;            /* conservation matrix: 0..NR-1, 0..N-1 */
+  Real *T0;            /* conserved totals: 0..NR-1 */
+  Real **R;            /* reduced matrix, R[r][dep[r]] = 1: 0..NC-1, 0..N-1 */
+  Real *T;             /* reduced totals: 0..NC-1 */
+
+  int *dep;            /* dependent species of each reduced row: 0..NC-1 */
+  int *ind;            /* independent species: 0..NI-1 */
+  int *pos;            /* position in the reduced vector (-1 if dependent) */
+  Real *n;             /* number densities of all species: 0..N-1 */
+
+}ChemMoiety;
+
+/*-----------------------------------------------------------------------------
+ * Species in quasi-steady state (see qssa.c)
+ */
+typedef struct ChemQSSA_s {
+
+  int N;               /* number of species */
+  int NF;              /* number of fast species */
+  int NS;              /* number of slow (evolved) species */
+
+  int *fast;           /* fast species: 0..NF-1 */
+  int *slow;           /* slow species: 0..NS-1 */
+  int *pos;            /* position in the state vector (-1 if fast): 0..N-1 */
+  Real *n;             /* number densities of all species: 0..N-1 */
+
+  long int nsolve;     /* number of solutions for the fast species */
+  long int nfail;      /* number of them not converged */
+
+}ChemQSSA;
+
+/*-----------------------------------------------------------------------------
+ * Active species and reactions of one cell (see adaptive.c)
+ */
+typedef struct ChemDAC_s {
+
+  int N;               /* number of species */
+  int NR;              /* number of reactions */
+  Real eps;            /* threshold of the coupling coefficients */
+
+  int NT;              /* number of target species */
+  int *targ;           /* target species: 0..NT-1 */
+
+  int NA;              /* number of active species */
+  int NRA;             /* number of active reactions */
+  int *act;            /* active species: 0..NA-1 */
+  int *pos;            /* position in the state vector (-1 if inactive) */
+  int *ruse;           /* 1 if all species of reaction r are active: 0..NR-1 */
+  Real *n;             /* number densities of all species: 0..N-1 */
+
+  Real *w;             /* work: coupling to each species: 0..N-1 */
+  int *touch;          /* work: species with w != 0, search queue and the */
+  int *queue, *mark;   /* species reached: 0..N-1 */
+
+  long int nsel;       /* number of selections */
+  long int nchange;    /* number of them that changed the active species */
+  long int nstep;      /* number of output steps, and the sums of NA, NRA */
+  Real sumNA, sumNRA;  /* over them */
+
+}ChemDAC;
+
+/*-----------------------------------------------------------------------------
+ * Main formation and destruction channels of each species (see
+ * flux_analysis.c); direction d is 0 for formation and 1 for destruction
+ */
+typedef struct FluxTable_s {
+
+  int N;               /* number of species */
+  int k;               /* maximum number of channels per species and direction */
+  Real frac;           /* fraction of the total rate the channels cover */
+
+  Real *tot;           /* total rate of species i in direction d: d*N+i */
+  int *nch;            /* number of channels kept: d*N+i */
+  int *reac;           /* reaction of channel m: (d*N+i)*k+m */
+  Real *rate;          /* rate of channel m: (d*N+i)*k+m */
+
+  int *wind;           /* work arrays: 0..max NTerm-1 */
+  Real *wrate;
+
+}FluxTable;
+
+/*-----------------------------------------------------------------------------
+ * Modes of the Jacobian and CSP indices of one cell (see csp.c); mode k is
+ * the k-th fastest, the fast modes being 0..M-1
+ */
+typedef struct ChemCSP_s {
+
+  int N;               /* number of species */
+  int NR;              /* number of reactions */
+  int M;               /* number of exhausted (fast) modes */
+  Real tauf;           /* timescale of the slowest fast mode (s) */
+  Real taus;           /* timescale of the fastest slow mode (s) */
+
+  Real *wr, *wi;       /* eigenvalues (s^-1), fastest first: 0..N-1 */
+  Real **A;            /* right basis vector of mode k: A[k][0..N-1] */
+  Real **B;            /* left basis vector (B A = I over 0..M-1): B[k][] */
+  Real *ptr;           /* radical pointer of each species: 0..N-1 */
+  Real *part;          /* participation in the fast modes: 0..NR-1 */
+  Real *imp;           /* importance for the slow species: 0..NR-1 */
+
+  Real **J, **H, **W;  /* work: Jacobian, Hessenberg matrix, shifted system */
+  Real **beta;         /* work: B S_r of the fast modes: beta[k][r] */
+  Real *g, *gr;        /* work: dn/dt and the sum of |rates| of each species */
+  Real *f, *df;        /* work: amplitudes of the fast modes and their errors */
+  Real *x, *y, *s;
+  int *ord, *indx;
+
+}ChemCSP;
 
 /*-----------------------------------------------------------------------------
  * Global information of the chemistry model (independent of cells)
@@ -133,6 +367,9 @@ typedef struct Chemistry_s {
 
   int NGrain;         /* # of grain types */
   int GrCharge;       /* Maximum charge of a grain */
+  int GrLump;         /* 1 if the charge states of a grain type are lumped
+                       * into one species (see grain_lump.c) */
+  int GrZmax;         /* Maximum charge of a lumped grain (GrCharge is 0) */
   Real GrDen;         /* Grain mass density, g/cm^3 */
   Real *GrSize;       /* Grain size, micron */
   Real *GrFrac;       /* Grain mass fraction */
@@ -157,6 +394,26 @@ typedef struct Chemistry_s {
   /* Array of evolution equations of all species */
   EquationInfo *Equations;   /* 0..Ntot-1 */
 
+  /* Hashed name index (open addressing, -1 for an empty slot) */
+  int ElHash_size;           /* size of the element table (power of 2) */
+  int *ElHash;               /* element label of each slot */
+  int SpHash_size;           /* size of the species table (power of 2) */
+  int *SpHash;               /* species label of each slot */
+
+  /* Rate coefficient table (NULL if rates are calculated exactly) */
+  RateTable *RTab;
+
+  /* Solver ordering of the species (NULL for the natural order) */
+  ChemOrder *Order;
+
+  /* Contiguous block holding all arrays above (see arena.c) */
+  void *Arena;
+  size_t Arena_size;
+
+  /* Mapped network cache holding the arena (NULL if not mapped) */
+  void *NetMap;
+  size_t NetMap_size;
+
 }Chemistry;
 
 Chemistry Chem;
@@ -189,6 +446,9 @@ typedef struct ChemEvln_s {
   /* Fraction of grain mantle species available for surface reactions */
   Real *GrAvail;       /* 0..Ntot-1 */
 
+  /* Charge distribution of the lumped grains (see grain_lump.c) */
+  Real *GrDist;        /* k*(2*GrZmax+1)+Z+GrZmax, k=0..NGrain-1 */
+
   /* Abundance to number density ratio */
   Real Abn_Den;              /* abundance / number density (1/n_H) */
 
@@ -198,10 +458,49 @@ typedef struct ChemEvln_s {
   /* Magnetic diffusivity */
   Real eta_O, eta_H, eta_A;
 
+  /* Solver cost of the last evolve(): RHS evaluations, with those of the
+   * band preconditioner */
+  long int nfe;
+
 }ChemEvln;
 
 ChemEvln Evln;
 
+/*-----------------------------------------------------------------------------
+ * A vertical column of cells sharing the same line of sight. Quantities that
+ * only depend on the column density (Av, photo-reaction attenuation) are
+ * computed once for all cells.
+ */
+typedef struct ChemColumn_s {
+
+  int nz;                    /* number of cells in the column */
+  Real *z;                   /* height of each cell (in unit of H) */
+  Real *sigz;                /* column density from the top (g/cm^2) */
+  Real *Av;                  /* visual extinction from the top */
+  Real *zeta;                /* ionization rate of each cell */
+
+  Real G0;                   /* incident UV field (Habing unit) */
+
+  int NPhoto;                /* number of photo-reactions (rtype 10) */
+  int *photo;                /* reaction label of each photo-reaction */
+  Real *atten;               /* exp(-gamma*Av): 0..nz*NPhoto-1 */
+
+}ChemColumn;
+
+/*-----------------------------------------------------------------------------
+ * An input file read into memory (see input_file.c)
+ */
+typedef struct InputFile_s {
+
+  char fname[MAXLEN];        /* name of the file */
+  char *buf;                 /* content of the file, '\0' terminated */
+  size_t len;                /* length of the content */
+  size_t pos;                /* current position */
+  size_t bol;                /* position of the beginning of current line */
+  int line;                  /* current line number (from 1) */
+
+}InputFile;
+
 /*-----------------------------------------------------------------------------
  * Output parameters
  */
@@ -248,6 +547,10 @@ typedef struct Nebula_s{
   Real Lx;		/* X-ray flux (10^29 erg/s) */
   Real Tx;		/* X-ray source temperature (keV) */
 
+  /* X-ray ionization fitting coefficients at Tx (set by XrayFit_disk) */
+  Real xr1, xcol1, xpow1;
+  Real xr2, xcol2, xpow2;
+
 }Nebula;
 
 
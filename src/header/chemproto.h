@@ -16,15 +16,38 @@
 /*----------------------------------------------------------------------------*/
 #ifdef CHEMISTRY
 
+/*----------------------------------------------------------------------------*/
+/* adaptive.c */
+void dac_analysis(Nebula *Disk, ChemColumn *Col);
+void init_dac(Chemistry *Chem, Real *K, Real *n, ChemDAC *D);
+void final_dac(ChemDAC *D);
+int  dac_select(ChemDAC *D, Chemistry *Chem, Real *K, Real *n);
+
+/*----------------------------------------------------------------------------*/
+/* arena.c */
+size_t arena_size(Chemistry *Chem);
+void arena_pack(Chemistry *Chem, char *buf, Chemistry *C);
+void arena_relocate(Chemistry *C, char *buf, size_t from, size_t to);
+void pack_chemistry(Chemistry *Chem);
+
+/*----------------------------------------------------------------------------*/
+/* benchmark.c */
+void bench_reduction(Nebula *Disk, ChemColumn *Col);
+
 /*----------------------------------------------------------------------------*/
 /* coeff.c */
 void IonizationCoeff(ChemEvln *Evln, Real zeta_eff, Real Av, int verbose);
 void IonizationCoeff1(ChemEvln *Evln, Real zeta_eff, Real Av,Real G, int verbose);
+void IonizationCoeff_column(ChemEvln *Evln, ChemColumn *Col, int iz,
+                            Real zeta_eff, int verbose);
 void CalCoeff(ChemEvln *Evln, Real T, int verbose);
 void coeff_adj(ChemEvln *Evln);
 
 Real ChemCoeff(Coefficient *coeff, Real T, int NumTRange);
 Real IonGrCoeff(Chemistry *Chem, int i, Real T);
+Real LumpGrCoeff(Chemistry *Chem, int i, int Z, Real T);
+Real ChargeGrCoeff(Coefficient *coeff, Real q, int Z, Real size, Real s,
+                   Real T);
 Real NeuGrCoeff(Chemistry *Chem, ChemEvln *Evln, int i);
 Real DesorpCoeff(Coefficient *coeff, Real T);
 Real GrGrCoeff(Chemistry *Chem, int i, Real T);
@@ -32,23 +55,43 @@ Real GrSurfCoeff(ChemEvln *Evln, int i, Real T);
 void GrAvailFac(ChemEvln *Evln);
 Real EleStickCoeff(Real size, int Z, Real T0);
 
+/*----------------------------------------------------------------------------*/
+/* column.c */
+void init_column(Chemistry *Chem, ChemColumn *Col, Nebula *Disk, Real radius,
+                 int nz, Real *z, Real G0);
+void final_column(ChemColumn *Col);
+
+/*----------------------------------------------------------------------------*/
+/* csp.c */
+void csp_analysis(Nebula *Disk, ChemColumn *Col);
+void init_csp(Chemistry *Chem, ChemCSP *C);
+void final_csp(ChemCSP *C);
+int  csp_modes(ChemEvln *Evln, Real rtol, Real *tol, ChemCSP *C);
+void csp_indices(ChemEvln *Evln, Real *flux, ChemCSP *C);
+
 /*----------------------------------------------------------------------------*/
 /* density.c */
 void init_numberden(ChemEvln *Evln, Real rho, int verbose);
 void reset_numberden(ChemEvln *Evln, Real rho_new, int verbose);
 void denscale(ChemEvln *Evln, int verbose);
+void abstol_species(ChemEvln *Evln, int mode, Real rel, Real atol, Real *tol);
+void initial_species(Chemistry *Chem, int *pop);
 
 /*----------------------------------------------------------------------------*/
 /* diffusivity.c */
 void Cal_NIMHD(ChemEvln *Evln);
+void Cal_etasens(ChemEvln *Evln, Real *dO, Real *dH, Real *dA);
 void Cal_recomb(ChemEvln *Evln, Real Bmin, Real Bmax, int  nB,   Real Dt,
                                            Real *t_O, Real *t_H, Real *t_A);
 
 /*----------------------------------------------------------------------------*/
 /* disk.c */
 void init_disk(Nebula *Disk);
+void XrayFit_disk(Nebula *Disk);
 Real Ionization_disk(Nebula *Disk, Real radius, Real z);
 Real Ionization_disk1(Nebula *Disk, Real radius, Real sigmaz);
+void Ionization_column(Nebula *Disk, Real radius, int nz, Real *sigz,
+                       Real *zeta);
 
 Real SurfDen_disk (Nebula *Disk, Real radius);
 Real Temp_disk    (Nebula *Disk, Real radius);
@@ -58,17 +101,46 @@ Real Omega_disk   (Nebula *Disk, Real radius);
 Real eta0_disk    (Nebula *Disk, Real radius);
 Real Rho_disk     (Nebula *Disk, Real radius, Real z);
 Real SurfDenZ_disk(Nebula *Disk, Real radius, Real z);
+void SurfDenZ_column(Nebula *Disk, Real radius, int nz, Real *z, Real *sigz);
+Real Av_disk(Real sigz);
 
 /*----------------------------------------------------------------------------*/
 /* evolve.c */
 int evolve(Real te, Real dttry, Real err);
 void jacobi(ChemEvln *Evln, Real *numden, Real **jacob);
 void derivs(ChemEvln *Evln, Real *numden, Real *drv);
+void check_solver_options(Chemistry *Chem);
 //int EleMakeup(N_Vector &numden, int verbose);
 
+/*----------------------------------------------------------------------------*/
+/* flux_analysis.c */
+void flux_analysis(Nebula *Disk, ChemColumn *Col);
+void init_fluxtable(Chemistry *Chem, int k, Real frac, FluxTable *F);
+void final_fluxtable(FluxTable *F);
+void reaction_flux(ChemEvln *Evln, Real *flux);
+void flux_channels(Chemistry *Chem, Real *flux, FluxTable *F);
+
+/*----------------------------------------------------------------------------*/
+/* grain_charge.c */
+void init_grcharge(Chemistry *Chem, Real *n, GrCharging *G);
+void final_grcharge(GrCharging *G);
+void grcharge_balance(GrCharging *G, Real *K, Real *n);
+Real grcharge_root(Real (*charge)(void *arg, Real ne), void *arg, Real ne0,
+                   Real qion, Real qmax);
+Real grcharge_ladder(int LS, Real ne, Real *ue, Real *ui, Real *de, Real *di,
+                     Real *lf, Real *p);
+
+/*----------------------------------------------------------------------------*/
+/* grain_lump.c */
+void init_grlump(Chemistry *Chem, Real *n, Real fac, Real T, GrLumping *L);
+void final_grlump(GrLumping *L);
+void grlump_balance(GrLumping *L, Real *K, Real *n);
+int  grlump_range(Chemistry *Chem, int r, int *zlo, int *zhi);
+
 /*----------------------------------------------------------------------------*/
 /* init_chemistry.c */
 void init_chemistry (Chemistry *Chem);
+void build_chemistry(Chemistry *Chem);
 void init_chemevln  (Chemistry *Chem, ChemEvln *Evln);
 void dup_chemevln(ChemEvln *Evln, ChemEvln *Evln_new);
 void final_chemistry(Chemistry *Chem);
@@ -91,6 +163,38 @@ void PrintReaction(Chemistry *Chem, int i, Real K);
 /* init_species.c */
 void init_species(Chemistry *Chem);
 int  FindSpecies(Chemistry *Chem, char name[NL_SPE]);
+void HashSpecies(Chemistry *Chem);
+
+/*----------------------------------------------------------------------------*/
+/* input_file.c */
+int  open_input(InputFile *in, char *fname);
+void close_input(InputFile *in);
+void input_skipline(InputFile *in);
+void input_skipws(InputFile *in);
+void input_word(InputFile *in, char *word, int maxlen, char *what);
+int  input_int(InputFile *in, char *what);
+Real input_real(InputFile *in, char *what);
+int  input_species(InputFile *in, Chemistry *Chem, char *name);
+void input_error(InputFile *in, char *fmt, ...);
+
+/*----------------------------------------------------------------------------*/
+/* moiety.c */
+void init_moiety(Chemistry *Chem, Real *n, ChemMoiety *Mo);
+void final_moiety(ChemMoiety *Mo);
+int  moiety_pivot(ChemMoiety *Mo, Real *n);
+void moiety_expand(ChemMoiety *Mo, Real *x, Real *n);
+
+/*----------------------------------------------------------------------------*/
+/* netcache.c */
+int  read_netcache (Chemistry *Chem, char *fname);
+void write_netcache(Chemistry *Chem, char *fname);
+void final_netcache(Chemistry *Chem);
+
+/*----------------------------------------------------------------------------*/
+/* ordering.c */
+void init_ordering(Chemistry *Chem);
+void final_ordering(Chemistry *Chem);
+void Bandwidth(Chemistry *Chem, int *iperm, int *mu, int *ml);
 
 /*----------------------------------------------------------------------------*/
 /* output_chemistry.c */
@@ -111,6 +215,62 @@ void ChemSet_allgrain(Chemistry *Chem, ChemOutput *ChemOut);
 void ChemSet_allgas(Chemistry *Chem, ChemOutput *ChemOut);
 void ChemSet_selected(Chemistry *Chem, ChemOutput *ChemOut);
 
+/*----------------------------------------------------------------------------*/
+/* precond.c */
+void init_precond(Chemistry *Chem, ChemPrecond *P);
+void final_precond(ChemPrecond *P);
+int  precond_setup(ChemPrecond *P, Chemistry *Chem, Real *K, Real *n,
+                   Real gamma);
+void precond_solve(ChemPrecond *P, Real *r, Real *z);
+
+/*----------------------------------------------------------------------------*/
+/* prune.c */
+void prune_chemistry(Chemistry *Chem);
+
+/*----------------------------------------------------------------------------*/
+/* qssa.c */
+void init_qssa(Chemistry *Chem, Real *K, Real *n, Real tau, Real frac,
+               ChemQSSA *Q);
+void final_qssa(ChemQSSA *Q);
+int  qssa_solve(ChemQSSA *Q, Chemistry *Chem, Real *K, Real *n);
+
+/*----------------------------------------------------------------------------*/
+/* ratetable.c */
+void init_ratetable(Chemistry *Chem);
+void final_ratetable(Chemistry *Chem);
+int  RateTab_weights(RateTable *Tab, Real T, int *j, Real *w);
+Real RateTab_value(RateTable *Tab, int n, int j, Real *w);
+
+/*----------------------------------------------------------------------------*/
+/* reduce_grid.c */
+void reduce_grid(Nebula *Disk, ChemColumn *Col);
+void select_network(ChemColumn *Col, int **cover, Real *smax, Real *rmax,
+                    Real *abn);
+void solve_cell(Nebula *Disk, ChemColumn *Col, int c, Real *stat);
+void load_network(Nebula *Disk, ChemColumn *Col, char *sp, char *re,
+                  char *cache);
+void compare_cells(FILE *fp, ChemColumn *Col, Real **full, Real **red,
+                   Real **extra, int nx, Real *tsum, Real *emax);
+int  run_cells(int nc, int nproc, void (*eval)(int c, void *arg),
+               int (*io)(int fd, int c, int out, void *arg), void *arg);
+void write_pipe(int fd, void *buf, size_t n);
+int  read_pipe(int fd, void *buf, size_t n);
+
+/*----------------------------------------------------------------------------*/
+/* reduced_network.c */
+int  reduced_species(Chemistry *Chem, int *net);
+void write_reduced(Chemistry *Chem, int *net, int *rsel, Real *abn);
+
+/*----------------------------------------------------------------------------*/
+/* select_reaction.c */
+void select_reaction(ChemEvln *Evln);
+void reaction_ratio(ChemEvln *Evln, Real *ratio);
+
+/*----------------------------------------------------------------------------*/
+/* species_reduction.c */
+void species_reduction(ChemEvln *Evln);
+void species_sens(ChemEvln *Evln, int *add, Real *sens);
+
 /*----------------------------------------------------------------------------*/
 /* stifbs.c */
 int stifbs(ChemEvln *Evln, Real *y, Real *dydx, int nv, Real *xx,
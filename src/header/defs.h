@@ -29,6 +29,7 @@ typedef double Real;
 #define FOUR_3RDS 1.333333333333333
 #define TINY_NUMBER 1.0e-20
 #define HUGE_NUMBER 1.0e+20
+#define FNV1A_BASIS 2166136261U   /* initial value of fnv1a() */
 #define AU 1.49598e13
 
 #endif /* DEFINITIONS_H */
@@ -6,6 +6,7 @@
 /*============================================================================*/
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include "defs.h"
 
 /*----------------------------------------------------------------------------*/
@@ -38,6 +39,7 @@ int ath_pout(const int level, const char *fmt, ...);
 void   par_open(char *filename);
 void   par_cmdline(int argc, char *argv[]);
 int    par_exist(char *block, char *name);
+char  *par_next(char *block, void **pos);
 
 char  *par_gets(char *block, char *name);
 int    par_geti(char *block, char *name);
@@ -65,6 +67,7 @@ int ath_gcd(int a, int b);
 int ath_big_endian(void);
 void ath_bswap(void *vdat, int sizeof_len, int cnt);
 void ath_error(char *fmt, ...);
+uint32_t fnv1a(uint32_t h, const void *buf, size_t len);
 void ludcmp(Real **a, int n, int *indx, Real *d);
 void lubksb(Real **a, int n, int *indx, Real *b);
 void InverseMatrix(Real **a, int n, Real **b);
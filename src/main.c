@@ -18,10 +18,12 @@ int main(int argc, char *argv[])
   char id[20];
   char *athinput = NULL;
   Real tend,dttry,atol,rho, Tg, r,zeta_eff,zs,ze;
-  Real G,G0,depth;
+  Real G,G0,depth,*zcol;
+  int photocol,nz,compile=0,bench=0,gridred,fluxan,cspan,dacan;
   //Chemistry Chem;
   //ChemEvln  Evln;
   ChemOutput ChemOut;
+  ChemColumn Col;
   Nebula Disk;
 /*--- Step 1. ----------------------------------------------------------------*/
 /* Check for command line options and respond.  See comments in usage()
@@ -35,8 +37,16 @@ int main(int argc, char *argv[])
         /* specify input file */
 	athinput = argv[++i];
 	break;
+      case 'c':                                /* -c          */
+        /* only compile the network into job/netcache */
+	compile = 1;
+	break;
+      case 'b':                                /* -b          */
+        /* benchmark the reduced networks (benchmark.c) */
+	bench = 1;
+	break;
       default:
-        ath_error(0, "%s -i <file>\n", argv[0]);
+        ath_error(0, "%s -i <file> [-c] [-b]\n", argv[0]);
         exit(EXIT_FAILURE);
         break;
       }
@@ -45,7 +55,7 @@ int main(int argc, char *argv[])
 
   /* Print usage message if no input file specified */
   if (athinput == NULL) {
-    ath_error(0, "%s -i <file> \n", argv[0]);
+    ath_error(0, "%s -i <file> [-c] [-b]\n", argv[0]);
     exit(EXIT_FAILURE);
   }
 
@@ -57,10 +67,22 @@ int main(int argc, char *argv[])
 
   par_dump(0,stdout); /* Dump a copy of the parsed information to athout */
 
+/* Compile the network into the cache and stop */
+  if (compile) {
+    if (!par_exist("job","netcache"))
+      ath_error("[main]: -c requires job/netcache in the input file!\n");
+    build_chemistry(&Chem);
+    write_netcache(&Chem, par_gets("job","netcache"));
+    final_chemistry(&Chem);
+    par_close();
+    return EXIT_SUCCESS;
+  }
+
 /*--- Step 3. ----------------------------------------------------------------*/
 /* initialization */
   printf("begin init chemistry");
   init_chemistry(&Chem);
+  check_solver_options(&Chem);
   printf("begin init ChemEvln");
   init_chemevln (&Chem, &Evln);
 
@@ -74,15 +96,51 @@ atol  = par_getd("problem","atol");
 zs    = par_getd("problem","zstart");
 ze    = par_getd("problem","zend");
 Real pts = par_getd("problem","pts");
+/* photo-reactions attenuated along the column (1) or unattenuated (0) */
+photocol = par_geti_def("problem","photocol",0);
+G0    = par_getd_def("problem","G0",1.0e4);  /* UV field at the surface */
+/* reduce the network over all cells (1) instead of evolving them (0) */
+gridred = par_geti_def("problem","gridred",0);
+/* main reaction channels of all species in all cells (1) */
+fluxan = par_geti_def("problem","fluxan",0);
+/* CSP timescale analysis of all cells (1) */
+cspan = par_geti_def("problem","cspan",0);
+/* adaptive vs full network in all cells (1) */
+dacan = par_geti_def("problem","dacan",0);
 
 
 /* Disk property */
 init_disk(&Disk); 
 init_chemout(&Chem,&ChemOut,1,"R",r,"0");
 
+/* ionization rate, Av and photo-reaction attenuation of the whole column */
+nz = 0;
+for(k=zs;k<ze;k++) nz++;
+if (nz > 0) {
+  zcol = (Real*)calloc_1d_array(nz, sizeof(Real));
+  nz = 0;
+  for(k=zs;k<ze;k++) zcol[nz++] = k/pts;
+  init_column(&Chem, &Col, &Disk, r, nz, zcol, G0);
+  free_1d_array(zcol);
+}
+
+if (bench && nz == 0)
+  ath_error("[main]: -b needs a column, problem/zend > problem/zstart!\n");
+
+if (bench)
+  bench_reduction(&Disk, &Col);
+else if (gridred == 1 && nz > 0)
+  reduce_grid(&Disk, &Col);
+else if (fluxan == 1 && nz > 0)
+  flux_analysis(&Disk, &Col);
+else if (cspan == 1 && nz > 0)
+  csp_analysis(&Disk, &Col);
+else if (dacan == 1 && nz > 0)
+  dac_analysis(&Disk, &Col);
+else
 for(k=zs;k<ze;k++){
   ath_pout(0,"\nIteration=%d\n",k+1);
-  zeta_eff = Ionization_disk(&Disk,r,k/pts);
+  zeta_eff = Col.zeta[k-(int)zs];
   Tg = Temp_disk(&Disk,r);	  // the temperature at 1AU
   rho = Rho_disk(&Disk,r,k/pts);	 //radius + height
   verbose = k;
@@ -91,7 +149,10 @@ for(k=zs;k<ze;k++){
   /* initialize the number density with single-element species */
   init_numberden(&Evln, rho, verbose);
   /* calculate the rate coefficients for all reactions */
-  IonizationCoeff(&Evln, zeta_eff,0.0,verbose); /* ionization reations */
+  if (photocol)   /* ionization reactions */
+    IonizationCoeff_column(&Evln, &Col, k-(int)zs, zeta_eff, verbose);
+  else
+    IonizationCoeff(&Evln, zeta_eff,0.0,verbose);
   /* Ionization with G */
   CalCoeff       (&Evln, Tg, verbose);       /* all other reactions */
   /* evolve the network from 0 to tend */
@@ -109,6 +170,7 @@ for(k=zs;k<ze;k++){
 /*--- Step 5. ----------------------------------------------------------------*/
 /* finalization */
 final_chemout(&ChemOut);
+if (nz > 0) final_column(&Col);
 final_chemevln (&Evln);
 final_chemistry(&Chem);
 par_close();
@@ -38,6 +38,7 @@
  *   int par_open()        - open and read a parameter file for R/O access
  *   void par_cmdline()    - parse a commandline, extract parameters
  *   int par_exist()       - returns 0 if block/name exists
+ *   char *par_next()      - returns the name of the next par in a block
  *   char *par_gets()      - returns a string from input field
  *   int par_geti()        - returns an integer from the input field
  *   double par_getd()     - returns a Real from the input field
@@ -222,6 +223,29 @@ int par_exist(char *block, char *name)
   return (pp == NULL ? 0 : 1);
 }
 
+/*----------------------------------------------------------------------------*/
+/* par_next: return the name of the next par in a block, or NULL after the
+ *   last one. *pos keeps the position between calls and must be NULL on the
+ *   first call. The string is owned by the par list. */
+
+char *par_next(char *block, void **pos)
+{
+  Block *bp;
+  Par *pp;
+
+  if (!now_open) ath_error("par_next: No open parameter file\n");
+  if (block == NULL) ath_error("par_next: no block name specified\n");
+  if (*pos == NULL) {
+    bp = find_block(block);
+    if (bp == NULL) return NULL;
+    pp = bp->p;
+  }
+  else
+    pp = ((Par*)(*pos))->next;
+  *pos = (void*)pp;
+  return (pp == NULL ? NULL : pp->name);
+}
+
 /*----------------------------------------------------------------------------*/
 /* par_gets:  return a string */
 
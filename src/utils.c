@@ -10,6 +10,7 @@
  * - ath_big_endian() - run-time detection of endianism of the host cpu
  * - ath_bswap()      - fast byte swapping routine
  * - ath_error()      - fatal error routine
+ * - fnv1a()          - FNV-1a hash of a block of memory
  * - minmax1()        - fast Min/Max for a 1d array using registers
  * - minmax2()        - fast Min/Max for a 2d array using registers
  * - minmax3()        - fast Min/Max for a 3d array using registers
@@ -133,6 +134,26 @@ void ath_error(char *fmt, ...)
   exit(EXIT_FAILURE);
 }
 
+/*----------------------------------------------------------------------------*/
+/*! \fn uint32_t fnv1a(uint32_t h, const void *buf, size_t len)
+ *  \brief 32-bit FNV-1a hash of len bytes at buf, continuing from h (start
+ *   with FNV1A_BASIS).
+ */
+
+uint32_t fnv1a(uint32_t h, const void *buf, size_t len)
+{
+  const unsigned char *p = (const unsigned char*)buf;
+  size_t i;
+
+  for (i=0; i<len; i++)
+  {
+    h ^= (uint32_t)p[i];
+    h *= 16777619U;
+  }
+
+  return h;
+}
+
 #if defined(PARTICLES) || defined(CHEMISTRY)
 /*----------------------------------------------------------------------------*/
 /*! \fn void ludcmp(Real **a, int n, int *indx, Real *d)